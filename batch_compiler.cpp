@@ -0,0 +1,115 @@
+#include "batch_compiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace heip {
+
+namespace {
+
+// `dir/name.heip` -> `<output_dir or dir>/name<extension>`
+std::string default_output(const std::string& input, const std::string& output_dir,
+                           const std::string& extension) {
+    size_t slash = input.find_last_of("/\\");
+    size_t name_start = slash == std::string::npos ? 0 : slash + 1;
+    size_t dot = input.find_last_of('.');
+    std::string stem = dot != std::string::npos && dot > name_start ?
+                       input.substr(0, dot) : input;
+    if (output_dir.empty()) return stem + extension;
+
+    std::string dir = output_dir;
+    if (dir.back() != '/' && dir.back() != '\\') dir += '/';
+    return dir + stem.substr(name_start) + extension;
+}
+
+} // namespace
+
+bool BatchCompiler::read_manifest(const std::string& path, const std::string& output_dir,
+                                  const std::string& extension,
+                                  std::vector<BatchJob>& jobs, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Failed to open manifest: " + path;
+        return false;
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream fields(line);
+        BatchJob job;
+        std::string extra;
+        if (!(fields >> job.input)) continue;
+        if (!(fields >> job.output)) job.output = default_output(job.input, output_dir, extension);
+        if (fields >> extra) {
+            error = path + ":" + std::to_string(line_number) + ": expected <input> [output]";
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+BatchStats BatchCompiler::run(const std::vector<BatchJob>& jobs) {
+    unsigned threads = options_.threads;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(jobs.size(), 1)));
+
+    results_.assign(jobs.size(), BatchResult{false, std::string(), 0, 0});
+    next_job_ = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(&BatchCompiler::work, this, std::cref(jobs));
+    }
+    work(jobs);
+    for (auto& worker : workers) worker.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    BatchStats stats = BatchStats();
+    stats.files = jobs.size();
+    stats.threads = threads;
+    stats.elapsed_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    for (const auto& result : results_) {
+        if (result.succeeded) {
+            stats.succeeded++;
+        } else {
+            stats.failed++;
+        }
+        stats.source_bytes += result.source_bytes;
+        stats.image_bytes += result.image_bytes;
+    }
+    return stats;
+}
+
+void BatchCompiler::work(const std::vector<BatchJob>& jobs) {
+    DodecaCompiler compiler;
+    compiler.set_verbose(false);
+    compiler.enable_learning(options_.help_enabled);
+    compiler.set_overlay_strategy(options_.overlay_strategy);
+    compiler.set_optimization_level(options_.optimization_level);
+    compiler.set_profile(options_.profile);
+    compiler.set_object_output(options_.object_output);
+
+    // Each job's result slot is written by exactly one worker
+    for (size_t job = next_job_++; job < jobs.size(); job = next_job_++) {
+        BatchResult& result = results_[job];
+        result.succeeded = compiler.compile(jobs[job].input, jobs[job].output);
+        if (result.succeeded) {
+            result.source_bytes = compiler.get_original_size();
+            result.image_bytes = compiler.get_compressed_size();
+        } else {
+            result.error = compiler.get_last_error();
+        }
+    }
+}
+
+} // namespace heip
@@ -0,0 +1,74 @@
+#pragma once
+#include "dodeca_compiler.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace heip {
+
+// One source and the image it compiles to
+struct BatchJob {
+    std::string input;
+    std::string output;
+};
+
+// Settings every worker's compiler is configured with
+struct BatchOptions {
+    bool help_enabled;
+    OverlayStrategy overlay_strategy;
+    int optimization_level;
+    std::shared_ptr<const ExecutionProfile> profile;   // Read-only, shared by all workers
+    unsigned threads;                                  // 0: one per hardware thread
+    bool object_output;                                // --object
+};
+
+// Outcome of one job, in manifest order
+struct BatchResult {
+    bool succeeded;
+    std::string error;
+    size_t source_bytes;       // Both 0 for a failed job
+    size_t image_bytes;
+};
+
+// Aggregate over a whole batch
+struct BatchStats {
+    size_t files;
+    size_t succeeded;
+    size_t failed;
+    uint64_t source_bytes;     // Of the jobs that succeeded
+    uint64_t image_bytes;
+    uint64_t elapsed_us;       // Wall clock for the whole batch
+    unsigned threads;
+};
+
+// `heip compile --batch <manifest>`: many sources in one process. A fixed
+// pool of workers claims jobs from a shared counter; each worker keeps one
+// DodecaCompiler for all of its jobs, since compile() resets the
+// per-program state itself. The opcode table, instruction maps and the
+// profile are read-only and shared. Workers run quiet and report through
+// their job's BatchResult.
+class BatchCompiler {
+public:
+    explicit BatchCompiler(const BatchOptions& options) : options_(options) {}
+
+    // Manifest: one `<input> [output]` per line, blank lines and `#`
+    // comments skipped. A missing output is the input with its extension
+    // replaced by `extension`, placed in `output_dir` when that is not empty.
+    static bool read_manifest(const std::string& path, const std::string& output_dir,
+                              const std::string& extension,
+                              std::vector<BatchJob>& jobs, std::string& error);
+
+    BatchStats run(const std::vector<BatchJob>& jobs);
+    const std::vector<BatchResult>& results() const { return results_; }
+
+private:
+    void work(const std::vector<BatchJob>& jobs);
+
+    BatchOptions options_;
+    std::vector<BatchResult> results_;
+    std::atomic<size_t> next_job_;
+};
+
+} // namespace heip
@@ -0,0 +1,270 @@
+#include "bytecode_image.h"
+#include "opcode_table.h"
+
+namespace heip {
+
+namespace {
+
+void put_u16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back(value & 0xFF);
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[4];
+    write_u32(bytes, value);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+// Bounds-checked sequential reader
+struct Reader {
+    const std::vector<uint8_t>& data;
+    size_t pos;
+
+    bool u8(uint8_t& value) {
+        if (pos + 1 > data.size()) return false;
+        value = data[pos++];
+        return true;
+    }
+
+    bool u16(uint16_t& value) {
+        if (pos + 2 > data.size()) return false;
+        value = static_cast<uint16_t>((data[pos] << 8) | data[pos + 1]);
+        pos += 2;
+        return true;
+    }
+
+    bool u32(uint32_t& value) {
+        if (pos + 4 > data.size()) return false;
+        value = read_u32(data.data() + pos);
+        pos += 4;
+        return true;
+    }
+
+    bool bytes(std::string& value, size_t length) {
+        if (pos + length > data.size()) return false;
+        value.assign(data.begin() + pos, data.begin() + pos + length);
+        pos += length;
+        return true;
+    }
+};
+
+} // namespace
+
+std::vector<uint8_t> BytecodeImage::serialize() const {
+    std::vector<uint8_t> out;
+    put_u32(out, kMagic);
+    put_u16(out, kVersion);
+    put_u16(out, flags);
+    put_u32(out, entry);
+    put_u32(out, static_cast<uint32_t>(units.size()));
+    put_u32(out, static_cast<uint32_t>(aliases.size()));
+    put_u32(out, static_cast<uint32_t>(code.size()));
+
+    for (const auto& unit : units) {
+        out.push_back(static_cast<uint8_t>(unit.kind));
+        put_u32(out, unit.symbol);
+        put_u32(out, unit.offset);
+        put_u32(out, unit.size);
+        put_u32(out, unit.slot_count);
+        out.push_back(unit.has_stack_effect ? 1 : 0);
+        put_u32(out, static_cast<uint32_t>(unit.stack_effect.lowest));
+        put_u32(out, static_cast<uint32_t>(unit.stack_effect.highest));
+        put_u32(out, static_cast<uint32_t>(unit.stack_effect.net));
+        out.push_back(unit.pure ? 1 : 0);
+        put_u16(out, static_cast<uint16_t>(unit.name.size()));
+        out.insert(out.end(), unit.name.begin(), unit.name.end());
+    }
+
+    for (const auto& alias : aliases) {
+        put_u32(out, alias.symbol);
+        put_u32(out, alias.unit);
+    }
+
+    put_u32(out, static_cast<uint32_t>(sources.size()));
+    for (const auto& source : sources) {
+        put_u16(out, static_cast<uint16_t>(source.size()));
+        out.insert(out.end(), source.begin(), source.end());
+    }
+    put_u32(out, static_cast<uint32_t>(sites.size()));
+    for (const auto& site : sites) {
+        out.push_back(static_cast<uint8_t>(site.kind));
+        put_u32(out, site.offset);
+        put_u32(out, site.source);
+        put_u32(out, site.line);
+    }
+    put_u32(out, static_cast<uint32_t>(imports.size()));
+    for (const auto& import : imports) {
+        put_u32(out, import.offset);
+        put_u32(out, import.unit);
+        put_u16(out, static_cast<uint16_t>(import.name.size()));
+        out.insert(out.end(), import.name.begin(), import.name.end());
+    }
+    put_u32(out, static_cast<uint32_t>(strings.size()));
+    for (const auto& string : strings) {
+        put_u32(out, static_cast<uint32_t>(string.size()));
+        out.insert(out.end(), string.begin(), string.end());
+    }
+    put_u32(out, cache_sites);
+    put_u32(out, static_cast<uint32_t>(superlatives.size()));
+    for (const auto& superlative : superlatives) {
+        put_u16(out, static_cast<uint16_t>(superlative.name.size()));
+        out.insert(out.end(), superlative.name.begin(), superlative.name.end());
+        put_u32(out, static_cast<uint32_t>(superlative.candidates.size()));
+        for (uint32_t unit : superlative.candidates) put_u32(out, unit);
+    }
+
+    out.insert(out.end(), code.begin(), code.end());
+    return out;
+}
+
+bool BytecodeImage::is_image(const std::vector<uint8_t>& data) {
+    return data.size() >= 4 && read_u32(data.data()) == kMagic;
+}
+
+bool BytecodeImage::deserialize(const std::vector<uint8_t>& data, BytecodeImage& image) {
+    uint32_t code_size;
+    size_t code_start;
+    if (!deserialize_tables(data, image, code_size, code_start)) return false;
+    if (code_start + code_size != data.size()) return false;
+    image.code.assign(data.begin() + code_start, data.end());
+    return true;
+}
+
+bool BytecodeImage::code_size_of(const std::vector<uint8_t>& header, uint32_t& code_size) {
+    if (header.size() < kHeaderSize || !is_image(header)) return false;
+    code_size = read_u32(header.data() + kHeaderSize - 4);
+    return true;
+}
+
+bool BytecodeImage::deserialize_tables(const std::vector<uint8_t>& data, BytecodeImage& image,
+                                       uint32_t& code_size, size_t& code_start) {
+    Reader reader{data, 0};
+    uint32_t magic, unit_count, alias_count;
+    uint16_t version;
+
+    if (!reader.u32(magic) || magic != kMagic) return false;
+    if (!reader.u16(version) || version != kVersion) return false;
+    if (!reader.u16(image.flags) || !reader.u32(image.entry)) return false;
+    if (!reader.u32(unit_count) || !reader.u32(alias_count) || !reader.u32(code_size)) {
+        return false;
+    }
+
+    image.units.clear();
+    for (uint32_t i = 0; i < unit_count; i++) {
+        ImageUnit unit;
+        uint8_t kind, has_stack_effect, pure;
+        uint16_t name_length;
+        uint32_t lowest, highest, net;
+        if (!reader.u8(kind) || kind > static_cast<uint8_t>(UnitKind::OVERLAY)) return false;
+        if (!reader.u32(unit.symbol) || !reader.u32(unit.offset) ||
+            !reader.u32(unit.size) || !reader.u32(unit.slot_count)) {
+            return false;
+        }
+        if (!reader.u8(has_stack_effect) || !reader.u32(lowest) || !reader.u32(highest) ||
+            !reader.u32(net) || !reader.u8(pure)) {
+            return false;
+        }
+        unit.has_stack_effect = has_stack_effect != 0;
+        unit.pure = pure != 0;
+        unit.stack_effect = StackEffect{static_cast<int32_t>(lowest),
+                                        static_cast<int32_t>(highest), static_cast<int32_t>(net)};
+        if (!reader.u16(name_length) || !reader.bytes(unit.name, name_length)) return false;
+        if (static_cast<uint64_t>(unit.offset) + unit.size > code_size) return false;
+        if (unit.symbol != kInvalidSymbol && unit.symbol >= kSymbolLimit) return false;
+        if (unit.slot_count > kMaxSlots) return false;
+        unit.kind = static_cast<UnitKind>(kind);
+        image.units.push_back(unit);
+    }
+
+    image.aliases.clear();
+    for (uint32_t i = 0; i < alias_count; i++) {
+        ImageAlias alias;
+        if (!reader.u32(alias.symbol) || !reader.u32(alias.unit)) return false;
+        if (alias.unit >= unit_count || alias.symbol >= kSymbolLimit) return false;
+        image.aliases.push_back(alias);
+    }
+
+    uint32_t source_count, site_count;
+    image.sources.clear();
+    if (!reader.u32(source_count)) return false;
+    for (uint32_t i = 0; i < source_count; i++) {
+        std::string source;
+        uint16_t length;
+        if (!reader.u16(length) || !reader.bytes(source, length)) return false;
+        image.sources.push_back(source);
+    }
+    image.sites.clear();
+    if (!reader.u32(site_count)) return false;
+    for (uint32_t i = 0; i < site_count; i++) {
+        ImageSite site;
+        uint8_t kind;
+        if (!reader.u8(kind) || kind > static_cast<uint8_t>(SiteKind::INLINE)) return false;
+        if (!reader.u32(site.offset) || !reader.u32(site.source) || !reader.u32(site.line)) {
+            return false;
+        }
+        if (site.offset >= code_size || site.source >= source_count) return false;
+        site.kind = static_cast<SiteKind>(kind);
+        image.sites.push_back(site);
+    }
+    
+    uint32_t import_count;
+    image.imports.clear();
+    if (!reader.u32(import_count)) return false;
+    for (uint32_t i = 0; i < import_count; i++) {
+        ImageImport import;
+        uint16_t length;
+        if (!reader.u32(import.offset) || !reader.u32(import.unit) ||
+            !reader.u16(length) || !reader.bytes(import.name, length)) {
+            return false;
+        }
+        if (static_cast<uint64_t>(import.offset) + 4 > code_size || import.unit >= unit_count) {
+            return false;
+        }
+        image.imports.push_back(import);
+    }
+    if (!image.imports.empty() && !(image.flags & kObjectFlag)) return false;
+
+    uint32_t string_count;
+    image.strings.clear();
+    if (!reader.u32(string_count)) return false;
+    for (uint32_t i = 0; i < string_count; i++) {
+        std::string string;
+        uint32_t length;
+        if (!reader.u32(length) || !reader.bytes(string, length)) return false;
+        image.strings.push_back(string);
+    }
+
+    // Each site is an instruction of its own, so a larger count is corrupt
+    if (!reader.u32(image.cache_sites) || image.cache_sites > code_size) return false;
+
+    // A Superlative chooses between protocols, so it needs at least one
+    uint32_t superlative_count;
+    image.superlatives.clear();
+    if (!reader.u32(superlative_count)) return false;
+    for (uint32_t i = 0; i < superlative_count; i++) {
+        ImageSuperlative superlative;
+        uint16_t length;
+        uint32_t candidate_count;
+        if (!reader.u16(length) || !reader.bytes(superlative.name, length) ||
+            !reader.u32(candidate_count) || candidate_count == 0) {
+            return false;
+        }
+        for (uint32_t c = 0; c < candidate_count; c++) {
+            uint32_t unit;
+            if (!reader.u32(unit) || unit >= unit_count ||
+                image.units[unit].kind != UnitKind::PROTOCOL) {
+                return false;
+            }
+            superlative.candidates.push_back(unit);
+        }
+        image.superlatives.push_back(superlative);
+    }
+
+    if (code_size > 0 && image.entry >= code_size) return false;
+    image.code.clear();
+    code_start = reader.pos;
+    return true;
+}
+
+} // namespace heip
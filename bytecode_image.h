@@ -0,0 +1,127 @@
+#pragma once
+#include "heip_types.h"
+#include <vector>
+#include <string>
+
+namespace heip {
+
+// Kinds of code unit stored in an image
+enum class UnitKind : uint8_t {
+    MAIN = 0,        // Synthesized from top-level statements; the entry point
+    PROTOCOL = 1,
+    OVERLAY = 2      // Shared overlay body run through OVERLAY_EXPAND
+};
+
+// Operand stack effect of running a unit, callees included, relative to
+// the depth it is entered at
+struct StackEffect {
+    int32_t lowest;            // Deepest point below the entry depth (<= 0)
+    int32_t highest;           // Peak above the entry depth (>= 0)
+    int32_t net;               // Depth change at every FRAME_EXIT/RET
+
+    bool operator==(const StackEffect& other) const {
+        return lowest == other.lowest && highest == other.highest && net == other.net;
+    }
+};
+
+// One protocol/overlay body in the code section
+struct ImageUnit {
+    std::string name;          // Qualified name ("Franchise.protocol")
+    UnitKind kind;
+    DodecaSymbol symbol;       // Overlay symbol, kInvalidSymbol otherwise
+    uint32_t offset;           // Offset into the code section
+    uint32_t size;
+    uint32_t slot_count;       // Frame slots the body uses
+    bool has_stack_effect;     // Set by compute_stack_effects; a claim the
+    StackEffect stack_effect;  // runtime checks before relying on it
+    bool pure;                 // Set by compute_purity; checked the same way
+};
+
+// Explicit `<symbol>: <name>` binding to a unit
+struct ImageAlias {
+    DodecaSymbol symbol;
+    uint32_t unit;
+};
+
+// Superlative: protocols `SUPERLATIVE` sites choose between at runtime
+struct ImageSuperlative {
+    std::string name;
+    std::vector<uint32_t> candidates;   // Protocol unit indices
+};
+
+// Instrumentation points counted by `heip run --profile-out`
+enum class SiteKind : uint8_t {
+    BRANCH = 0,            // Conditional branch taken when its condition holds
+    BRANCH_INVERTED = 1,   // Conditional branch taken when its condition fails
+    INLINE = 2             // First instruction of an inlined protocol body
+};
+
+// Profile site; branches are keyed by source line so a profile outlives
+// the image it was recorded with
+struct ImageSite {
+    SiteKind kind;
+    uint32_t offset;           // Code offset of the instruction
+    uint32_t source;           // Index into BytecodeImage::sources
+    uint32_t line;             // Source line of a branch's If/While
+};
+
+// Call from an object into a protocol another object defines; `heip link`
+// writes the callee's offset into the CALL operand
+struct ImageImport {
+    uint32_t offset;           // Code offset of the CALL operand
+    uint32_t unit;             // Calling unit, whose franchise scopes the lookup
+    std::string name;          // Guide target as written
+};
+
+// Executable image written by `heip compile` and loaded by the runtime, or
+// an object (kObjectFlag) written by `heip compile --object` for `heip link`.
+// Layout (all integers big-endian, like instruction operands):
+//   magic "HEIP", version u16, flags u16, entry u32,
+//   unit count u32, alias count u32, code size u32,
+//   units:   kind u8, symbol u32, offset u32, size u32, slots u32,
+//            has stack effect u8, lowest u32, highest u32, net u32, pure u8,
+//            name length u16, name bytes
+//   aliases: symbol u32, unit u32
+//   source count u32, sources: name length u16, name bytes
+//   site count u32, sites: kind u8, offset u32, source u32, line u32
+//   import count u32, imports: offset u32, unit u32, name length u16, name bytes
+//   string count u32, strings: length u32, bytes
+//   cache site count u32
+//   superlative count u32, superlatives: name length u16, name bytes,
+//            candidate count u32, candidates: unit u32
+//   code section
+struct BytecodeImage {
+    static const uint32_t kMagic = 0x48454950;   // "HEIP"
+    static const uint16_t kVersion = 9;
+    static const uint16_t kObjectFlag = 0x0001;   // Unlinked; may have imports
+    static const uint32_t kMaxSlots = 1u << 16;   // Per unit frame
+
+    uint16_t flags;
+    uint32_t entry;            // Code offset of the MAIN unit
+    std::vector<ImageUnit> units;
+    std::vector<ImageAlias> aliases;
+    std::vector<std::string> sources;   // Unit names profile sites refer to
+    std::vector<ImageSite> sites;
+    std::vector<ImageImport> imports;   // Objects only
+    std::vector<std::string> strings;   // LOAD_STR constants, each stored once
+    uint32_t cache_sites;      // OVERLAY_EXPAND/SYMBOL_RESOLVE/SUPERLATIVE sites, numbered densely
+    std::vector<ImageSuperlative> superlatives;   // By SUPERLATIVE operand
+    std::vector<uint8_t> code;
+
+    BytecodeImage() : flags(0), entry(0), cache_sites(0) {}
+
+    std::vector<uint8_t> serialize() const;
+    static bool is_image(const std::vector<uint8_t>& data);
+    static bool deserialize(const std::vector<uint8_t>& data, BytecodeImage& image);
+
+    // For loaders that read code on demand: the first kHeaderSize bytes give
+    // the code size, so the tables are everything before the last
+    // `code_size` bytes. deserialize_tables leaves `code` empty and reports
+    // where the code section starts in `data`.
+    static const size_t kHeaderSize = 24;
+    static bool code_size_of(const std::vector<uint8_t>& header, uint32_t& code_size);
+    static bool deserialize_tables(const std::vector<uint8_t>& data, BytecodeImage& image,
+                                   uint32_t& code_size, size_t& code_start);
+};
+
+} // namespace heip
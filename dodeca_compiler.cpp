@@ -1,17 +1,39 @@
 #include "dodeca_compiler.h"
+#include "opcode_table.h"
+#include "purity_analysis.h"
+#include "stack_verifier.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 #include <cmath>
 
 namespace heip {
 
 DodecaCompiler::DodecaCompiler() 
-    : next_symbol_('0')
+    : stage_(CompileStage::DONE)
+    , overlay_strategy_(OverlayStrategy::AUTO)
+    , next_site_(0)
+    , overlays_inlined_(0)
+    , overlays_shared_(0)
+    , inline_calls_(false)
+    , protocols_inlined_(0)
+    , optimization_level_(2)
+    , optimizer_stats_()
+    , next_symbol_(0)
     , help_enabled_(true)
     , original_size_(0)
     , compressed_size_(0)
-    , compression_ratio_(1.0f) {
+    , compression_ratio_(1.0f)
+    , object_output_(false)
+    , verbose_(true)
+    , retries_left_(0)
+    , stage_retries_(0) {
     
     // Initialize HELP context
     help_context_.compilation_count = 0;
@@ -19,128 +41,769 @@ DodecaCompiler::DodecaCompiler()
 }
 
 bool DodecaCompiler::compile(const std::string& source_file, const std::string& output_file) {
-    try {
-        // Stage 1: Read source
-   std::ifstream file(source_file);
-  if (!file.is_open()) {
-         std::cerr << "Failed to open source file: " << source_file << std::endl;
-   return false;
-        }
-        
- std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string source = buffer.str();
-      original_size_ = source.size();
-        
-        // Stage 2: Parse instructions
-        auto instructions = parse_instructions(source);
-  
-        // Stage 3: Build protocols
-      auto protocols = build_protocols(instructions);
-   
-        // Stage 4: Generate bytecode with dodecagramic compression
-   auto bytecode = generate_bytecode(protocols);
-
-        // Stage 5: Apply exponential folding
-   auto folded = fold_structure(bytecode);
- 
-        // Stage 6: HELP optimization
-   if (help_enabled_) {
-        apply_help_optimizations(folded);
+    last_error_.clear();
+    
+    // Symbols, sites and bindings are per program
+    dodeca_map_ = DodecaMap();
+    symbol_aliases_.clear();
+    protocol_index_.clear();
+    superlatives_.clear();
+    superlative_index_.clear();
+    compiled_overlays_.clear();
+    next_symbol_ = 0;
+    next_site_ = 0;
+    overlays_inlined_ = 0;
+    overlays_shared_ = 0;
+    protocol_bodies_.clear();
+    call_sites_.clear();
+    call_weights_.clear();
+    strings_.clear();
+    string_index_.clear();
+    inline_calls_ = false;
+    protocols_inlined_ = 0;
+    optimizer_stats_ = OptimizerStats();
+    
+    artifacts_ = CompileArtifacts();
+    artifacts_.prepared = false;
+    artifacts_.overlays_done = 0;
+    artifacts_.protocols_done = 0;
+    retries_left_ = kStageRetries;
+    stage_retries_ = 0;
+    failing_body_.clear();
+    unoptimized_bodies_.clear();
+    
+    stage_ = CompileStage::READ;
+    while (stage_ != CompileStage::DONE) {
+        try {
+            if (!run_stage(stage_, source_file, output_file)) {
+                if (verbose_) std::cerr << last_error_ << std::endl;
+                return false;
+            }
+            stage_ = static_cast<CompileStage>(static_cast<int>(stage_) + 1);
+        } catch (const std::exception& e) {
+            last_error_ = std::string("Compilation error: ") + e.what();
+            if (verbose_) std::cerr << last_error_ << std::endl;
+            
+            // Self-healing re-runs the failed stage from the artefacts
+            // before it
+            if (!recover_stage(e.what())) return false;
+            if (verbose_) std::cout << "Error recovered through HELP system" << std::endl;
         }
+    }
+    
+    // Log compilation success
+    help_context_.compilation_count++;
+    log_forensic_event("Compilation successful: " + source_file);
+    
+    if (verbose_) {
+        std::cout << "Compilation successful!" << std::endl;
+        std::cout << "Original size: " << original_size_ << " bytes" << std::endl;
+        std::cout << "Compressed size: " << compressed_size_ << " bytes" << std::endl;
+        std::cout << "Compression ratio: " << compression_ratio_ << "x" << std::endl;
+    }
+    return true;
+}
+
+bool DodecaCompiler::run_stage(CompileStage stage, const std::string& source_file,
+                               const std::string& output_file) {
+    switch (stage) {
+        case CompileStage::READ: {
+            std::ifstream file(source_file);
+            if (!file.is_open()) {
+                last_error_ = "Failed to open source file: " + source_file;
+                return false;
+            }
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            artifacts_.source = buffer.str();
+            original_size_ = artifacts_.source.size();
+            break;
+        }
+        
+        case CompileStage::PARSE:
+            artifacts_.instructions = parse_instructions(artifacts_.source);
+            break;
         
-        compressed_size_ = folded.size();
-        compression_ratio_ = static_cast<float>(original_size_) / compressed_size_;
+        case CompileStage::BUILD_PROTOCOLS:
+            symbol_aliases_.clear();
+            protocol_index_.clear();
+            superlatives_.clear();
+            superlative_index_.clear();
+            artifacts_.protocols = build_protocols(artifacts_.instructions);
+            break;
         
-        // Stage 7: Emit native code
-        auto native_code = emit_native_code(folded);
+        case CompileStage::GENERATE:
+            // Overlays are compiled once, then HELP-optimized unit bytecode
+            generate_units();
+            break;
         
-        // Stage 8: Write output
-        std::ofstream output(output_file, std::ios::binary);
-  if (!output.is_open()) {
-   std::cerr << "Failed to open output file: " << output_file << std::endl;
-   return false;
+        case CompileStage::LINK:
+            // The image is not folded: folding has no inverse, so a folded
+            // image cannot run
+            artifacts_.image = link_program();
+            compressed_size_ = artifacts_.image.size();
+            compression_ratio_ = static_cast<float>(original_size_) / compressed_size_;
+            break;
+        
+        case CompileStage::EMIT:
+            artifacts_.native = emit_native_code(artifacts_.image);
+            break;
+        
+        case CompileStage::WRITE: {
+            std::ofstream output(output_file, std::ios::binary);
+            if (!output.is_open()) {
+                last_error_ = "Failed to open output file: " + output_file;
+                return false;
+            }
+            output.write(reinterpret_cast<const char*>(artifacts_.native.data()),
+                         artifacts_.native.size());
+            break;
         }
         
-    output.write(reinterpret_cast<const char*>(native_code.data()), native_code.size());
+        case CompileStage::DONE:
+            break;
+    }
+    return true;
+}
+
+namespace {
+
+const char kMainUnitName[] = "__main__";
+
+// Bytes at or under which an overlay body is always inlined
+const size_t kOverlayInlineBytes = 32;
+
+// Size of an OVERLAY_EXPAND site (opcode + site + symbol)
+const size_t kOverlayExpandBytes = 9;
+
+// Protocol inlining budgets: any call site, a protocol's only call site.
+// Each enclosing loop doubles the budget, up to kInlineLoopBoost times.
+const size_t kInlineBytes = 48;
+const size_t kInlineSingleCallBytes = 256;
+const size_t kInlineLoopBoost = 4;
+
+// Profile-guided thresholds (--profile-in). A protocol receiving at least
+// 1/kHotCallShare of all calls has its inlining budget shifted up by
+// kHotInlineBoost; one never called keeps only kInlineBytes. An If/Else arm
+// run on under 1/kColdArmShare of at least kMinBranchSamples evaluations is
+// laid out after the hot path. A fusable opcode pair making up at least
+// 1/kFusePairShare of executed pairs becomes a superinstruction.
+const uint64_t kHotCallShare = 8;
+const size_t kHotInlineBoost = 2;
+const uint64_t kColdArmShare = 16;
+const uint64_t kMinBranchSamples = 16;
+const uint64_t kFusePairShare = 200;
+
+// Image layout. A call site weighs kLoopCallWeight per enclosing loop (up
+// to two) and a body that loops multiplies its weight by it again; with a
+// profile, a unit's heat is its calls plus its condition evaluations. Units
+// below kHotUnitHeat (error paths, one-shot initializers) are placed last.
+const uint64_t kLoopCallWeight = 16;
+const uint64_t kHotUnitHeat = 16;
+
+// Superinstruction catalog: adjacent instructions and their fused form
+struct FusedPair {
+    HEIPOpcode first;
+    HEIPOpcode second;
+    HEIPOpcode fused;
+};
+
+const FusedPair kFusedPairs[] = {
+    {HEIPOpcode::LOAD, HEIPOpcode::ADD, HEIPOpcode::ADD_IMM},
+    {HEIPOpcode::LOAD, HEIPOpcode::SUB, HEIPOpcode::SUB_IMM},
+    {HEIPOpcode::SLOT_LOAD, HEIPOpcode::SLOT_LOAD, HEIPOpcode::SLOT_LOAD2},
+    {HEIPOpcode::SLOT_STORE, HEIPOpcode::SLOT_LOAD, HEIPOpcode::SLOT_TEE},
+    {HEIPOpcode::CMP_EQ, HEIPOpcode::JNZ, HEIPOpcode::JEQ},
+    {HEIPOpcode::CMP_EQ, HEIPOpcode::JZ, HEIPOpcode::JNE},
+    {HEIPOpcode::CMP_NE, HEIPOpcode::JNZ, HEIPOpcode::JNE},
+    {HEIPOpcode::CMP_NE, HEIPOpcode::JZ, HEIPOpcode::JEQ},
+    {HEIPOpcode::CMP_LT, HEIPOpcode::JNZ, HEIPOpcode::JLT},
+    {HEIPOpcode::CMP_LT, HEIPOpcode::JZ, HEIPOpcode::JGE},
+    {HEIPOpcode::CMP_LE, HEIPOpcode::JNZ, HEIPOpcode::JLE},
+    {HEIPOpcode::CMP_LE, HEIPOpcode::JZ, HEIPOpcode::JGT},
+    {HEIPOpcode::CMP_GT, HEIPOpcode::JNZ, HEIPOpcode::JGT},
+    {HEIPOpcode::CMP_GT, HEIPOpcode::JZ, HEIPOpcode::JLE},
+    {HEIPOpcode::CMP_GE, HEIPOpcode::JNZ, HEIPOpcode::JGE},
+    {HEIPOpcode::CMP_GE, HEIPOpcode::JZ, HEIPOpcode::JLT},
+};
+
+std::string to_lower(std::string text) {
+    for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return text;
+}
+
+// Split a source line into tokens; quoted strings stay whole and an
+// unquoted '#' starts a comment
+std::vector<std::string> tokenize_line(const std::string& line) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+            continue;
+        }
+        if (c == '#') break;
         
-        // Log compilation success
-        help_context_.compilation_count++;
-        log_forensic_event("Compilation successful: " + source_file);
-     
-        std::cout << "Compilation successful!" << std::endl;
-      std::cout << "Original size: " << original_size_ << " bytes" << std::endl;
-        std::cout << "Compressed size: " << compressed_size_ << " bytes" << std::endl;
-        std::cout << "Compression ratio: " << compression_ratio_ << "x" << std::endl;
+        size_t start = i;
+        if (c == '"') {
+            i++;
+            while (i < line.size() && line[i] != '"') i++;
+            if (i < line.size()) i++;
+        } else {
+            while (i < line.size() && line[i] != '#' &&
+                   !std::isspace(static_cast<unsigned char>(line[i]))) {
+                i++;
+            }
+        }
+        tokens.push_back(line.substr(start, i - start));
+    }
+    return tokens;
+}
+
+// Anything that is not a name: numbers, quoted strings, booleans
+bool is_literal_token(const std::string& token) {
+    if (token.empty()) return false;
+    if (token == "true" || token == "false" || token[0] == '"') return true;
+    size_t i = (token[0] == '-' || token[0] == '+') ? 1 : 0;
+    return i < token.size() && std::isdigit(static_cast<unsigned char>(token[i]));
+}
+
+// Literals with a 32-bit encoding: booleans and integers that fit an
+// int32; wider integers fall through to parse_number and load as doubles
+bool parse_literal(const std::string& token, uint32_t& value) {
+    if (token == "true" || token == "false") {
+        value = token == "true" ? 1 : 0;
+        return true;
+    }
+    
+    size_t i = (!token.empty() && (token[0] == '-' || token[0] == '+')) ? 1 : 0;
+    if (i >= token.size()) return false;
+    for (size_t j = i; j < token.size(); j++) {
+        if (!std::isdigit(static_cast<unsigned char>(token[j]))) return false;
+    }
+    errno = 0;
+    long long parsed = std::strtoll(token.c_str(), nullptr, 10);
+    if (errno == ERANGE || parsed < INT32_MIN || parsed > INT32_MAX) return false;
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+// Fractional and exponent forms (`1.5`, `-2e10`) load as doubles
+bool parse_number(const std::string& token, double& value) {
+    if (!is_literal_token(token) || token[0] == '"') return false;
+    char* end = nullptr;
+    value = std::strtod(token.c_str(), &end);
+    return end == token.c_str() + token.size();
+}
+
+std::string qualify(const std::string& scope, const std::string& name) {
+    return scope.empty() ? name : scope + "." + name;
+}
+
+// Guide lines name their target as `Guide call X` or `Guide X`
+std::string guide_target(const Instruction& inst) {
+    if (inst.name == "call") return inst.params.empty() ? std::string() : inst.params[0];
+    return inst.name;
+}
+
+// A body can be spliced into its caller if it never leaves the frame
+// (calls, expansions, returns, frame and checkpoint opcodes) and its stack
+// depth is fixed at every instruction and never drops below the entry
+// depth. `may_fault` reports instructions that can fail at runtime.
+bool analyze_leaf(const std::vector<uint8_t>& code, bool& may_fault) {
+    may_fault = false;
+    std::vector<int32_t> depth(code.size() + 1, -1);
+    std::vector<size_t> worklist(1, 0);
+    depth[0] = 0;
+    
+    while (!worklist.empty()) {
+        size_t pc = worklist.back();
+        worklist.pop_back();
+        if (pc == code.size()) continue;
+        
+        DecodedInstruction inst;
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) return false;
+        const OpcodeInfo* info = opcode_info(static_cast<uint8_t>(inst.opcode));
+        if (info->pops < 0 || info->pushes < 0 || depth[pc] < info->pops) return false;
         
-     return true;
+        switch (inst.opcode) {
+            case HEIPOpcode::CALL: case HEIPOpcode::TAILCALL: case HEIPOpcode::RET:
+            case HEIPOpcode::HELP_HEAL:
+            case HEIPOpcode::FRAME_CREATE: case HEIPOpcode::FRAME_ENTER:
+            case HEIPOpcode::FRAME_EXIT: case HEIPOpcode::STATE_SAVE:
+            case HEIPOpcode::INLINE_ENTER: case HEIPOpcode::INLINE_EXIT:
+                return false;
+            case HEIPOpcode::NOP: case HEIPOpcode::LOAD:
+            case HEIPOpcode::SLOT_LOAD: case HEIPOpcode::SLOT_STORE:
+            case HEIPOpcode::ADD: case HEIPOpcode::SUB: case HEIPOpcode::MUL:
+            case HEIPOpcode::CMP: case HEIPOpcode::CMP_EQ: case HEIPOpcode::CMP_NE:
+            case HEIPOpcode::CMP_LT: case HEIPOpcode::CMP_LE:
+            case HEIPOpcode::CMP_GT: case HEIPOpcode::CMP_GE:
+            case HEIPOpcode::JMP: case HEIPOpcode::JZ: case HEIPOpcode::JNZ:
+            case HEIPOpcode::POP: case HEIPOpcode::HELP_LEARN:
+            case HEIPOpcode::HELP_ADAPT: case HEIPOpcode::HELP_RECOMMEND:
+            case HEIPOpcode::HELP_SNAPSHOT:
+            case HEIPOpcode::LOAD_F64: case HEIPOpcode::LOAD_STR:
+                break;
+            default:
+                may_fault = true;
+                break;
+        }
         
-    } catch (const std::exception& e) {
-        std::cerr << "Compilation error: " << e.what() << std::endl;
-  
-        // Attempt self-healing
-        if (attempt_error_recovery(e.what())) {
-   std::cout << "Error recovered through HELP system" << std::endl;
-            return compile(source_file, output_file);  // Retry
-   }
+        int32_t next_depth = depth[pc] - info->pops + info->pushes;
+        std::vector<size_t> next;
+        if (is_branch(inst.opcode)) {
+            if (inst.operands[0] > code.size()) return false;
+            next.push_back(inst.operands[0]);
+        }
+        if (inst.opcode != HEIPOpcode::JMP) next.push_back(pc + inst.length);
+        for (size_t target : next) {
+            if (depth[target] < 0) {
+                depth[target] = next_depth;
+                worklist.push_back(target);
+            } else if (depth[target] != next_depth) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A branch to itself or an earlier instruction closes a loop
+bool has_back_edge(const std::vector<uint8_t>& code) {
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) return false;
+        if (is_branch(inst.opcode) && inst.operands[0] <= pc) return true;
+    }
+    return false;
+}
+
+// Static weight of one call site at the given loop depth
+uint64_t call_weight(uint32_t loop_depth) {
+    uint64_t weight = 1;
+    for (uint32_t i = 0; i < loop_depth && i < 2; i++) weight *= kLoopCallWeight;
+    return weight;
+}
+
+// Wrap a compiled body in the frame prologue/epilogue
+CodeUnit make_frame_unit(const std::string& name, UnitKind kind, DodecaSymbol symbol,
+                         const std::vector<uint8_t>& body, uint32_t slot_count,
+                         const std::vector<Relocation>& relocations) {
+    if (slot_count > BytecodeImage::kMaxSlots) {
+        throw std::runtime_error(name + " needs more than " +
+                                 std::to_string(BytecodeImage::kMaxSlots) + " slots");
+    }
+    CodeUnit unit;
+    unit.name = name;
+    unit.kind = kind;
+    unit.symbol = symbol;
+    unit.slot_count = slot_count;
+    
+    unit.code.push_back(static_cast<uint8_t>(HEIPOpcode::FRAME_CREATE));
+    unit.code.resize(5);
+    write_u32(&unit.code[1], slot_count);
+    
+    uint32_t base = static_cast<uint32_t>(unit.code.size());
+    unit.code.insert(unit.code.end(), body.begin(), body.end());
+    unit.code.push_back(static_cast<uint8_t>(HEIPOpcode::FRAME_EXIT));
+    
+    shift_branch_targets(unit.code, base, base + body.size(), base);
+    for (const auto& relocation : relocations) {
+        unit.relocations.push_back(relocation);
+        unit.relocations.back().offset += base;
+    }
+    return unit;
+}
+
+// Emit a branch and return its operand offset for later patching
+uint32_t emit_jump(std::vector<uint8_t>& out, HEIPOpcode opcode, uint32_t target = 0) {
+    out.push_back(static_cast<uint8_t>(opcode));
+    uint32_t operand = static_cast<uint32_t>(out.size());
+    out.resize(operand + 4);
+    write_u32(&out[operand], target);
+    return operand;
+}
+
+void patch_jump(std::vector<uint8_t>& out, uint32_t operand, size_t target) {
+    write_u32(&out[operand], static_cast<uint32_t>(target));
+}
+
+// Rebuild `code` without the instructions `drop` selects. Branch targets
+// and relocations follow their instructions; a target that pointed at a
+// dropped instruction moves to the next surviving one.
+template <typename Drop>
+void remove_instructions(std::vector<uint8_t>& code, std::vector<Relocation>& relocations,
+                         Drop drop) {
+    std::vector<uint8_t> kept;
+    std::vector<uint32_t> moved(code.size() + 1, 0);
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) return;
+        bool dropped = drop(pc, inst);
+        for (uint32_t i = 0; i < inst.length; i++) {
+            moved[pc + i] = static_cast<uint32_t>(kept.size()) + (dropped ? 0 : i);
+        }
+        if (!dropped) {
+            kept.insert(kept.end(), code.begin() + pc, code.begin() + pc + inst.length);
+        }
+    }
+    moved[code.size()] = static_cast<uint32_t>(kept.size());
+    
+    for (size_t pc = 0; pc < kept.size(); pc += inst.length) {
+        decode_instruction(kept.data(), kept.size(), pc, inst);
+        if (is_branch(inst.opcode) && inst.operands[0] <= code.size()) {
+            write_u32(&kept[pc + 1], moved[inst.operands[0]]);
+        }
+    }
+    for (auto& relocation : relocations) {
+        relocation.offset = moved[relocation.offset];
+    }
+    code.swap(kept);
+}
+
+// Branch cleanup over body-relative code:
+// - jump threading: a branch into a JMP goes straight to that JMP's target
+// - branch inversion: `Jcc L1; JMP L2; L1:` becomes `J!cc L2`
+// - a JMP to the next instruction, or one no branch reaches right after
+//   another JMP, is removed
+void optimize_branches(std::vector<uint8_t>& code, std::vector<Relocation>& relocations) {
+    std::vector<uint32_t> starts;
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) return;
+        starts.push_back(static_cast<uint32_t>(pc));
+    }
+    
+    auto is_jmp = [&](uint32_t pc) {
+        return pc + 5 <= code.size() && code[pc] == static_cast<uint8_t>(HEIPOpcode::JMP);
+    };
+    
+    std::vector<bool> targeted(code.size() + 1, false);
+    for (uint32_t pc : starts) {
+        decode_instruction(code.data(), code.size(), pc, inst);
+        if (!is_branch(inst.opcode)) continue;
+        uint32_t target = inst.operands[0];
+        for (int hops = 0; hops < 8 && is_jmp(target); hops++) {
+            uint32_t next = read_u32(&code[target + 1]);
+            if (next == target) break;
+            target = next;
+        }
+        write_u32(&code[pc + 1], target);
+        if (target <= code.size()) targeted[target] = true;
+    }
+    
+    std::vector<bool> dead(code.size(), false);
+    bool after_jmp = false;
+    for (size_t i = 0; i < starts.size(); i++) {
+        uint32_t pc = starts[i];
+        decode_instruction(code.data(), code.size(), pc, inst);
+        bool unreachable = after_jmp && !targeted[pc];
+        after_jmp = inst.opcode == HEIPOpcode::JMP && !unreachable &&
+                    inst.operands[0] != pc + inst.length;
         
+        if ((inst.opcode == HEIPOpcode::JZ || inst.opcode == HEIPOpcode::JNZ) &&
+            i + 1 < starts.size()) {
+            uint32_t next = starts[i + 1];
+            if (is_jmp(next) && !targeted[next] && inst.operands[0] == next + 5) {
+                code[pc] = static_cast<uint8_t>(inst.opcode == HEIPOpcode::JZ ?
+                                                HEIPOpcode::JNZ : HEIPOpcode::JZ);
+                write_u32(&code[pc + 1], read_u32(&code[next + 1]));
+                for (auto& relocation : relocations) {
+                    if (relocation.kind == RelocationKind::BRANCH_SITE &&
+                        relocation.offset == pc + 1) {
+                        relocation.inverted = !relocation.inverted;
+                    }
+                }
+                dead[next] = true;
+                i++;
+                continue;
+            }
+        }
+        
+        if (inst.opcode == HEIPOpcode::JMP &&
+            (unreachable || inst.operands[0] == pc + inst.length)) {
+            dead[pc] = true;
+        }
+    }
+    
+    remove_instructions(code, relocations,
+        [&](size_t pc, const DecodedInstruction&) { return dead[pc]; });
+}
+
+// Else (npos if none) and End (instructions.size() if left open) of the If
+// at `index`
+void match_if(const std::vector<std::shared_ptr<Instruction>>& instructions, size_t index,
+              size_t& else_index, size_t& end_index) {
+    else_index = std::string::npos;
+    size_t depth = 0;
+    for (end_index = index + 1; end_index < instructions.size(); end_index++) {
+        InstructionType type = instructions[end_index]->type;
+        if (type == InstructionType::IF || type == InstructionType::WHILE) {
+            depth++;
+        } else if (type == InstructionType::ELSE && depth == 0 &&
+                   else_index == std::string::npos) {
+            else_index = end_index;
+        } else if (type == InstructionType::END) {
+            if (depth == 0) return;
+            depth--;
+        }
+    }
+}
+
+// True if a Break/Continue in [begin, end) targets a loop outside the range
+bool escapes_range(const std::vector<std::shared_ptr<Instruction>>& instructions,
+                   size_t begin, size_t end) {
+    std::vector<InstructionType> open;
+    for (size_t i = begin; i < end; i++) {
+        InstructionType type = instructions[i]->type;
+        if (type == InstructionType::IF || type == InstructionType::WHILE) {
+            open.push_back(type);
+        } else if (type == InstructionType::END && !open.empty()) {
+            open.pop_back();
+        } else if ((type == InstructionType::BREAK || type == InstructionType::CONTINUE) &&
+                   std::find(open.begin(), open.end(), InstructionType::WHILE) == open.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fuse the selected pairs in a unit's code. A pair's second instruction
+// must not be a branch target or an inline site. The fused form takes the
+// first instruction's place and the rest of the pair is dropped.
+uint32_t fuse_superinstructions(std::vector<uint8_t>& code, std::vector<Relocation>& relocations,
+                                const std::vector<FusedPair>& selected) {
+    if (selected.empty()) return 0;
+    
+    std::vector<uint32_t> starts;
+    std::vector<bool> anchored(code.size() + 1, false);
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) return 0;
+        starts.push_back(static_cast<uint32_t>(pc));
+        if (is_branch(inst.opcode) && inst.operands[0] <= code.size()) {
+            anchored[inst.operands[0]] = true;
+        }
+    }
+    for (const auto& relocation : relocations) {
+        if (relocation.kind == RelocationKind::INLINE_SITE && relocation.offset <= code.size()) {
+            anchored[relocation.offset] = true;
+        }
+    }
+    
+    std::vector<bool> padding(code.size(), false);
+    uint32_t fused = 0;
+    for (size_t i = 0; i + 1 < starts.size(); i++) {
+        uint32_t first_pc = starts[i];
+        uint32_t second_pc = starts[i + 1];
+        if (anchored[second_pc]) continue;
+        
+        DecodedInstruction first, second;
+        decode_instruction(code.data(), code.size(), first_pc, first);
+        decode_instruction(code.data(), code.size(), second_pc, second);
+        auto pair = std::find_if(selected.begin(), selected.end(), [&](const FusedPair& p) {
+            return p.first == first.opcode && p.second == second.opcode;
+        });
+        if (pair == selected.end()) continue;
+        if (pair->fused == HEIPOpcode::SLOT_TEE && first.operands[0] != second.operands[0]) {
+            continue;
+        }
+        
+        // Immediates and the first slot are already in place
+        code[first_pc] = static_cast<uint8_t>(pair->fused);
+        uint32_t length = 5;
+        if (pair->fused == HEIPOpcode::SLOT_LOAD2) {
+            write_u32(&code[first_pc + 5], second.operands[0]);
+            length = 9;
+        } else if (is_compare_branch(pair->fused)) {
+            write_u32(&code[first_pc + 1], second.operands[0]);
+            for (auto& relocation : relocations) {
+                if (relocation.offset == second_pc + 1) relocation.offset = first_pc + 1;
+            }
+        }
+        for (uint32_t pc = first_pc + length; pc < second_pc + second.length; pc++) {
+            code[pc] = static_cast<uint8_t>(HEIPOpcode::NOP);
+            padding[pc] = true;
+        }
+        fused++;
+        i++;
+    }
+    
+    remove_instructions(code, relocations,
+        [&](size_t pc, const DecodedInstruction&) { return padding[pc]; });
+    return fused;
+}
+
+// Turn each CALL whose next step is the unit's exit, directly or through
+// JMPs, into a TAILCALL. Both are 5 bytes, so nothing moves.
+uint32_t mark_tail_calls(std::vector<uint8_t>& code) {
+    auto exits_at = [&code](size_t pc) {
+        DecodedInstruction inst;
+        for (size_t hops = 0; hops < code.size() &&
+                              decode_instruction(code.data(), code.size(), pc, inst); hops++) {
+            if (inst.opcode == HEIPOpcode::FRAME_EXIT || inst.opcode == HEIPOpcode::RET) {
+                return true;
+            }
+            if (inst.opcode == HEIPOpcode::NOP) {
+                pc += inst.length;
+            } else if (inst.opcode == HEIPOpcode::JMP) {
+                pc = inst.operands[0];
+            } else {
+                return false;
+            }
+        }
         return false;
+    };
+    
+    uint32_t marked = 0;
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) break;
+        if (inst.opcode == HEIPOpcode::CALL && exits_at(pc + inst.length)) {
+            code[pc] = static_cast<uint8_t>(HEIPOpcode::TAILCALL);
+            marked++;
+        }
+    }
+    return marked;
+}
+
+// Rewrite loads, slot accesses and immediates whose operands fit a byte in
+// their compact forms. Branch, call and string operands keep 4 bytes: the
+// linker and relocations patch those in place.
+uint32_t compact_operands(std::vector<uint8_t>& code, std::vector<Relocation>& relocations) {
+    std::vector<bool> padding(code.size(), false);
+    uint32_t compacted = 0;
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) return 0;
+        HEIPOpcode compact;
+        if (!compact_form(inst.opcode, compact) || !compact_fits(compact, inst)) continue;
+        
+        code[pc] = static_cast<uint8_t>(compact);
+        for (uint8_t i = 0; i < inst.operand_count; i++) {
+            code[pc + 1 + i] = static_cast<uint8_t>(inst.operands[i]);
+        }
+        for (size_t at = pc + 1 + inst.operand_count; at < pc + inst.length; at++) {
+            code[at] = static_cast<uint8_t>(HEIPOpcode::NOP);
+            padding[at] = true;
+        }
+        compacted++;
+    }
+    
+    if (compacted > 0) {
+        remove_instructions(code, relocations,
+            [&](size_t pc, const DecodedInstruction&) { return padding[pc]; });
     }
+    return compacted;
 }
 
+} // namespace
+
 std::vector<std::shared_ptr<Instruction>> DodecaCompiler::parse_instructions(
     const std::string& source) {
     
     std::vector<std::shared_ptr<Instruction>> instructions;
     std::istringstream stream(source);
     std::string line;
-    uint32_t range_pos = 0;
+    uint32_t line_number = 0;
     
     while (std::getline(stream, line)) {
-    // Skip empty lines and comments
-      if (line.empty() || line[0] == '#') continue;
+        line_number++;
+        std::vector<std::string> tokens = tokenize_line(line);
+        
+        // Skip empty lines and comments
+        if (tokens.empty()) continue;
         
         auto inst = std::make_shared<Instruction>();
-        inst->range_start = range_pos;
-        
-      // Parse instruction type and name
-        std::istringstream line_stream(line);
-        std::string type_keyword;
-        line_stream >> type_keyword;
-   
-     // Map keywords to instruction types
-        if (type_keyword == "Instruct" || type_keyword == "instruct") {
-inst->type = InstructionType::INSTRUCT;
-        } else if (type_keyword == "Guide" || type_keyword == "guide") {
-       inst->type = InstructionType::GUIDE;
-        } else if (type_keyword == "State" || type_keyword == "state") {
-      inst->type = InstructionType::STATE;
-        } else if (type_keyword == "Protocol" || type_keyword == "protocol") {
-         inst->type = InstructionType::PROTOCOL;
-} else if (type_keyword == "Bubble" || type_keyword == "bubble") {
+        inst->type = InstructionType::INSTRUCT;
+        inst->range_start = line_number;
+        inst->range_end = line_number;
+        
+        const std::string& keyword = tokens[0];
+        std::string lower = to_lower(keyword);
+        size_t name_index = 1;
+        
+        // Map keywords to instruction types
+        if (lower == "instruct") {
+            inst->type = InstructionType::INSTRUCT;
+        } else if (lower == "guide") {
+            inst->type = InstructionType::GUIDE;
+        } else if (lower == "state") {
+            inst->type = InstructionType::STATE;
+        } else if (lower == "protocol") {
+            inst->type = InstructionType::PROTOCOL;
+        } else if (lower == "bubble") {
             inst->type = InstructionType::BUBBLE;
-        } else if (type_keyword == "Chain" || type_keyword == "chain") {
-inst->type = InstructionType::CHAIN;
-  } else if (type_keyword == "Franchise" || type_keyword == "franchise") {
+        } else if (lower == "chain") {
+            inst->type = InstructionType::CHAIN;
+        } else if (lower == "case") {
+            inst->type = InstructionType::CASE;
+        } else if (lower == "franchise" || lower == "frame") {
+            // Frames group protocols the same way franchises do
             inst->type = InstructionType::FRANCHISE;
+        } else if (lower == "range") {
+            inst->type = InstructionType::RANGE;
+        } else if (lower == "overlay") {
+            inst->type = InstructionType::OVERLAY;
+        } else if (lower == "superlative") {
+            inst->type = InstructionType::SUPERLATIVE;
+        } else if (lower == "end") {
+            inst->type = InstructionType::END;
+        } else if (lower == "if") {
+            inst->type = InstructionType::IF;
+        } else if (lower == "else") {
+            inst->type = InstructionType::ELSE;
+        } else if (lower == "while") {
+            inst->type = InstructionType::WHILE;
+        } else if (lower == "break") {
+            inst->type = InstructionType::BREAK;
+        } else if (lower == "continue") {
+            inst->type = InstructionType::CONTINUE;
+        } else if (lower == "help") {
+            // `HELP Heal ...` -> help_heal; trailing words are annotations
+            inst->name = "help_" + (tokens.size() > 1 ? to_lower(tokens[1]) : std::string("heal"));
+            instructions.push_back(inst);
+            continue;
+        } else if (keyword.back() == ':' && tokens.size() == 2 &&
+                   dodeca_utils::is_valid_symbol(keyword.substr(0, keyword.size() - 1))) {
+            // Explicit symbol binding: `a: MathOperations.multiply`
+            inst->type = InstructionType::OVERLAY;
+            inst->name = keyword.substr(0, keyword.size() - 1);
+            inst->params.push_back(tokens[1]);
+            instructions.push_back(inst);
+            continue;
+        } else if (lower == "push" || is_literal_token(keyword)) {
+            // Container element line; values follow `push` or stand alone
+            inst->type = InstructionType::ELEMENT;
+            inst->params.assign(tokens.begin() + (lower == "push" ? 1 : 0), tokens.end());
+            instructions.push_back(inst);
+            continue;
+        } else if (tokens.size() == 1) {
+            // A bare symbol or overlay keyword runs whatever it names
+            inst->type = InstructionType::GUIDE;
+            inst->name = "call";
+            inst->params.push_back(keyword);
+            instructions.push_back(inst);
+            continue;
         } else {
-        // Try to find overlay symbol
-            if (type_keyword.length() == 1 && dodeca_utils::is_valid_symbol(type_keyword[0])) {
-      inst->type = InstructionType::OVERLAY;
-            inst->overlay_ref = dodeca_map_.decompress(type_keyword[0]);
-     }
- }
+            // Attribute lines (`Traced true`) and plain instructions
+            inst->name = lower;
+            name_index = 0;
+            inst->params.assign(tokens.begin() + 1, tokens.end());
+            instructions.push_back(inst);
+            continue;
+        }
         
         // Parse name and parameters
-        line_stream >> inst->name;
-        std::string param;
-        while (line_stream >> param) {
-            inst->params.push_back(param);
-     }
-        
-        inst->range_end = ++range_pos;
-  instructions.push_back(inst);
- }
+        if (name_index < tokens.size()) inst->name = tokens[name_index];
+        for (size_t i = name_index + 1; i < tokens.size(); i++) {
+            inst->params.push_back(tokens[i]);
+        }
+        
+        instructions.push_back(inst);
+    }
     
     return instructions;
 }
@@ -148,59 +811,1093 @@ inst->type = InstructionType::CHAIN;
 std::vector<std::shared_ptr<Protocol>> DodecaCompiler::build_protocols(
     const std::vector<std::shared_ptr<Instruction>>& instructions) {
     
-    std::vector<std::shared_ptr<Protocol>> protocols;
-    std::shared_ptr<Protocol> current_protocol = nullptr;
+    // Top-level statements form the synthesized entry unit
+    auto main_unit = std::make_shared<Protocol>();
+    main_unit->name = kMainUnitName;
+    main_unit->kind = InstructionType::PROTOCOL;
+    main_unit->range_scope = 0;
+    std::vector<std::shared_ptr<Protocol>> protocols{main_unit};
+    
+    // Open blocks. Franchises only extend the scope; Protocol, Range and
+    // Overlay blocks own a unit; If/While stay in their unit's instruction
+    // list and get an explicit End; Superlative blocks list their candidates.
+    struct Block {
+        InstructionType type;
+        std::string scope;
+        std::shared_ptr<Protocol> unit;
+    };
+    std::vector<Block> blocks;
     
     for (const auto& inst : instructions) {
-  if (inst->type == InstructionType::PROTOCOL) {
-   // Start new protocol
-            current_protocol = std::make_shared<Protocol>();
-            current_protocol->name = inst->name;
-      protocols.push_back(current_protocol);
-        } else if (current_protocol) {
-        // Add instruction to current protocol
-            current_protocol->instructions.push_back(inst);
-   }
+        std::string scope = blocks.empty() ? std::string() : blocks.back().scope;
+        std::shared_ptr<Protocol> unit = blocks.empty() ? main_unit : blocks.back().unit;
+        
+        if (!blocks.empty() && blocks.back().type == InstructionType::SUPERLATIVE) {
+            // Each body line names a candidate the way a Guide line does
+            if (inst->type == InstructionType::END) {
+                blocks.pop_back();
+            } else if (inst->type == InstructionType::GUIDE) {
+                superlatives_.back().targets.push_back(guide_target(*inst));
+            } else {
+                log_forensic_event("Superlative line ignored: " + inst->name);
+            }
+            continue;
+        }
+        
+        switch (inst->type) {
+            case InstructionType::FRANCHISE:
+                blocks.push_back(Block{inst->type, qualify(scope, inst->name), unit});
+                break;
+            
+            case InstructionType::OVERLAY:
+                if (!inst->params.empty()) {
+                    // Symbol binding, resolved when the image is linked
+                    DodecaSymbol symbol;
+                    dodeca_utils::parse_symbol(inst->name, symbol);
+                    if (symbol >= symbol_aliases_.size()) symbol_aliases_.resize(symbol + 1);
+                    symbol_aliases_[symbol] = inst->params[0];
+                    break;
+                }
+                // An Overlay block compiles like a protocol
+                // fall through
+            case InstructionType::PROTOCOL:
+            case InstructionType::RANGE: {
+                auto protocol = std::make_shared<Protocol>();
+                // Overlay keywords are global; protocols live in their franchise
+                protocol->name = inst->type == InstructionType::OVERLAY ?
+                    inst->name : qualify(scope, inst->name);
+                protocol->kind = inst->type;
+                protocol->scope = scope;
+                protocol->range_scope = inst->range_start;
+                protocols.push_back(protocol);
+                if (inst->type != InstructionType::OVERLAY) {
+                    protocol_index_[protocol->name] = protocol;
+                }
+                blocks.push_back(Block{inst->type, scope, protocol});
+                break;
+            }
+            
+            case InstructionType::SUPERLATIVE:
+                superlative_index_[qualify(scope, inst->name)] = superlatives_.size();
+                superlatives_.push_back(SuperlativeDecl{qualify(scope, inst->name), scope,
+                                                        {}, {}, kNoSuperlative});
+                blocks.push_back(Block{inst->type, scope, nullptr});
+                break;
+            
+            case InstructionType::IF:
+            case InstructionType::WHILE:
+                unit->instructions.push_back(inst);
+                blocks.push_back(Block{inst->type, scope, unit});
+                break;
+            
+            case InstructionType::END:
+                // A stray End (e.g. after a top-level State's attribute
+                // lines) closes nothing
+                if (blocks.empty()) break;
+                if (blocks.back().type == InstructionType::IF ||
+                    blocks.back().type == InstructionType::WHILE) {
+                    unit->instructions.push_back(inst);
+                }
+                blocks.pop_back();
+                break;
+            
+            default:
+                if (inst->type == InstructionType::STATE) {
+                    unit->state_variables[inst->name] =
+                        inst->params.size() >= 2 ? inst->params[1] : std::string();
+                }
+                unit->instructions.push_back(inst);
+                break;
+        }
     }
     
     return protocols;
 }
 
-std::vector<uint8_t> DodecaCompiler::generate_bytecode(
-    const std::vector<std::shared_ptr<Protocol>>& protocols) {
+void DodecaCompiler::prepare_units() {
+    // Starts over if an earlier attempt stopped partway
+    dodeca_map_ = DodecaMap();
+    next_symbol_ = 0;
+    call_sites_.clear();
+    compiled_overlays_.clear();
+    artifacts_.overlays.clear();
+    artifacts_.overlay_bodies.clear();
+    
+    // Register every overlay up front so use sites anywhere can resolve it
+    const auto& protocols = artifacts_.protocols;
+    for (const auto& protocol : protocols) {
+        if (protocol->kind != InstructionType::OVERLAY) continue;
+        register_overlay(protocol->name, std::vector<uint8_t>());
+        artifacts_.overlays.push_back(dodeca_map_.decompress(dodeca_map_.compress(protocol->name)));
+        artifacts_.overlay_bodies.push_back(protocol);
+    }
     
-    std::vector<uint8_t> bytecode;
+    // Superlative candidates are protocols; overlays have no frame of
+    // their own to time
+    uint32_t next_superlative = 0;
+    for (auto& superlative : superlatives_) {
+        superlative.candidates.clear();
+        for (const auto& name : superlative.targets) {
+            GuideTarget target;
+            if (!resolve_guide(name, superlative.scope, target) || target.protocol.empty()) {
+                log_forensic_event("Superlative candidate dropped: " + name);
+                continue;
+            }
+            superlative.candidates.push_back(target.protocol);
+        }
+        superlative.id = superlative.candidates.empty() ? kNoSuperlative : next_superlative++;
+    }
     
+    // Count expansion and call sites for the inlining heuristics
     for (const auto& protocol : protocols) {
-     // Emit protocol header
-        emit_opcode(bytecode, HEIPOpcode::FRAME_CREATE);
-        
         for (const auto& inst : protocol->instructions) {
-        // Check if instruction uses overlay compression
-            if (inst->overlay_ref) {
-     emit_opcode(bytecode, HEIPOpcode::OVERLAY_EXPAND);
-     bytecode.insert(bytecode.end(), 
-                 inst->overlay_ref->compressed_bytecode.begin(),
-           inst->overlay_ref->compressed_bytecode.end());
-          } else {
-       // Map instruction to opcode
-  HEIPOpcode opcode = map_to_opcode(inst->name);
- emit_opcode(bytecode, opcode);
-      
-    // Emit parameters
-       for (const auto& param : inst->params) {
-  // Simplified: emit parameter as string length + data
-        emit_operand(bytecode, static_cast<uint32_t>(param.size()));
-             bytecode.insert(bytecode.end(), param.begin(), param.end());
-     }
+            GuideTarget target;
+            if (inst->type != InstructionType::GUIDE ||
+                !resolve_guide(guide_target(*inst), protocol->scope, target)) {
+                continue;
+            }
+            if (target.overlay) {
+                target.overlay->use_count++;
+            } else if (!target.superlative.empty()) {
+                for (const auto& candidate :
+                     superlatives_[superlative_index_[target.superlative]].candidates) {
+                    call_sites_[candidate]++;
+                }
+            } else {
+                call_sites_[target.protocol]++;
+            }
         }
+    }
+    artifacts_.prepared = true;
+}
+
+void DodecaCompiler::generate_units() {
+    if (!artifacts_.prepared) prepare_units();
+    
+    // Overlay bodies are compiled exactly once, in definition order
+    for (; artifacts_.overlays_done < artifacts_.overlays.size(); artifacts_.overlays_done++) {
+        Overlay& overlay = *artifacts_.overlays[artifacts_.overlays_done];
+        const Protocol& protocol = *artifacts_.overlay_bodies[artifacts_.overlays_done];
+        
+        CodegenContext ctx{protocol.name, protocol.scope, {}, 0, {}, {}, {}, 0, {}};
+        overlay.compressed_bytecode = compile_body(protocol, ctx);
+        overlay.slot_count = ctx.slot_count;
+        overlay.relocations = ctx.relocations;
+        overlay.original_size = overlay.compressed_bytecode.size();
+        overlay.compressed_size = kOverlayExpandBytes;
+        compiled_overlays_.insert(&overlay);
+    }
+    
+    // Protocols, ranges and the synthesized entry unit. Callees are compiled
+    // on demand so their bodies exist when a call site considers inlining.
+    inline_calls_ = optimization_level_ >= 2;
+    const auto& protocols = artifacts_.protocols;
+    for (; artifacts_.protocols_done < protocols.size(); artifacts_.protocols_done++) {
+        const Protocol& protocol = *protocols[artifacts_.protocols_done];
+        if (protocol.kind == InstructionType::OVERLAY) continue;
+        CodeUnit unit = compile_unit(protocol);
+        if (help_enabled_) {
+            apply_help_optimizations(unit);
         }
- 
-    // Emit protocol footer
-        emit_opcode(bytecode, HEIPOpcode::FRAME_EXIT);
+        artifacts_.units.push_back(std::move(unit));
+    }
+}
+
+std::vector<uint8_t> DodecaCompiler::link_program() {
+    std::vector<CodeUnit> units = artifacts_.units;
+    
+    // One shared body per overlay that some site expands at runtime
+    for (const auto& overlay : artifacts_.overlays) {
+        if (!overlay->expanded_shared) continue;
+        units.push_back(make_frame_unit(overlay->name, UnitKind::OVERLAY, overlay->symbol,
+                                        overlay->compressed_bytecode, overlay->slot_count,
+                                        overlay->relocations));
+    }
+    
+    // Superinstructions for the opcode pairs the profile saw run most
+    uint32_t fused = 0;
+    if (const ExecutionProfile* profile = active_profile()) {
+        std::vector<FusedPair> selected;
+        for (const FusedPair& pair : kFusedPairs) {
+            uint8_t first = static_cast<uint8_t>(pair.first);
+            uint64_t count = profile->pair(first, static_cast<uint8_t>(pair.second));
+            if (is_compare_branch(pair.fused)) {
+                // Block layout may have flipped the branch since the profile
+                count = profile->pair(first, static_cast<uint8_t>(HEIPOpcode::JZ)) +
+                        profile->pair(first, static_cast<uint8_t>(HEIPOpcode::JNZ));
+            }
+            if (count > 0 && count * kFusePairShare >= profile->total_pairs()) {
+                selected.push_back(pair);
+                const char* name = opcode_info(static_cast<uint8_t>(pair.fused))->name;
+                help_context_.adapt_optimization(std::string("superinstruction_") + name);
+            }
+        }
+        for (auto& unit : units) {
+            fused += fuse_superinstructions(unit.code, unit.relocations, selected);
+        }
+    }
+    
+    // The entry unit's frame is the root, which a tail call cannot reuse
+    uint32_t tail_calls = 0;
+    for (auto& unit : units) {
+        if (unit.kind != UnitKind::MAIN) tail_calls += mark_tail_calls(unit.code);
+    }
+    
+    // Last, so every pass before sees one operand width
+    uint32_t compacted = 0;
+    for (auto& unit : units) {
+        compacted += compact_operands(unit.code, unit.relocations);
     }
     
-    return bytecode;
+    layout_units(units);
+    std::vector<uint8_t> image = link_units(units);
+    optimizer_stats_.superinstructions += fused;
+    optimizer_stats_.tail_calls += tail_calls;
+    optimizer_stats_.operands_compacted += compacted;
+    return image;
+}
+
+void DodecaCompiler::layout_units(std::vector<CodeUnit>& units) {
+    // The entry unit leads, hot units follow hottest first and cold ones
+    // keep their source order at the end of the image, away from the
+    // pages and cache lines the program actually runs in
+    std::vector<std::pair<uint64_t, size_t>> hot;
+    std::vector<size_t> cold;
+    std::vector<CodeUnit> ordered;
+    for (size_t i = 0; i < units.size(); i++) {
+        if (units[i].kind == UnitKind::MAIN) {
+            ordered.push_back(std::move(units[i]));
+            continue;
+        }
+        uint64_t heat = unit_heat(units[i]);
+        if (heat >= kHotUnitHeat) {
+            hot.push_back(std::make_pair(heat, i));
+        } else {
+            cold.push_back(i);
+        }
+    }
+    std::stable_sort(hot.begin(), hot.end(),
+                     [](const std::pair<uint64_t, size_t>& a,
+                        const std::pair<uint64_t, size_t>& b) { return a.first > b.first; });
+    
+    for (const auto& unit : hot) ordered.push_back(std::move(units[unit.second]));
+    for (size_t index : cold) ordered.push_back(std::move(units[index]));
+    units.swap(ordered);
+    
+    optimizer_stats_.cold_units = static_cast<uint32_t>(cold.size());
+    if (!cold.empty()) help_context_.adapt_optimization("hot_cold_layout");
+}
+
+uint64_t DodecaCompiler::unit_heat(const CodeUnit& unit) const {
+    if (const ExecutionProfile* profile = active_profile()) {
+        return profile->calls(unit.name) + profile->branch_samples(unit.name);
+    }
+    auto found = call_weights_.find(unit.name);
+    uint64_t heat = found != call_weights_.end() ? found->second : 0;
+    return has_back_edge(unit.code) ? heat * kLoopCallWeight : heat;
+}
+
+CodeUnit DodecaCompiler::compile_unit(const Protocol& protocol) {
+    const CompiledBody* body = protocol_body(protocol);
+    if (!body) throw std::runtime_error("Protocol compiled recursively: " + protocol.name);
+    
+    UnitKind kind = protocol.name == kMainUnitName ? UnitKind::MAIN : UnitKind::PROTOCOL;
+    return make_frame_unit(protocol.name, kind, kInvalidSymbol, body->code, body->slot_count,
+                           body->relocations);
+}
+
+const DodecaCompiler::CompiledBody* DodecaCompiler::protocol_body(const Protocol& protocol) {
+    auto found = protocol_bodies_.find(protocol.name);
+    if (found != protocol_bodies_.end()) {
+        return found->second.compiling ? nullptr : &found->second;
+    }
+    
+    CompiledBody& body = protocol_bodies_[protocol.name];
+    body.compiling = true;
+    CodegenContext ctx{protocol.name, protocol.scope, {}, 0, {}, {}, {}, 0, {}};
+    body.code = compile_body(protocol, ctx);
+    body.slot_count = ctx.slot_count;
+    body.relocations.swap(ctx.relocations);
+    body.compiling = false;
+    body.leaf = analyze_leaf(body.code, body.may_fault);
+    return &body;
+}
+
+bool DodecaCompiler::should_inline(const std::string& name, const CompiledBody& callee,
+                                   const CodegenContext& ctx) const {
+    // Small leaves anywhere, larger ones at their only call site; call
+    // sites inside loops run often enough to afford more
+    auto sites = call_sites_.find(name);
+    size_t budget = sites != call_sites_.end() && sites->second == 1 ?
+                    kInlineSingleCallBytes : kInlineBytes;
+    budget <<= std::min<size_t>(ctx.loop_depth, kInlineLoopBoost);
+    
+    // Measured call counts beat the static guess
+    if (const ExecutionProfile* profile = active_profile()) {
+        if (hot_protocol(name)) {
+            budget <<= kHotInlineBoost;
+        } else if (profile->calls(name) == 0) {
+            budget = kInlineBytes;
+        }
+    }
+    return callee.leaf && callee.code.size() <= budget;
+}
+
+bool DodecaCompiler::hot_protocol(const std::string& name) const {
+    const ExecutionProfile* profile = active_profile();
+    if (!profile) return false;
+    uint64_t calls = profile->calls(name);
+    return calls > 0 && calls * kHotCallShare >= profile->total_calls();
+}
+
+const ExecutionProfile* DodecaCompiler::active_profile() const {
+    // Profile guidance is part of HELP and off with --no-help
+    const ExecutionProfile* profile = help_context_.profile.get();
+    return help_enabled_ && profile && !profile->empty() ? profile : nullptr;
+}
+
+bool DodecaCompiler::load_profile(const std::string& path) {
+    auto profile = std::make_shared<ExecutionProfile>();
+    if (!profile->load(path)) return false;
+    set_profile(profile);
+    return true;
+}
+
+void DodecaCompiler::set_profile(std::shared_ptr<const ExecutionProfile> profile) {
+    help_context_.profile = profile;
+    if (profile) help_context_.adapt_optimization("profile_guided");
+}
+
+std::vector<uint8_t> DodecaCompiler::compile_body(const Protocol& protocol, CodegenContext& ctx) {
+    std::vector<uint8_t> body;
+    try {
+        emit_instructions(protocol.instructions, ctx, body);
+        
+        // Cold arms go after the hot path, which jumps over them to the end;
+        // each jumps back to the end of its If. Arms can add more cold arms.
+        if (!ctx.cold_regions.empty()) {
+            uint32_t exit_patch = emit_jump(body, HEIPOpcode::JMP);
+            for (size_t i = 0; i < ctx.cold_regions.size(); i++) {
+                patch_jump(body, ctx.cold_regions[i].entry_patch, body.size());
+                auto instructions = ctx.cold_regions[i].instructions;
+                emit_instructions(instructions, ctx, body);
+                emit_jump(body, HEIPOpcode::JMP, ctx.cold_regions[i].resume);
+            }
+            patch_jump(body, exit_patch, body.size());
+        }
+        
+        if (optimization_level_ > 0 && !unoptimized_bodies_.count(protocol.name)) {
+            // A body the optimizer can't lower is kept as generated
+            bool slots_live_at_exit = protocol.name == kMainUnitName;
+            if (!optimize_ssa(body, ctx.relocations, ctx.slot_count, slots_live_at_exit,
+                              optimization_level_, optimizer_stats_)) {
+                log_forensic_event("Optimizer skipped " + protocol.name);
+            }
+            optimize_branches(body, ctx.relocations);
+        }
+    } catch (const std::exception&) {
+        // Callers rethrow too; the innermost body is the one that failed
+        if (failing_body_.empty()) failing_body_ = protocol.name;
+        throw;
+    }
+    return body;
+}
+
+void DodecaCompiler::emit_instructions(
+    const std::vector<std::shared_ptr<Instruction>>& instructions,
+    CodegenContext& ctx, std::vector<uint8_t>& out) {
+    
+    // Open If/While blocks. Branch operands are body-relative and patched
+    // once their target is known.
+    struct ControlBlock {
+        InstructionType type;
+        const Instruction* header;
+        uint32_t false_patch;                   // If: JZ past the then-branch
+        uint32_t loop_top;                      // While: first body instruction
+        std::vector<uint32_t> exit_patches;     // If: JMP over Else; While: Break
+        std::vector<uint32_t> continue_patches;
+        bool has_else;
+        int32_t cold_region;                    // If: arm in ctx.cold_regions, or -1
+        size_t skip_to;                         // If: End to skip to from a cold Else
+    };
+    std::vector<ControlBlock> control;
+    
+    // Conditional branches are profile sites, keyed by their If/While line
+    auto mark_branch = [&](const Instruction& header, uint32_t operand, bool inverted) {
+        ctx.relocations.push_back(Relocation{operand, ctx.unit, RelocationKind::BRANCH_SITE,
+                                             header.range_start, inverted});
+    };
+    
+    auto close_block = [&](ControlBlock& block) {
+        size_t here = out.size();
+        if (block.type == InstructionType::IF) {
+            if (!block.has_else) patch_jump(out, block.false_patch, here);
+            for (uint32_t patch : block.exit_patches) patch_jump(out, patch, here);
+            if (block.cold_region >= 0) {
+                ctx.cold_regions[block.cold_region].resume = static_cast<uint32_t>(here);
+            }
+            return;
+        }
+        
+        // Rotated loop: the test at the bottom jumps back to the top, so an
+        // iteration costs one taken branch
+        ctx.loop_depth--;
+        for (uint32_t patch : block.continue_patches) patch_jump(out, patch, here);
+        emit_condition(*block.header, ctx, out);
+        mark_branch(*block.header, emit_jump(out, HEIPOpcode::JNZ, block.loop_top), false);
+        for (uint32_t patch : block.exit_patches) patch_jump(out, patch, out.size());
+    };
+    
+    const ExecutionProfile* profile = active_profile();
+    
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction& inst = *instructions[i];
+        
+        switch (inst.type) {
+            case InstructionType::IF: {
+                emit_condition(inst, ctx, out);
+                ControlBlock block{inst.type, &inst, 0, 0, {}, {}, false, -1, 0};
+                
+                // With a profile, an arm that rarely runs is laid out after
+                // the hot path so the likely arm falls through. Arms with a
+                // Break/Continue out of them stay in place.
+                size_t else_index, end_index;
+                match_if(instructions, i, else_index, end_index);
+                bool has_else = else_index != std::string::npos;
+                size_t then_end = has_else ? else_index : end_index;
+                const BranchCounts* counts = profile ?
+                    profile->branch(ctx.unit, inst.range_start) : nullptr;
+                uint64_t samples = counts ? counts->true_count + counts->false_count : 0;
+                bool profiled = samples >= kMinBranchSamples;
+                bool cold_then = profiled && counts->true_count * kColdArmShare < samples &&
+                                 then_end > i + 1 && !escapes_range(instructions, i + 1, then_end);
+                bool cold_else = !cold_then && profiled && has_else &&
+                                 counts->false_count * kColdArmShare < samples &&
+                                 end_index > else_index + 1 &&
+                                 !escapes_range(instructions, else_index + 1, end_index);
+                auto move_arm = [&](size_t begin, size_t end, uint32_t entry_patch) {
+                    block.cold_region = static_cast<int32_t>(ctx.cold_regions.size());
+                    ctx.cold_regions.push_back(ColdRegion{
+                        {instructions.begin() + begin, instructions.begin() + end}, entry_patch, 0});
+                };
+                
+                if (cold_then) {
+                    uint32_t patch = emit_jump(out, HEIPOpcode::JNZ);
+                    mark_branch(inst, patch, false);
+                    move_arm(i + 1, then_end, patch);
+                    block.has_else = true;
+                    i = has_else ? else_index : end_index - 1;
+                } else {
+                    block.false_patch = emit_jump(out, HEIPOpcode::JZ);
+                    mark_branch(inst, block.false_patch, true);
+                    if (cold_else) {
+                        move_arm(else_index + 1, end_index, block.false_patch);
+                        block.skip_to = end_index;
+                    }
+                }
+                if (block.cold_region >= 0) {
+                    optimizer_stats_.cold_blocks_moved++;
+                    help_context_.adapt_optimization("profile_block_layout");
+                }
+                control.push_back(block);
+                break;
+            }
+            
+            case InstructionType::ELSE: {
+                if (control.empty() || control.back().type != InstructionType::IF ||
+                    control.back().has_else) {
+                    log_forensic_event("Else without If dropped");
+                    break;
+                }
+                ControlBlock& block = control.back();
+                if (block.skip_to) {
+                    // The Else arm is emitted out of line
+                    block.has_else = true;
+                    i = block.skip_to - 1;
+                    break;
+                }
+                block.exit_patches.push_back(emit_jump(out, HEIPOpcode::JMP));
+                patch_jump(out, block.false_patch, out.size());
+                block.has_else = true;
+                break;
+            }
+            
+            case InstructionType::WHILE: {
+                // The entry test is a copy of the bottom test
+                emit_condition(inst, ctx, out);
+                ControlBlock block{inst.type, &inst, 0, 0, {}, {}, false, -1, 0};
+                block.exit_patches.push_back(emit_jump(out, HEIPOpcode::JZ));
+                mark_branch(inst, block.exit_patches.back(), true);
+                block.loop_top = static_cast<uint32_t>(out.size());
+                control.push_back(block);
+                ctx.loop_depth++;
+                break;
+            }
+            
+            case InstructionType::BREAK:
+            case InstructionType::CONTINUE: {
+                auto loop = std::find_if(control.rbegin(), control.rend(),
+                    [](const ControlBlock& block) { return block.type == InstructionType::WHILE; });
+                if (loop == control.rend()) {
+                    log_forensic_event("Break/Continue outside While dropped");
+                    break;
+                }
+                uint32_t patch = emit_jump(out, HEIPOpcode::JMP);
+                if (inst.type == InstructionType::BREAK) {
+                    loop->exit_patches.push_back(patch);
+                } else {
+                    loop->continue_patches.push_back(patch);
+                }
+                break;
+            }
+            
+            case InstructionType::END:
+                if (!control.empty()) {
+                    close_block(control.back());
+                    control.pop_back();
+                }
+                break;
+            
+            case InstructionType::STATE: {
+                // `State x = <value>` initializes a frame slot; `State x` zeroes it
+                uint32_t slot = slot_for(inst.name, ctx);
+                if (inst.params.size() >= 2 && inst.params[0] == "=") {
+                    emit_value(inst.params[1], ctx, out);
+                } else {
+                    emit_opcode(out, HEIPOpcode::LOAD);
+                    emit_operand(out, 0);
+                }
+                emit_opcode(out, HEIPOpcode::SLOT_STORE);
+                emit_operand(out, slot);
+                break;
+            }
+            
+            case InstructionType::BUBBLE:
+            case InstructionType::CHAIN:
+            case InstructionType::CASE: {
+                // Element lines directly after a declaration populate it
+                std::vector<std::string> values;
+                size_t next = i + 1;
+                while (next < instructions.size() &&
+                       instructions[next]->type == InstructionType::ELEMENT) {
+                    const auto& params = instructions[next]->params;
+                    values.insert(values.end(), params.begin(), params.end());
+                    next++;
+                }
+                i = next - 1;
+                
+                uint32_t slot = slot_for(inst.name, ctx);
+                uint32_t count = static_cast<uint32_t>(values.size());
+                
+                if (inst.type == InstructionType::CHAIN) {
+                    // Chains are built in one step from their elements
+                    for (const auto& value : values) emit_value(value, ctx, out);
+                    emit_opcode(out, HEIPOpcode::CHAIN_NEW);
+                    emit_operand(out, count);
+                    emit_opcode(out, HEIPOpcode::SLOT_STORE);
+                    emit_operand(out, slot);
+                    break;
+                }
+                
+                ObjectKind kind = inst.type == InstructionType::BUBBLE ?
+                    ObjectKind::BUBBLE : ObjectKind::CASE;
+                uint32_t capacity = count;
+                uint32_t declared;
+                if (!inst.params.empty() && parse_literal(inst.params[0], declared)) {
+                    capacity = std::max(capacity, declared);
+                }
+                
+                emit_opcode(out, HEIPOpcode::ALLOC);
+                out.push_back(static_cast<uint8_t>(kind));
+                emit_operand(out, capacity);
+                emit_opcode(out, HEIPOpcode::SLOT_STORE);
+                emit_operand(out, slot);
+                
+                for (uint32_t index = 0; index < count; index++) {
+                    emit_opcode(out, HEIPOpcode::SLOT_LOAD);
+                    emit_operand(out, slot);
+                    if (kind == ObjectKind::BUBBLE) {
+                        emit_value(values[index], ctx, out);
+                        emit_opcode(out, HEIPOpcode::BUBBLE_PUSH);
+                    } else {
+                        emit_opcode(out, HEIPOpcode::LOAD);
+                        emit_operand(out, index);
+                        emit_value(values[index], ctx, out);
+                        emit_opcode(out, HEIPOpcode::ELEM_STORE);
+                    }
+                }
+                break;
+            }
+            
+            case InstructionType::ELEMENT:
+                // Outside a container declaration an element line pushes its values
+                for (const auto& value : inst.params) emit_value(value, ctx, out);
+                break;
+            
+            case InstructionType::GUIDE:
+                emit_guide(guide_target(inst), ctx, out);
+                break;
+            
+            case InstructionType::INSTRUCT:
+                emit_instruct(inst, ctx, out);
+                break;
+            
+            default:
+                break;
+        }
+    }
+    
+    // Blocks left open at the end of the unit close there
+    while (!control.empty()) {
+        close_block(control.back());
+        control.pop_back();
+    }
+}
+
+void DodecaCompiler::emit_condition(const Instruction& inst, CodegenContext& ctx,
+                                    std::vector<uint8_t>& out) {
+    // `If x` tests x != 0; `If a <op> b` compares signed
+    static const std::unordered_map<std::string, HEIPOpcode> relations = {
+        {"==", HEIPOpcode::CMP_EQ}, {"!=", HEIPOpcode::CMP_NE},
+        {"<", HEIPOpcode::CMP_LT}, {"<=", HEIPOpcode::CMP_LE},
+        {">", HEIPOpcode::CMP_GT}, {">=", HEIPOpcode::CMP_GE},
+    };
+    
+    if (inst.name.empty()) {
+        throw std::runtime_error("Missing condition on line " + std::to_string(inst.range_start));
+    }
+    emit_value(inst.name, ctx, out);
+    if (inst.params.empty()) return;
+    
+    auto relation = relations.find(inst.params[0]);
+    if (relation == relations.end() || inst.params.size() != 2) {
+        throw std::runtime_error("Malformed condition on line " +
+                                 std::to_string(inst.range_start));
+    }
+    emit_value(inst.params[1], ctx, out);
+    emit_opcode(out, relation->second);
+}
+
+void DodecaCompiler::emit_instruct(const Instruction& inst, CodegenContext& ctx,
+                                   std::vector<uint8_t>& out) {
+    const std::string& op = inst.name;
+    
+    if (op == "call") {
+        for (const auto& target : inst.params) emit_guide(target, ctx, out);
+        return;
+    }
+    
+    if (op == "store") {
+        if (inst.params.empty()) {
+            log_forensic_event("store without a target dropped");
+            return;
+        }
+        emit_opcode(out, HEIPOpcode::SLOT_STORE);
+        emit_operand(out, slot_for(inst.params[0], ctx));
+        return;
+    }
+    
+    HEIPOpcode opcode = map_to_opcode(op);
+    const OpcodeInfo* info = opcode_info(static_cast<uint8_t>(opcode));
+    if (opcode == HEIPOpcode::NOP) {
+        log_forensic_event("Unmapped instruction dropped: " + op);
+        return;
+    }
+    if (opcode != HEIPOpcode::LOAD && info->layout != OperandLayout::NONE) {
+        log_forensic_event("Unsupported operand form dropped: " + op);
+        return;
+    }
+    
+    // Operands are pushed left to right; for load/push they are the operation
+    for (const auto& param : inst.params) emit_value(param, ctx, out);
+    if (opcode == HEIPOpcode::LOAD || opcode == HEIPOpcode::PUSH) return;
+    emit_opcode(out, opcode);
+    
+    // `add counter 1` updates counter in place
+    bool arithmetic = opcode == HEIPOpcode::ADD || opcode == HEIPOpcode::SUB ||
+                      opcode == HEIPOpcode::MUL || opcode == HEIPOpcode::DIV;
+    if (arithmetic && inst.params.size() == 2 && !is_literal_token(inst.params[0])) {
+        emit_opcode(out, HEIPOpcode::SLOT_STORE);
+        emit_operand(out, slot_for(inst.params[0], ctx));
+    }
+}
+
+void DodecaCompiler::emit_value(const std::string& token, CodegenContext& ctx,
+                                std::vector<uint8_t>& out) {
+    uint32_t value;
+    double number;
+    if (parse_literal(token, value)) {
+        emit_opcode(out, HEIPOpcode::LOAD);
+        emit_operand(out, value);
+    } else if (token[0] == '"') {
+        size_t end = token.size() > 1 && token.back() == '"' ? token.size() - 1 : token.size();
+        emit_opcode(out, HEIPOpcode::LOAD_STR);
+        emit_operand(out, intern_string(token.substr(1, end - 1)));
+    } else if (parse_number(token, number)) {
+        uint64_t bits = Value::number(number).bits();
+        emit_opcode(out, HEIPOpcode::LOAD_F64);
+        emit_operand(out, static_cast<uint32_t>(bits >> 32));
+        emit_operand(out, static_cast<uint32_t>(bits));
+    } else if (is_literal_token(token)) {
+        log_forensic_event("Unsupported literal loaded as 0: " + token);
+        emit_opcode(out, HEIPOpcode::LOAD);
+        emit_operand(out, 0);
+    } else {
+        emit_opcode(out, HEIPOpcode::SLOT_LOAD);
+        emit_operand(out, slot_for(token, ctx));
+    }
+}
+
+void DodecaCompiler::emit_guide(const std::string& target, CodegenContext& ctx,
+                                std::vector<uint8_t>& out) {
+    GuideTarget resolved;
+    if (target.empty() || !resolve_guide(target, ctx.scope, resolved)) {
+        if (object_output_ && !target.empty()) {
+            // Defined by another object; `heip link` patches the call
+            log_forensic_event("Guide target imported: " + target);
+            emit_call(target, ctx, out);
+            return;
+        }
+        log_forensic_event("Unresolved Guide target dropped: " + target);
+        return;
+    }
+    
+    if (resolved.overlay) {
+        emit_overlay_use(*resolved.overlay, ctx, out);
+    } else if (!resolved.superlative.empty()) {
+        emit_superlative(resolved.superlative, ctx, out);
+    } else {
+        emit_call(resolved.protocol, ctx, out);
+    }
+}
+
+void DodecaCompiler::emit_overlay_use(Overlay& overlay, CodegenContext& ctx,
+                                      std::vector<uint8_t>& out) {
+    // Bodies that return would return from the caller once spliced, and
+    // bodies still being compiled (recursion, forward use) have no code yet
+    bool inlinable = compiled_overlays_.count(&overlay) != 0;
+    const std::vector<uint8_t>& body = overlay.compressed_bytecode;
+    DecodedInstruction inst;
+    for (size_t pc = 0; inlinable && pc < body.size(); pc += inst.length) {
+        if (!decode_instruction(body.data(), body.size(), pc, inst) ||
+            inst.opcode == HEIPOpcode::RET) {
+            inlinable = false;
+        }
+    }
+    
+    bool expand_inline = false;
+    switch (overlay_strategy_) {
+        case OverlayStrategy::INLINE:
+            expand_inline = inlinable;
+            break;
+        case OverlayStrategy::SHARED:
+            break;
+        case OverlayStrategy::AUTO:
+            // Small bodies and single uses are cheaper spliced; bodies
+            // reused many times stay shared to keep the image small
+            expand_inline = inlinable &&
+                (overlay.use_count <= 1 || body.size() <= kOverlayInlineBytes);
+            break;
+    }
+    
+    if (!expand_inline) {
+        emit_opcode(out, HEIPOpcode::OVERLAY_EXPAND);
+        emit_operand(out, next_site_++);
+        emit_operand(out, overlay.symbol);
+        call_weights_[overlay.name] += call_weight(ctx.loop_depth);
+        overlay.expanded_shared = true;
+        overlays_shared_++;
+        return;
+    }
+    
+    // Body slots move to a per-caller range; repeated expansions of the
+    // same overlay reuse it since every expansion reinitializes its State
+    uint32_t base;
+    auto found = ctx.overlay_bases.find(overlay.name);
+    if (found != ctx.overlay_bases.end()) {
+        base = found->second;
+    } else {
+        base = ctx.slot_count;
+        ctx.slot_count += overlay.slot_count;
+        ctx.overlay_bases[overlay.name] = base;
+    }
+    
+    splice_body(body, overlay.slot_count, overlay.relocations, base, ctx, out);
+    overlays_inlined_++;
+}
+
+void DodecaCompiler::splice_body(const std::vector<uint8_t>& body, uint32_t slot_count,
+                                 const std::vector<Relocation>& relocations, uint32_t base,
+                                 CodegenContext& ctx, std::vector<uint8_t>& out) {
+    // A body run in its own frame starts from zeroed slots, so a spliced one
+    // must too, except where the body stores a slot before it can read it
+    enum SlotUse : uint8_t { UNSEEN, STORED_FIRST, READ_FIRST };
+    std::vector<uint8_t> first_use(slot_count, UNSEEN);
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < body.size(); pc += inst.length) {
+        decode_instruction(body.data(), body.size(), pc, inst);
+        if (inst.opcode == HEIPOpcode::JMP || inst.opcode == HEIPOpcode::JZ ||
+            inst.opcode == HEIPOpcode::JNZ) {
+            break;
+        }
+        if ((inst.opcode == HEIPOpcode::SLOT_LOAD || inst.opcode == HEIPOpcode::SLOT_STORE) &&
+            first_use[inst.operands[0]] == UNSEEN) {
+            first_use[inst.operands[0]] =
+                inst.opcode == HEIPOpcode::SLOT_STORE ? STORED_FIRST : READ_FIRST;
+        }
+    }
+    for (uint32_t slot = 0; slot < slot_count; slot++) {
+        if (first_use[slot] == STORED_FIRST) continue;
+        emit_opcode(out, HEIPOpcode::LOAD);
+        emit_operand(out, 0);
+        emit_opcode(out, HEIPOpcode::SLOT_STORE);
+        emit_operand(out, base + slot);
+    }
+    
+    uint32_t start = static_cast<uint32_t>(out.size());
+    out.insert(out.end(), body.begin(), body.end());
+    for (size_t pc = start; pc < out.size(); pc += inst.length) {
+        decode_instruction(out.data(), out.size(), pc, inst);
+        if (inst.opcode == HEIPOpcode::SLOT_LOAD || inst.opcode == HEIPOpcode::SLOT_STORE) {
+            write_u32(&out[pc + 1], inst.operands[0] + base);
+        } else if (is_branch(inst.opcode)) {
+            write_u32(&out[pc + 1], inst.operands[0] + start);
+        }
+    }
+    for (const auto& relocation : relocations) {
+        ctx.relocations.push_back(relocation);
+        ctx.relocations.back().offset += start;
+    }
+}
+
+void DodecaCompiler::emit_call(const std::string& protocol, CodegenContext& ctx,
+                               std::vector<uint8_t>& out) {
+    auto source = protocol_index_.find(protocol);
+    const CompiledBody* callee = inline_calls_ && source != protocol_index_.end() ?
+                                 protocol_body(*source->second) : nullptr;
+    if (callee && should_inline(protocol, *callee, ctx)) {
+        // The spliced body gets its own slot range, reused by every inlined
+        // call of the same protocol since each starts from zeroed slots.
+        // A body that can fault is bracketed by a heal point so recovery
+        // retries it like a fresh frame would.
+        uint32_t base;
+        auto found = ctx.protocol_bases.find(protocol);
+        if (found != ctx.protocol_bases.end()) {
+            base = found->second;
+        } else {
+            base = ctx.slot_count;
+            ctx.slot_count += callee->slot_count;
+            ctx.protocol_bases[protocol] = base;
+        }
+        
+        // The site keeps counting calls for the next profile
+        ctx.relocations.push_back(Relocation{static_cast<uint32_t>(out.size()), protocol,
+                                             RelocationKind::INLINE_SITE, 0, false});
+        if (callee->may_fault) emit_opcode(out, HEIPOpcode::INLINE_ENTER);
+        splice_body(callee->code, callee->slot_count, callee->relocations, base, ctx, out);
+        if (callee->may_fault) emit_opcode(out, HEIPOpcode::INLINE_EXIT);
+        protocols_inlined_++;
+        if (hot_protocol(protocol)) {
+            optimizer_stats_.hot_calls_inlined++;
+            help_context_.adapt_optimization("profile_inline");
+        }
+        return;
+    }
+    
+    emit_opcode(out, HEIPOpcode::CALL);
+    call_weights_[protocol] += call_weight(ctx.loop_depth);
+    ctx.relocations.push_back(Relocation{static_cast<uint32_t>(out.size()), protocol,
+                                         RelocationKind::CALL_TARGET, 0, false});
+    emit_operand(out, 0);
+}
+
+void DodecaCompiler::emit_superlative(const std::string& name, CodegenContext& ctx,
+                                      std::vector<uint8_t>& out) {
+    // Never inlined: the runtime picks the candidate, so the call stays a
+    // cached site. Every candidate may run as often as the site does.
+    const SuperlativeDecl& superlative = superlatives_[superlative_index_.at(name)];
+    if (superlative.id == kNoSuperlative) {
+        log_forensic_event("Superlative without candidates dropped: " + name);
+        return;
+    }
+    emit_opcode(out, HEIPOpcode::SUPERLATIVE);
+    emit_operand(out, next_site_++);
+    emit_operand(out, superlative.id);
+    for (const auto& candidate : superlative.candidates) {
+        call_weights_[candidate] += call_weight(ctx.loop_depth);
+    }
+}
+
+uint32_t DodecaCompiler::slot_for(const std::string& name, CodegenContext& ctx) {
+    // Names are frame slots; first use (declared or not) allocates one
+    auto found = ctx.slots.find(name);
+    if (found != ctx.slots.end()) return found->second;
+    uint32_t slot = ctx.slot_count++;
+    ctx.slots[name] = slot;
+    return slot;
+}
+
+bool DodecaCompiler::resolve_guide(const std::string& target, const std::string& scope,
+                                   GuideTarget& out) const {
+    std::string name = target;
+    std::string search_scope = scope;
+    
+    // Explicit symbol bindings first. Auto-assigned overlay symbols come
+    // last: multi-character ones look like names ("go"), and a declared
+    // protocol of that name wins.
+    DodecaSymbol symbol;
+    bool is_symbol = dodeca_utils::parse_symbol(target, symbol);
+    if (is_symbol && symbol < symbol_aliases_.size() && !symbol_aliases_[symbol].empty()) {
+        name = symbol_aliases_[symbol];
+        search_scope.clear();
+        is_symbol = false;
+    }
+    
+    // Overlay keywords
+    DodecaSymbol keyword = dodeca_map_.compress(name);
+    if (keyword != kInvalidSymbol) {
+        out.overlay = dodeca_map_.decompress(keyword);
+        return true;
+    }
+    
+    // Protocols: innermost franchise outward to the top level
+    std::string prefix = search_scope;
+    while (true) {
+        std::string candidate = qualify(prefix, name);
+        if (protocol_index_.count(candidate)) {
+            out.protocol = candidate;
+            return true;
+        }
+        if (superlative_index_.count(candidate)) {
+            out.superlative = candidate;
+            return true;
+        }
+        if (prefix.empty()) break;
+        size_t dot = prefix.rfind('.');
+        prefix = dot == std::string::npos ? std::string() : prefix.substr(0, dot);
+    }
+    
+    // Finally an unqualified name that is unique across franchises
+    std::string suffix = "." + name;
+    std::string found;
+    for (const auto& entry : protocol_index_) {
+        const std::string& qualified = entry.first;
+        if (qualified.size() > suffix.size() &&
+            qualified.compare(qualified.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            if (!found.empty()) return false;   // Ambiguous
+            found = qualified;
+        }
+    }
+    if (!found.empty()) {
+        out.protocol = found;
+        return true;
+    }
+    
+    if (is_symbol) out.overlay = dodeca_map_.decompress(symbol);
+    return out.overlay != nullptr;
+}
+
+std::vector<uint8_t> DodecaCompiler::link_units(std::vector<CodeUnit>& units) {
+    BytecodeImage image;
+    if (object_output_) image.flags |= BytecodeImage::kObjectFlag;
+    image.strings = strings_;
+    std::unordered_map<std::string, uint32_t> entries;   // Protocol name -> offset
+    std::vector<uint32_t> bases;
+    
+    for (const auto& unit : units) {
+        uint32_t base = static_cast<uint32_t>(image.code.size());
+        bases.push_back(base);
+        if (unit.kind == UnitKind::MAIN) image.entry = base;
+        if (unit.kind != UnitKind::OVERLAY) entries[unit.name] = base;
+        
+        image.units.push_back(ImageUnit{unit.name, unit.kind, unit.symbol, base,
+                                        static_cast<uint32_t>(unit.code.size()),
+                                        unit.slot_count, false, StackEffect{0, 0, 0}, false});
+        image.code.insert(image.code.end(), unit.code.begin(), unit.code.end());
+        shift_branch_targets(image.code, base, image.code.size(), base);
+    }
+    
+    // Call targets are absolute code offsets; branch and inline sites
+    // become the image's profile sites
+    std::unordered_map<std::string, uint32_t> sources;
+    for (size_t i = 0; i < units.size(); i++) {
+        for (const auto& relocation : units[i].relocations) {
+            if (relocation.kind != RelocationKind::CALL_TARGET) {
+                auto source = sources.insert(std::make_pair(
+                    relocation.target, static_cast<uint32_t>(image.sources.size())));
+                if (source.second) image.sources.push_back(relocation.target);
+                
+                uint32_t offset = bases[i] + relocation.offset;
+                SiteKind kind = SiteKind::INLINE;
+                if (relocation.kind == RelocationKind::BRANCH_SITE) {
+                    offset--;   // The branch opcode precedes its operand
+                    kind = relocation.inverted ? SiteKind::BRANCH_INVERTED : SiteKind::BRANCH;
+                }
+                if (offset < image.code.size()) {
+                    image.sites.push_back(ImageSite{kind, offset, source.first->second,
+                                                    relocation.line});
+                }
+                continue;
+            }
+            
+            auto entry = entries.find(relocation.target);
+            if (entry == entries.end() && object_output_) {
+                image.imports.push_back(ImageImport{bases[i] + relocation.offset,
+                                                    static_cast<uint32_t>(i),
+                                                    relocation.target});
+                continue;
+            }
+            if (entry == entries.end()) {
+                throw std::runtime_error("Unresolved call target: " + relocation.target);
+            }
+            write_u32(&image.code[bases[i] + relocation.offset], entry->second);
+        }
+    }
+    
+    // Inlining copies and drops sites; the image's count must bound them
+    image.cache_sites = number_cache_sites(image.code);
+    
+    // Superlatives in id order, candidates by unit index
+    for (const auto& superlative : superlatives_) {
+        if (superlative.id == kNoSuperlative) continue;
+        image.superlatives.push_back(ImageSuperlative{superlative.name, {}});
+        for (const auto& candidate : superlative.candidates) {
+            for (size_t i = 0; i < image.units.size(); i++) {
+                if (image.units[i].kind == UnitKind::PROTOCOL && image.units[i].name == candidate) {
+                    image.superlatives.back().candidates.push_back(static_cast<uint32_t>(i));
+                    break;
+                }
+            }
+        }
+    }
+    
+    // Explicit bindings to units present in the image
+    for (DodecaSymbol symbol = 0; symbol < symbol_aliases_.size(); symbol++) {
+        GuideTarget target;
+        if (symbol_aliases_[symbol].empty() ||
+            !resolve_guide(symbol_aliases_[symbol], std::string(), target)) {
+            continue;
+        }
+        std::string name = target.overlay ? target.overlay->name : target.protocol;
+        for (size_t i = 0; i < image.units.size(); i++) {
+            bool overlay_unit = image.units[i].kind == UnitKind::OVERLAY;
+            if (image.units[i].name == name && overlay_unit == (target.overlay != nullptr)) {
+                image.aliases.push_back(ImageAlias{symbol, static_cast<uint32_t>(i)});
+                break;
+            }
+        }
+    }
+    
+    // Objects' calls out are unresolved until `heip link`, which fills
+    // these in for the whole program
+    if (!object_output_) {
+        compute_stack_effects(image);
+        compute_purity(image);
+        optimizer_stats_.pure_units = static_cast<uint32_t>(
+            std::count_if(image.units.begin(), image.units.end(),
+                          [](const ImageUnit& unit) { return unit.pure; }));
+    }
+    return image.serialize();
 }
 
 std::vector<uint8_t> DodecaCompiler::fold_structure(const std::vector<uint8_t>& unfolded) {
@@ -244,12 +1941,34 @@ HEIPOpcode DodecaCompiler::map_to_opcode(const std::string& instruction) {
    {"store", HEIPOpcode::STORE},
         {"add", HEIPOpcode::ADD},
         {"sub", HEIPOpcode::SUB},
+        {"mul", HEIPOpcode::MUL},
+        {"div", HEIPOpcode::DIV},
+        {"equal", HEIPOpcode::CMP_EQ},
+        {"not_equal", HEIPOpcode::CMP_NE},
+        {"less", HEIPOpcode::CMP_LT},
+        {"less_equal", HEIPOpcode::CMP_LE},
+        {"greater", HEIPOpcode::CMP_GT},
+        {"greater_equal", HEIPOpcode::CMP_GE},
         {"call", HEIPOpcode::CALL},
         {"return", HEIPOpcode::RET},
         {"jump", HEIPOpcode::JMP},
         {"compare", HEIPOpcode::CMP},
      {"push", HEIPOpcode::PUSH},
         {"pop", HEIPOpcode::POP},
+        {"vadd", HEIPOpcode::VADD},
+        {"vsub", HEIPOpcode::VSUB},
+        {"vmul", HEIPOpcode::VMUL},
+        {"vsum", HEIPOpcode::VSUM},
+        {"vmin", HEIPOpcode::VMIN},
+        {"vmax", HEIPOpcode::VMAX},
+        {"vcmpeq", HEIPOpcode::VCMPEQ},
+        {"vcmplt", HEIPOpcode::VCMPLT},
+        {"vcmpgt", HEIPOpcode::VCMPGT},
+        {"help_learn", HEIPOpcode::HELP_LEARN},
+        {"help_adapt", HEIPOpcode::HELP_ADAPT},
+        {"help_heal", HEIPOpcode::HELP_HEAL},
+        {"help_recommend", HEIPOpcode::HELP_RECOMMEND},
+        {"help_snapshot", HEIPOpcode::HELP_SNAPSHOT},
     };
     
     auto it = opcode_map.find(instruction);
@@ -275,17 +1994,47 @@ void DodecaCompiler::emit_operand(std::vector<uint8_t>& output, uint32_t operand
     output.push_back(operand & 0xFF);
 }
 
-void DodecaCompiler::apply_help_optimizations(std::vector<uint8_t>& bytecode) {
+uint32_t DodecaCompiler::intern_string(const std::string& value) {
+    auto entry = string_index_.insert(std::make_pair(
+        value, static_cast<uint32_t>(strings_.size())));
+    if (entry.second) strings_.push_back(value);
+    return entry.first->second;
+}
+
+void DodecaCompiler::apply_help_optimizations(CodeUnit& unit) {
     // HELP-driven optimization
     // Learn from previous compilations and adapt
     
     help_context_.adapt_optimization("bytecode_compression");
     
-    // Example: remove redundant NOPs
-    bytecode.erase(
-        std::remove(bytecode.begin(), bytecode.end(), static_cast<uint8_t>(HEIPOpcode::NOP)),
-        bytecode.end()
-    );
+    // Remove NOP instructions. This walks instructions, not bytes: operand
+    // bytes are often zero.
+    remove_instructions(unit.code, unit.relocations,
+        [](size_t, const DecodedInstruction& inst) { return inst.opcode == HEIPOpcode::NOP; });
+}
+
+bool DodecaCompiler::recover_stage(const std::string& error) {
+    if (retries_left_ == 0 || !attempt_error_recovery(error)) return false;
+    
+    if (stage_ == CompileStage::GENERATE) {
+        // Bodies left half-generated are dropped. The one that failed gets
+        // one more try without the optimizer.
+        for (auto body = protocol_bodies_.begin(); body != protocol_bodies_.end();) {
+            body = body->second.compiling ? protocol_bodies_.erase(body) : std::next(body);
+        }
+        std::string body = failing_body_;
+        failing_body_.clear();
+        if (!body.empty() && !unoptimized_bodies_.insert(body).second) return false;
+        if (!body.empty()) log_forensic_event("Regenerating unoptimized: " + body);
+    }
+    
+    static const char* const kStageNames[] = {
+        "read", "parse", "build_protocols", "generate", "link", "emit", "write", "done"
+    };
+    retries_left_--;
+    stage_retries_++;
+    log_forensic_event(std::string("Retrying stage ") + kStageNames[static_cast<int>(stage_)]);
+    return true;
 }
 
 bool DodecaCompiler::attempt_error_recovery(const std::string& error) {
@@ -313,37 +2062,82 @@ void DodecaCompiler::register_overlay(const std::string& keyword,
     overlay->name = keyword;
     overlay->symbol = allocate_symbol();
     overlay->compressed_bytecode = replacement_bytecode;
+    overlay->original_size = replacement_bytecode.size();
     overlay->compressed_size = replacement_bytecode.size();
+    overlay->slot_count = 0;
+    overlay->use_count = 0;
+    overlay->expanded_shared = false;
     
-    overlay_registry_[keyword] = overlay;
-    dodeca_map_.symbol_to_overlay[overlay->symbol] = overlay;
-    dodeca_map_.keyword_to_symbol[keyword] = overlay->symbol;
+    dodeca_map_.bind(keyword, overlay);
 }
 
 DodecaSymbol DodecaCompiler::allocate_symbol() {
-    DodecaSymbol symbol = next_symbol_;
-    
-    // Advance to next symbol: 0-9, then a-b, then c-z
-    if (next_symbol_ >= '0' && next_symbol_ < '9') {
-        next_symbol_++;
-    } else if (next_symbol_ == '9') {
-      next_symbol_ = 'a';
-    } else if (next_symbol_ == 'b') {
-        next_symbol_ = 'c';
-    } else if (next_symbol_ >= 'c' && next_symbol_ < 'z') {
+    // Ordinals are dense: 0-9, a-z, then "00", "01", ... up to kSymbolLimit
+    while (next_symbol_ < symbol_aliases_.size() && !symbol_aliases_[next_symbol_].empty()) {
         next_symbol_++;
     }
-    
-    return symbol;
+    if (next_symbol_ >= kSymbolLimit) throw std::runtime_error("Out of overlay symbols");
+    return next_symbol_++;
 }
 
 // Dodeca utilities implementation
 namespace dodeca_utils {
 
-bool is_valid_symbol(DodecaSymbol symbol) {
-    return (symbol >= '0' && symbol <= '9') ||
-           (symbol >= 'a' && symbol <= 'b') ||
- (symbol >= 'c' && symbol <= 'z');
+static const char kSymbolAlphabet[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static const uint64_t kSymbolRadix = 36;
+
+static int symbol_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    return -1;
+}
+
+std::string symbol_to_string(DodecaSymbol symbol) {
+    // Bijective numbering: all 1-character symbols, then all 2-character
+    // symbols, and so on
+    uint64_t value = symbol;
+    uint64_t block = kSymbolRadix;
+    size_t length = 1;
+    while (value >= block) {
+        value -= block;
+        block *= kSymbolRadix;
+        length++;
+    }
+    
+    std::string text(length, '0');
+    for (size_t i = length; i-- > 0;) {
+        text[i] = kSymbolAlphabet[value % kSymbolRadix];
+        value /= kSymbolRadix;
+    }
+    return text;
+}
+
+bool parse_symbol(const std::string& text, DodecaSymbol& symbol) {
+    if (text.empty() || text.size() > kMaxSymbolLength) return false;
+    
+    uint64_t offset = 0;
+    uint64_t block = kSymbolRadix;
+    for (size_t i = 1; i < text.size(); i++) {
+        offset += block;
+        block *= kSymbolRadix;
+    }
+    
+    uint64_t value = 0;
+    for (char c : text) {
+        int digit = symbol_digit(c);
+        if (digit < 0) return false;
+        value = value * kSymbolRadix + static_cast<uint64_t>(digit);
+    }
+    
+    value += offset;
+    if (value >= kSymbolLimit) return false;
+    symbol = static_cast<DodecaSymbol>(value);
+    return true;
+}
+
+bool is_valid_symbol(const std::string& text) {
+    DodecaSymbol symbol;
+    return parse_symbol(text, symbol);
 }
 
 float calculate_compression_potential(size_t structure_size) {
@@ -380,21 +2174,84 @@ std::string HELPContext::recommend_fix(const std::string& issue) {
     return "";
 }
 
-// DodecaMap implementation
-DodecaSymbol DodecaMap::compress(const std::string& keyword) {
-    auto it = keyword_to_symbol.find(keyword);
-    if (it != keyword_to_symbol.end()) {
-        return it->second;
+// KeywordTable implementation
+KeywordTable::KeywordTable()
+    : slots_(64, Slot{0, 0, 0, kInvalidSymbol})
+    , size_(0) {
+}
+
+uint64_t KeywordTable::hash_of(const std::string& keyword) {
+    // FNV-1a; 0 is reserved for empty slots
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : keyword) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
+
+size_t KeywordTable::probe(const std::string& keyword, uint64_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.hash == 0) return i;
+        if (slot.hash == hash && slot.key_length == keyword.size() &&
+            arena_.compare(slot.key_offset, slot.key_length, keyword) == 0) {
+            return i;
+        }
+    }
+}
+
+DodecaSymbol KeywordTable::find(const std::string& keyword) const {
+    const Slot& slot = slots_[probe(keyword, hash_of(keyword))];
+    return slot.hash ? slot.symbol : kInvalidSymbol;
+}
+
+void KeywordTable::insert(const std::string& keyword, DodecaSymbol symbol) {
+    // Keep the load factor at or below one half
+    if ((size_ + 1) * 2 > slots_.size()) grow();
+    
+    uint64_t hash = hash_of(keyword);
+    Slot& slot = slots_[probe(keyword, hash)];
+    if (slot.hash == 0) {
+        slot.hash = hash;
+        slot.key_offset = static_cast<uint32_t>(arena_.size());
+        slot.key_length = static_cast<uint32_t>(keyword.size());
+        arena_ += keyword;
+        size_++;
+    }
+    slot.symbol = symbol;
+}
+
+void KeywordTable::grow() {
+    std::vector<Slot> old_slots;
+    old_slots.swap(slots_);
+    slots_.assign(old_slots.size() * 2, Slot{0, 0, 0, kInvalidSymbol});
+    
+    size_t mask = slots_.size() - 1;
+    for (const Slot& slot : old_slots) {
+        if (slot.hash == 0) continue;
+        size_t i = slot.hash & mask;
+        while (slots_[i].hash != 0) i = (i + 1) & mask;
+        slots_[i] = slot;
     }
-    return '0';  // Default symbol
 }
 
-std::shared_ptr<Overlay> DodecaMap::decompress(DodecaSymbol symbol) {
-    auto it = symbol_to_overlay.find(symbol);
-    if (it != symbol_to_overlay.end()) {
-   return it->second;
+// DodecaMap implementation
+DodecaSymbol DodecaMap::compress(const std::string& keyword) const {
+    return keyword_to_symbol.find(keyword);
+}
+
+std::shared_ptr<Overlay> DodecaMap::decompress(DodecaSymbol symbol) const {
+    return symbol < symbol_to_overlay.size() ? symbol_to_overlay[symbol] : nullptr;
+}
+
+void DodecaMap::bind(const std::string& keyword, const std::shared_ptr<Overlay>& overlay) {
+    if (overlay->symbol >= symbol_to_overlay.size()) {
+        symbol_to_overlay.resize(overlay->symbol + 1);
     }
-    return nullptr;
+    symbol_to_overlay[overlay->symbol] = overlay;
+    keyword_to_symbol.insert(keyword, overlay->symbol);
 }
 
 } // namespace heip
@@ -1,10 +1,44 @@
 #pragma once
 #include "heip_types.h"
+#include "bytecode_image.h"
+#include "ssa_optimizer.h"
+#include "execution_profile.h"
 #include <functional>
 #include <algorithm>
+#include <unordered_set>
 
 namespace heip {
 
+// How overlay use sites are expanded
+enum class OverlayStrategy {
+    AUTO,      // Size/use-count heuristic per overlay
+    INLINE,    // Always splice the compiled body into the caller
+    SHARED     // Always run the single shared body via OVERLAY_EXPAND
+};
+
+// Compile pipeline stages, in order. Each keeps its result for the
+// stages after it, so recovering from a failure re-runs that stage only.
+enum class CompileStage {
+    READ,              // Source text
+    PARSE,             // Instructions
+    BUILD_PROTOCOLS,   // Protocol, range and overlay bodies
+    GENERATE,          // Optimized unit bytecode, one unit at a time
+    LINK,              // Laid out, fused and linked image
+    EMIT,              // Native code
+    WRITE,
+    DONE
+};
+
+// Relocatable bytecode for one protocol, range, overlay or __main__
+struct CodeUnit {
+    std::string name;
+    UnitKind kind;
+    DodecaSymbol symbol;
+    std::vector<uint8_t> code;
+    uint32_t slot_count;
+    std::vector<Relocation> relocations;    // Offsets relative to `code`
+};
+
 
 // The revolutionary Dodecagramic-Overlay Compiler
 // Achieves 100% compiler functionality with 10% code through:
@@ -40,24 +74,171 @@ public:
     void enable_learning(bool enable) { help_enabled_ = enable; }
     HELPContext& get_help_context() { return help_context_; }
     
+    // Overlay expansion policy
+    void set_overlay_strategy(OverlayStrategy strategy) { overlay_strategy_ = strategy; }
+    
+    // 0 disables the optimizer, 1 and 2 as in ssa_optimizer.h
+    void set_optimization_level(int level) { optimization_level_ = level; }
+    
+    // Profile recorded by `heip run --profile-out`, handed to HELP; false
+    // if the file can't be read
+    bool load_profile(const std::string& path);
+    void set_profile(std::shared_ptr<const ExecutionProfile> profile);
+    
+    // Object output (`--object`): Guide targets this file doesn't define
+    // become imports for `heip link` instead of being dropped
+    void set_object_output(bool object) { object_output_ = object; }
+    
+    // Progress lines on stdout (batch workers run quiet); the last
+    // failure's message is kept either way
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    const std::string& get_last_error() const { return last_error_; }
+    
     // Statistics and verification
     float get_compression_ratio() const { return compression_ratio_; }
     size_t get_original_size() const { return original_size_; }
     size_t get_compressed_size() const { return compressed_size_; }
+    size_t get_overlays_inlined() const { return overlays_inlined_; }
+    size_t get_overlays_shared() const { return overlays_shared_; }
+    size_t get_protocols_inlined() const { return protocols_inlined_; }
+    const OptimizerStats& get_optimizer_stats() const { return optimizer_stats_; }
+    size_t get_stage_retries() const { return stage_retries_; }
     
 private:
     // Compilation stages
     std::vector<std::shared_ptr<Instruction>> parse_instructions(const std::string& source);
     std::vector<std::shared_ptr<Protocol>> build_protocols(
         const std::vector<std::shared_ptr<Instruction>>& instructions);
-    std::vector<uint8_t> generate_bytecode(
-        const std::vector<std::shared_ptr<Protocol>>& protocols);
+    bool run_stage(CompileStage stage, const std::string& source_file,
+                   const std::string& output_file);
+    void prepare_units();
+    void generate_units();
+    std::vector<uint8_t> link_program();
+    
+    // Artefacts of the stages run so far. GENERATE keeps every unit it
+    // finished and resumes at the one that failed; LINK works on a copy of
+    // the units so it can run again.
+    struct CompileArtifacts {
+        std::string source;
+        std::vector<std::shared_ptr<Instruction>> instructions;
+        std::vector<std::shared_ptr<Protocol>> protocols;
+        bool prepared;                                   // Overlays registered, sites counted
+        std::vector<std::shared_ptr<Overlay>> overlays;  // With their protocols, in order
+        std::vector<std::shared_ptr<Protocol>> overlay_bodies;
+        size_t overlays_done;
+        size_t protocols_done;                           // Index into `protocols`
+        std::vector<CodeUnit> units;
+        std::vector<uint8_t> image;
+        std::vector<uint8_t> native;
+    };
+    CompileArtifacts artifacts_;
+    CompileStage stage_;
  
-    // Dodecagramic symbol management
+    // If/Else arm emitted after the hot path of its body
+    struct ColdRegion {
+        std::vector<std::shared_ptr<Instruction>> instructions;
+        uint32_t entry_patch;     // Branch operand into the region
+        uint32_t resume;          // Where the region continues (its block's end)
+    };
+    
+    // Per-unit code generation state
+    struct CodegenContext {
+        std::string unit;                                    // Profile key of the body
+        std::string scope;                                   // Franchise path for lookups
+        std::unordered_map<std::string, uint32_t> slots;     // Named frame slots
+        uint32_t slot_count;
+        std::unordered_map<std::string, uint32_t> overlay_bases;  // Inlined overlay slots
+        std::vector<Relocation> relocations;
+        std::unordered_map<std::string, uint32_t> protocol_bases; // Inlined protocol slots
+        uint32_t loop_depth;                                 // Enclosing While blocks
+        std::vector<ColdRegion> cold_regions;
+    };
+    
+    // Protocol body shared by its own unit and the call sites it is inlined into
+    struct CompiledBody {
+        std::vector<uint8_t> code;
+        uint32_t slot_count;
+        std::vector<Relocation> relocations;
+        bool compiling;      // Set while the body is generated (recursion)
+        bool leaf;           // Never leaves its frame or pops below its entry depth
+        bool may_fault;      // Contains an instruction that can fail at runtime
+    };
+    
+    // Guide/overlay target resolution result
+    struct GuideTarget {
+        std::shared_ptr<Overlay> overlay;    // Set for overlay expansions
+        std::string superlative;             // Qualified Superlative name, or
+        std::string protocol;                // qualified protocol name otherwise
+    };
+    
+    // Superlative block: the Guide targets its body lists, resolved to
+    // protocols once every protocol is known. Only Superlatives with a
+    // candidate get an id (their SUPERLATIVE operand and image index).
+    static const uint32_t kNoSuperlative = UINT32_MAX;
+    struct SuperlativeDecl {
+        std::string name;
+        std::string scope;
+        std::vector<std::string> targets;
+        std::vector<std::string> candidates;   // Qualified protocol names
+        uint32_t id;
+    };
+    
+    CodeUnit compile_unit(const Protocol& protocol);
+    std::vector<uint8_t> compile_body(const Protocol& protocol, CodegenContext& ctx);
+    void emit_instructions(const std::vector<std::shared_ptr<Instruction>>& instructions,
+                           CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_instruct(const Instruction& inst, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_value(const std::string& token, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_guide(const std::string& target, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_condition(const Instruction& inst, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_overlay_use(Overlay& overlay, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_call(const std::string& protocol, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void emit_superlative(const std::string& name, CodegenContext& ctx, std::vector<uint8_t>& out);
+    void splice_body(const std::vector<uint8_t>& body, uint32_t slot_count,
+                     const std::vector<Relocation>& relocations, uint32_t base,
+                     CodegenContext& ctx, std::vector<uint8_t>& out);
+    const CompiledBody* protocol_body(const Protocol& protocol);
+    bool should_inline(const std::string& name, const CompiledBody& callee,
+                       const CodegenContext& ctx) const;
+    bool hot_protocol(const std::string& name) const;
+    const ExecutionProfile* active_profile() const;
+    uint32_t slot_for(const std::string& name, CodegenContext& ctx);
+    bool resolve_guide(const std::string& target, const std::string& scope, GuideTarget& out) const;
+    void layout_units(std::vector<CodeUnit>& units);
+    uint64_t unit_heat(const CodeUnit& unit) const;
+    std::vector<uint8_t> link_units(std::vector<CodeUnit>& units);
+    
+    // Dodecagramic symbol management (single source of overlays)
     DodecaMap dodeca_map_;
-    std::unordered_map<std::string, std::shared_ptr<Overlay>> overlay_registry_;
     
-    // Symbol allocation (0-9, a-b, then c-z)
+    // Explicit `<symbol>: <name>` bindings, indexed by symbol ordinal
+    std::vector<std::string> symbol_aliases_;
+    
+    // Qualified protocol/range names for Guide resolution
+    std::unordered_map<std::string, std::shared_ptr<Protocol>> protocol_index_;
+    
+    // Superlatives in declaration order, and by qualified name
+    std::vector<SuperlativeDecl> superlatives_;
+    std::unordered_map<std::string, size_t> superlative_index_;
+    
+    // Overlay expansion; bodies can only be inlined once compiled
+    OverlayStrategy overlay_strategy_;
+    std::unordered_set<const Overlay*> compiled_overlays_;
+    uint32_t next_site_;
+    size_t overlays_inlined_;
+    size_t overlays_shared_;
+    
+    // Protocol inlining at Guide call sites (-O2), after overlays are compiled
+    std::unordered_map<std::string, CompiledBody> protocol_bodies_;
+    std::unordered_map<std::string, uint32_t> call_sites_;
+    std::unordered_map<std::string, uint64_t> call_weights_;   // Emitted calls, loop-weighted
+    bool inline_calls_;
+    size_t protocols_inlined_;
+    int optimization_level_;
+    OptimizerStats optimizer_stats_;
+    
+    // Symbol allocation: dense ordinals, 0-9/a-z then multi-character;
+    // ordinals claimed by explicit bindings are skipped
     DodecaSymbol next_symbol_;
     DodecaSymbol allocate_symbol();
     
@@ -69,18 +250,39 @@ private:
     void emit_opcode(std::vector<uint8_t>& output, HEIPOpcode opcode);
     void emit_operand(std::vector<uint8_t>& output, uint32_t operand);
     
+    // String constants for LOAD_STR, each stored once per program
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> string_index_;
+    uint32_t intern_string(const std::string& value);
+    
     // HELP learning system
   bool help_enabled_;
     HELPContext help_context_;
-    void apply_help_optimizations(std::vector<uint8_t>& bytecode);
+    void apply_help_optimizations(CodeUnit& unit);
     
     // Statistics
     size_t original_size_;
     size_t compressed_size_;
     float compression_ratio_;
     
-    // Self-healing compilation
+    // Separate compilation
+    bool object_output_;
+    
+    // Diagnostics
+    bool verbose_;
+    std::string last_error_;
+    
+    // Self-healing compilation: a failed stage is retried when HELP
+    // recommends a fix, at most kStageRetries times per compile. A body
+    // that failed to generate is retried once without the optimizer; failing
+    // again unoptimized means the failure is in the source.
+    static const size_t kStageRetries = 3;
+    size_t retries_left_;
+    size_t stage_retries_;
+    std::string failing_body_;                        // Innermost body that threw
+    std::unordered_set<std::string> unoptimized_bodies_;
     bool attempt_error_recovery(const std::string& error);
+    bool recover_stage(const std::string& error);
     void log_forensic_event(const std::string& event);
 };
 
@@ -90,8 +292,11 @@ namespace dodeca_utils {
     std::string to_dodeca_string(uint64_t value);
     uint64_t from_dodeca_string(const std::string& dodeca);
     
-    // Check if symbol is valid (0-9, a-b, c-z)
-    bool is_valid_symbol(DodecaSymbol symbol);
+    // Symbol spelling: 0-9, a-z, then multi-character symbols
+    const size_t kMaxSymbolLength = 6;
+    std::string symbol_to_string(DodecaSymbol symbol);
+    bool parse_symbol(const std::string& text, DodecaSymbol& symbol);
+    bool is_valid_symbol(const std::string& text);
     
     // Calculate theoretical compression for structure
     float calculate_compression_potential(size_t structure_size);
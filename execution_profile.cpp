@@ -0,0 +1,206 @@
+#include "execution_profile.h"
+#include "opcode_table.h"
+#include <fstream>
+#include <iterator>
+
+namespace heip {
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Bounds-checked varint reader
+struct VarintReader {
+    const std::vector<uint8_t>& data;
+    size_t pos;
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (pos >= data.size()) return false;
+            uint8_t byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool bytes(std::string& value, uint64_t length) {
+        if (length > data.size() - pos) return false;
+        value.assign(data.begin() + pos, data.begin() + pos + length);
+        pos += length;
+        return true;
+    }
+};
+
+} // namespace
+
+void ExecutionProfile::add_calls(const std::string& unit, uint64_t count) {
+    if (count == 0) return;
+    calls_[unit] += count;
+    total_calls_ += count;
+}
+
+void ExecutionProfile::add_branch(const std::string& unit, uint32_t line,
+                                  uint64_t true_count, uint64_t false_count) {
+    if (true_count == 0 && false_count == 0) return;
+    BranchCounts& counts = branches_.insert(
+        std::make_pair(std::make_pair(unit, line), BranchCounts{0, 0})).first->second;
+    counts.true_count += true_count;
+    counts.false_count += false_count;
+}
+
+void ExecutionProfile::add_pair(uint8_t first, uint8_t second, uint64_t count) {
+    if (count == 0) return;
+    pairs_[static_cast<uint16_t>((first << 8) | second)] += count;
+    total_pairs_ += count;
+}
+
+void ExecutionProfile::merge(const ExecutionProfile& other) {
+    runs_ += other.runs_;
+    for (const auto& call : other.calls_) add_calls(call.first, call.second);
+    for (const auto& branch : other.branches_) {
+        add_branch(branch.first.first, branch.first.second,
+                   branch.second.true_count, branch.second.false_count);
+    }
+    for (const auto& pair : other.pairs_) {
+        add_pair(static_cast<uint8_t>(pair.first >> 8), static_cast<uint8_t>(pair.first),
+                 pair.second);
+    }
+}
+
+uint64_t ExecutionProfile::calls(const std::string& unit) const {
+    auto found = calls_.find(unit);
+    return found != calls_.end() ? found->second : 0;
+}
+
+const BranchCounts* ExecutionProfile::branch(const std::string& unit, uint32_t line) const {
+    auto found = branches_.find(std::make_pair(unit, line));
+    return found != branches_.end() ? &found->second : nullptr;
+}
+
+uint64_t ExecutionProfile::branch_samples(const std::string& unit) const {
+    uint64_t samples = 0;
+    for (auto it = branches_.lower_bound(std::make_pair(unit, 0u));
+         it != branches_.end() && it->first.first == unit; ++it) {
+        samples += it->second.true_count + it->second.false_count;
+    }
+    return samples;
+}
+
+uint64_t ExecutionProfile::pair(uint8_t first, uint8_t second) const {
+    auto found = pairs_.find(static_cast<uint16_t>((first << 8) | second));
+    return found != pairs_.end() ? found->second : 0;
+}
+
+std::vector<uint8_t> ExecutionProfile::serialize() const {
+    // Unit names are stored once and referenced by index
+    std::map<std::string, uint64_t> names;
+    for (const auto& call : calls_) names.insert(std::make_pair(call.first, 0));
+    for (const auto& branch : branches_) names.insert(std::make_pair(branch.first.first, 0));
+    uint64_t next_name = 0;
+    for (auto& name : names) name.second = next_name++;
+
+    std::vector<uint8_t> out(4);
+    write_u32(out.data(), kMagic);
+    put_varint(out, kVersion);
+    put_varint(out, runs_);
+
+    put_varint(out, names.size());
+    for (const auto& name : names) {
+        put_varint(out, name.first.size());
+        out.insert(out.end(), name.first.begin(), name.first.end());
+    }
+
+    put_varint(out, calls_.size());
+    for (const auto& call : calls_) {
+        put_varint(out, names[call.first]);
+        put_varint(out, call.second);
+    }
+
+    put_varint(out, branches_.size());
+    for (const auto& branch : branches_) {
+        put_varint(out, names[branch.first.first]);
+        put_varint(out, branch.first.second);
+        put_varint(out, branch.second.true_count);
+        put_varint(out, branch.second.false_count);
+    }
+
+    put_varint(out, pairs_.size());
+    for (const auto& pair : pairs_) {
+        put_varint(out, pair.first);
+        put_varint(out, pair.second);
+    }
+    return out;
+}
+
+bool ExecutionProfile::deserialize(const std::vector<uint8_t>& data, ExecutionProfile& profile) {
+    if (data.size() < 4 || read_u32(data.data()) != kMagic) return false;
+    VarintReader reader{data, 4};
+    ExecutionProfile result;
+    uint64_t version, count;
+
+    if (!reader.varint(version) || version != kVersion) return false;
+    if (!reader.varint(result.runs_)) return false;
+
+    std::vector<std::string> names;
+    if (!reader.varint(count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t length;
+        std::string name;
+        if (!reader.varint(length) || !reader.bytes(name, length)) return false;
+        names.push_back(name);
+    }
+
+    if (!reader.varint(count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t name, calls;
+        if (!reader.varint(name) || name >= names.size() || !reader.varint(calls)) return false;
+        result.add_calls(names[name], calls);
+    }
+
+    if (!reader.varint(count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t name, line, true_count, false_count;
+        if (!reader.varint(name) || name >= names.size() || !reader.varint(line) ||
+            line > UINT32_MAX || !reader.varint(true_count) || !reader.varint(false_count)) {
+            return false;
+        }
+        result.add_branch(names[name], static_cast<uint32_t>(line), true_count, false_count);
+    }
+
+    if (!reader.varint(count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t key, pairs;
+        if (!reader.varint(key) || key > 0xFFFF || !reader.varint(pairs)) return false;
+        result.add_pair(static_cast<uint8_t>(key >> 8), static_cast<uint8_t>(key), pairs);
+    }
+
+    if (reader.pos != data.size()) return false;
+    profile = result;
+    return true;
+}
+
+bool ExecutionProfile::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    return deserialize(data, *this);
+}
+
+bool ExecutionProfile::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::vector<uint8_t> data = serialize();
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return file.good();
+}
+
+} // namespace heip
@@ -0,0 +1,68 @@
+#pragma once
+#include "heip_types.h"
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace heip {
+
+// Outcomes of one source-level If/While condition
+struct BranchCounts {
+    uint64_t true_count;
+    uint64_t false_count;
+};
+
+// Execution profile written by `heip run --profile-out` and read by
+// `heip compile --profile-in`. Everything is keyed by source (unit names,
+// If/While lines), not code offsets, so a profile stays usable across
+// recompilations and optimization levels. Writing to an existing profile
+// accumulates runs.
+//
+// File layout (after the magic, every integer is an unsigned LEB128 varint):
+//   magic "HPRF", version, runs,
+//   name count, names:  length, bytes
+//   call count, calls:  name, count
+//   branch count, branches: name, line, true count, false count
+//   pair count, pairs:  first opcode << 8 | second opcode, count
+class ExecutionProfile {
+public:
+    static const uint32_t kMagic = 0x48505246;   // "HPRF"
+    static const uint32_t kVersion = 1;
+
+    ExecutionProfile() : runs_(0), total_calls_(0), total_pairs_(0) {}
+
+    // Recording
+    void add_run() { runs_++; }
+    void add_calls(const std::string& unit, uint64_t count);
+    void add_branch(const std::string& unit, uint32_t line,
+                    uint64_t true_count, uint64_t false_count);
+    void add_pair(uint8_t first, uint8_t second, uint64_t count);
+    void merge(const ExecutionProfile& other);
+
+    // Queries
+    bool empty() const { return runs_ == 0; }
+    uint64_t runs() const { return runs_; }
+    uint64_t calls(const std::string& unit) const;
+    uint64_t total_calls() const { return total_calls_; }
+    const BranchCounts* branch(const std::string& unit, uint32_t line) const;
+    uint64_t branch_samples(const std::string& unit) const;   // All of the unit's conditions
+    uint64_t pair(uint8_t first, uint8_t second) const;
+    uint64_t total_pairs() const { return total_pairs_; }
+
+    std::vector<uint8_t> serialize() const;
+    static bool deserialize(const std::vector<uint8_t>& data, ExecutionProfile& profile);
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+private:
+    uint64_t runs_;
+    std::map<std::string, uint64_t> calls_;
+    std::map<std::pair<std::string, uint32_t>, BranchCounts> branches_;
+    std::map<uint16_t, uint64_t> pairs_;
+    uint64_t total_calls_;
+    uint64_t total_pairs_;
+};
+
+} // namespace heip
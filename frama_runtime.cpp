@@ -1,70 +1,416 @@
 #include "frame_runtime.h"
+#include "franchise_workers.h"
+#include "../core/opcode_table.h"
+#include "../core/stack_verifier.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <cstdint>
+#include <cstring>
 
 namespace heip {
 
+namespace {
+
+// ADD/SUB/MUL/DIV. Two ints stay int32 (wrapping; DIV faults on zero and
+// INT_MIN / -1); a double operand makes it a double operation. Other
+// kinds fault.
+inline bool arithmetic(HEIPOpcode op, Value a, Value b, Value& out) {
+    if (a.is_int() && b.is_int()) {
+        uint32_t x = a.payload();
+        uint32_t y = b.payload();
+        switch (op) {
+            case HEIPOpcode::ADD: out = Value::integer(static_cast<int32_t>(x + y)); return true;
+            case HEIPOpcode::SUB: out = Value::integer(static_cast<int32_t>(x - y)); return true;
+            case HEIPOpcode::MUL: out = Value::integer(static_cast<int32_t>(x * y)); return true;
+            default: {
+                int32_t sa = a.as_int();
+                int32_t sb = b.as_int();
+                if (sb == 0 || (sa == INT32_MIN && sb == -1)) return false;
+                out = Value::integer(sa / sb);
+                return true;
+            }
+        }
+    }
+    if (!a.is_number() || !b.is_number()) return false;
+    double x = a.to_double();
+    double y = b.to_double();
+    switch (op) {
+        case HEIPOpcode::ADD: out = Value::number(x + y); return true;
+        case HEIPOpcode::SUB: out = Value::number(x - y); return true;
+        case HEIPOpcode::MUL: out = Value::number(x * y); return true;
+        default: out = Value::number(x / y); return true;
+    }
+}
+
+// CMP_EQ..CMP_GE (signed). Numbers compare by value; strings and
+// references only for (in)equality, by handle - strings are interned, so
+// that compares their contents.
+inline bool relate(HEIPOpcode relation, Value a, Value b, bool& out) {
+    if (a.is_int() && b.is_int()) {
+        int32_t x = a.as_int();
+        int32_t y = b.as_int();
+        switch (relation) {
+            case HEIPOpcode::CMP_EQ: out = x == y; return true;
+            case HEIPOpcode::CMP_NE: out = x != y; return true;
+            case HEIPOpcode::CMP_LT: out = x < y; return true;
+            case HEIPOpcode::CMP_LE: out = x <= y; return true;
+            case HEIPOpcode::CMP_GT: out = x > y; return true;
+            default: out = x >= y; return true;
+        }
+    }
+    if (a.is_number() && b.is_number()) {
+        double x = a.to_double();
+        double y = b.to_double();
+        switch (relation) {
+            case HEIPOpcode::CMP_EQ: out = x == y; return true;
+            case HEIPOpcode::CMP_NE: out = x != y; return true;
+            case HEIPOpcode::CMP_LT: out = x < y; return true;
+            case HEIPOpcode::CMP_LE: out = x <= y; return true;
+            case HEIPOpcode::CMP_GT: out = x > y; return true;
+            default: out = x >= y; return true;
+        }
+    }
+    if (relation == HEIPOpcode::CMP_EQ || relation == HEIPOpcode::CMP_NE) {
+        out = (a == b) == (relation == HEIPOpcode::CMP_EQ);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
 FrameRuntime::FrameRuntime()
-  : program_counter_(0)
+  : program_(std::make_shared<Program>())
+    , code_(program_->code.data())
+    , code_size_(0)
+    , program_counter_(0)
+    , code_start_(0)
+    , image_base_(0)
+    , image_size_(0)
+    , lazy_(false)
+    , range_start_(0)
+    , code_limit_(0)
+    , unchecked_(false)
     , next_frame_id_(1)
+    , chains_(heap_)
+    , simd_(&select_simd_kernels())
     , self_healing_enabled_(true)
+    , last_fault_pc_(static_cast<size_t>(-1))
+    , snapshot_stop_(false)
+    , snapshot_reached_(false)
+    , snapshot_pc_(0)
+    , profiling_(false)
+    , last_opcode_(0x100)
     , instruction_count_(0)
-    , uptime_percentage_(100.0f) {
+    , uptime_percentage_(100.0f)
+    , metrics_(&local_metrics_)
+    , retired_instructions_(0) {
     
     start_time_ = std::chrono::high_resolution_clock::now();
-    
-    // Allocate initial memory (1MB)
- memory_.resize(1024 * 1024);
+    end_time_ = start_time_;
     
     // Create root frame
     current_frame_ = create_frame("__root__");
+    
+    // Frame slots, the operand stack and checkpoints are the GC roots
+    heap_.set_root_enumerator([this](const GCHeap::RootVisitor& visit) {
+        visit_roots(visit);
+    });
 }
 
 FrameRuntime::~FrameRuntime() {
-    end_time_ = std::chrono::high_resolution_clock::now();
 }
 
 bool FrameRuntime::load_bytecode(const std::vector<uint8_t>& bytecode) {
-    bytecode_ = bytecode;
-    program_counter_ = 0;
-    log_execution_event("Bytecode loaded: " + std::to_string(bytecode.size()) + " bytes");
+    std::string error;
+    std::shared_ptr<const Program> program = Program::load(bytecode, error);
+    if (!program) {
+        log_execution_event(error);
+        return false;
+    }
+    
+    load_program(program);
+    if (program->units.empty()) {
+        log_execution_event("Bytecode loaded: " + std::to_string(bytecode.size()) + " bytes");
+    } else {
+        log_execution_event("Image loaded: " + std::to_string(program->units.size()) +
+                            " units, " + std::to_string(code_size_) + " code bytes");
+    }
     return true;
 }
 
+void FrameRuntime::load_program(std::shared_ptr<const Program> program) {
+    lazy_ = false;
+    image_file_.close();
+    own_program_.reset();
+    program_ = std::move(program);
+    install_program();
+}
+
+void FrameRuntime::install_program() {
+    code_ = program_->code.data();
+    code_size_ = program_->code.size();
+    program_counter_ = program_->entry;
+    
+    // Results and bindings are keyed by entry offset, which means nothing
+    // in another program
+    memo_.clear();
+    memo_pending_.clear();
+    cost_pending_.clear();
+    resolver_.reset();
+    resolver_.set_site_count(program_->cache_sites);
+    for (const auto& binding : program_->bindings) {
+        if (binding.overlay) {
+            resolver_.register_overlay(binding.symbol, binding.name, binding.entry);
+        } else {
+            resolver_.register_protocol(binding.symbol, binding.name, binding.entry);
+        }
+    }
+    for (size_t i = 0; i < program_->superlatives.size(); i++) {
+        std::vector<ResolvedTarget> candidates;
+        for (uint32_t entry : program_->superlatives[i].entries) {
+            auto name = program_->unit_names.find(entry);
+            candidates.push_back(ResolvedTarget{
+                name != program_->unit_names.end() ? name->second : std::string(), entry});
+        }
+        resolver_.register_superlative(static_cast<uint32_t>(i), program_->superlatives[i].name,
+                                       candidates);
+    }
+    drop_to_checked();
+    
+    site_counters_.clear();
+    for (const auto& site : program_->sites) {
+        site_counters_.push_back(SiteCounter{site, 0, 0});
+    }
+    if (profiling_) index_profile_sites();
+}
+
+void FrameRuntime::reset() {
+    // The frame stack starts over, so no frame is left to drop to checked
+    frame_stack_.clear();
+    next_frame_id_ = 1;
+    current_frame_ = create_frame("__root__");
+    unchecked_ = false;
+    program_counter_ = program_->entry;
+    
+    stack_.clear();
+    memory_.clear();
+    heap_.reset();
+    checkpoint_stack_.clear();
+    inline_marks_.clear();
+    memo_pending_.clear();
+    cost_pending_.clear();
+    error_log_.clear();
+    execution_log_.clear();
+    last_fault_pc_ = static_cast<size_t>(-1);
+    snapshot_reached_ = false;
+    
+    for (auto& counter : site_counters_) counter.taken = counter.not_taken = 0;
+    unit_calls_.clear();
+    std::fill(opcode_pairs_.begin(), opcode_pairs_.end(), 0);
+    last_opcode_ = 0x100;
+    retired_instructions_ += instruction_count_;
+    instruction_count_ = 0;
+    start_time_ = std::chrono::high_resolution_clock::now();
+    end_time_ = start_time_;
+    publish_metrics();
+}
+
+int FrameRuntime::run_unit(uint32_t entry, const Value* args, size_t arg_count,
+                           std::vector<Value>& results) {
+    reset();
+    results.clear();
+    if (!program_->find_unit(entry)) return 1;
+    
+    // The unit runs in the root frame, so its return ends the run
+    stack_.reserve(arg_count + kMaxPushes);
+    for (size_t i = 0; i < arg_count; i++) push(args[i]);
+    program_counter_ = entry;
+    int result = execute();
+    results.assign(stack_.begin(), stack_.end());
+    return result;
+}
+
+bool FrameRuntime::set_franchise_workers(std::shared_ptr<FranchiseWorkers> workers) {
+    if (workers && &workers->program() != program_.get()) return false;
+    workers_ = std::move(workers);
+    return true;
+}
+
+bool FrameRuntime::load_file(const std::string& path) {
+    if (!open_image(path, 0, -1) || !ensure_resident(static_cast<uint32_t>(program_counter_))) {
+        return false;
+    }
+    log_execution_event("Image opened: " + std::to_string(program_->units.size()) + " units, " +
+                        std::to_string(code_size_) + " code bytes, entry unit loaded");
+    return true;
+}
+
+bool FrameRuntime::open_image(const std::string& path, std::streamoff base,
+                              std::streamoff size) {
+    lazy_ = false;
+    image_file_.close();
+    image_file_.clear();
+    image_file_.open(path, std::ios::binary);
+    if (!image_file_.is_open()) return false;
+    
+    // The image runs from `base` to the end of the file unless sized; its
+    // tables are everything in front of the code section
+    image_file_.seekg(0, std::ios::end);
+    std::streamoff file_size = image_file_.tellg();
+    if (size < 0) size = file_size - base;
+    image_file_.seekg(base);
+    std::vector<uint8_t> header(BytecodeImage::kHeaderSize);
+    uint32_t code_size;
+    if (base < 0 || size < static_cast<std::streamoff>(header.size()) ||
+        base + size > file_size ||
+        !image_file_.read(reinterpret_cast<char*>(header.data()), header.size()) ||
+        !BytecodeImage::code_size_of(header, code_size) || code_size > size) {
+        log_execution_event("Malformed image rejected");
+        return false;
+    }
+    
+    std::vector<uint8_t> tables(static_cast<size_t>(size - code_size));
+    image_file_.seekg(base);
+    BytecodeImage image;
+    size_t code_start;
+    if (!image_file_.read(reinterpret_cast<char*>(tables.data()), tables.size()) ||
+        !BytecodeImage::deserialize_tables(tables, image, code_size, code_start) ||
+        code_start != tables.size()) {
+        log_execution_event("Malformed image rejected");
+        return false;
+    }
+    
+    std::string error;
+    own_program_ = Program::from_tables(image, code_size, error);
+    if (!own_program_) {
+        log_execution_event(error);
+        return false;
+    }
+    program_ = own_program_;
+    code_start_ = base + static_cast<std::streamoff>(code_start);
+    image_base_ = base;
+    image_size_ = size;
+    lazy_ = true;
+    install_program();
+    return true;
+}
+
+bool FrameRuntime::ensure_resident(uint32_t entry) {
+    // A lazily loaded image can only be entered at a unit
+    const ProgramUnit* unit = program_->find_unit(entry);
+    if (!unit) return !lazy_;
+    if (unit->resident) return true;
+    if (!lazy_) return false;
+    
+    ProgramUnit& pending = *own_program_->find_unit(entry);
+    image_file_.clear();
+    image_file_.seekg(code_start_ + pending.offset);
+    if (!image_file_.read(reinterpret_cast<char*>(&own_program_->code[pending.offset]),
+                          pending.size)) {
+        log_execution_event("Unit read failed at " + std::to_string(entry));
+        return false;
+    }
+    if (!own_program_->make_resident(pending)) {
+        log_execution_event("Unit rejected at " + std::to_string(entry));
+        return false;
+    }
+    
+    auto name = program_->unit_names.find(entry);
+    log_execution_event("Unit loaded: " + (name != program_->unit_names.end() ? name->second :
+                                            std::to_string(entry)));
+    return true;
+}
+
+bool FrameRuntime::enter_verified(const ProgramUnit* unit) {
+    if (!unit || !unit->stack_verified ||
+        stack_.size() < static_cast<size_t>(-static_cast<int64_t>(unit->stack.lowest))) {
+        return false;
+    }
+    stack_.reserve(stack_.size() + static_cast<size_t>(unit->stack.highest));
+    return true;
+}
+
+void FrameRuntime::drop_to_checked() {
+    for (const auto& frame : frame_stack_) frame->stack_verified = false;
+    unchecked_ = false;
+}
+
+size_t FrameRuntime::get_verified_units() const {
+    size_t verified = 0;
+    for (const auto& unit : program_->units) {
+        if (unit.resident && unit.stack_verified) verified++;
+    }
+    return verified;
+}
+
 int FrameRuntime::execute() {
+    RuntimeMetrics::bump(metrics_->runs);
+    RuntimeMetrics::set(metrics_->running, 1);
+    int result = dispatch();
+    end_time_ = std::chrono::high_resolution_clock::now();
+    RuntimeMetrics::set(metrics_->running, 0);
+    publish_metrics();
+    return result;
+}
+
+int FrameRuntime::dispatch() {
   try {
   log_execution_event("Execution started");
         
-      while (program_counter_ < bytecode_.size()) {
-    uint8_t opcode = bytecode_[program_counter_++];
+        // Starting at a unit's entry (not resuming inside one) may verify
+        // the current frame for it
+        const ProgramUnit* entry = program_->find_unit(static_cast<uint32_t>(program_counter_));
+        if (current_frame_ && entry) current_frame_->stack_verified = enter_verified(entry);
+        sync_current_frame();
+        if (program_counter_ < range_start_) code_limit_ = 0;
+        
+      while (program_counter_ < code_limit_) {
+            size_t instruction_pc = program_counter_;
+    uint8_t opcode = code_[program_counter_++];
+            if (profiling_) profile_instruction(instruction_pc, opcode);
       
-        if (!execute_instruction(opcode)) {
-          if (self_healing_enabled_ && attempt_recovery()) {
+        bool executed = unchecked_ ?
+                execute_heip_opcode<false>(static_cast<HEIPOpcode>(opcode)) :
+                execute_instruction(opcode);
+        if (!executed) {
+            handle_execution_error("Fault at PC: " + std::to_string(instruction_pc));
+          // Faulting again at the same instruction right after a restore
+          // means the fault is deterministic
+          if (self_healing_enabled_ && instruction_pc != last_fault_pc_ && attempt_recovery()) {
+                last_fault_pc_ = instruction_pc;
         log_execution_event("Self-healing recovery successful");
      continue;
  }
-    std::cerr << "Execution failed at PC: " << program_counter_ - 1 << std::endl;
+    std::cerr << "Execution failed at PC: " << instruction_pc << std::endl;
            return 1;
       }
             
       instruction_count_++;
-       
-            // Check execution range
-     if (!in_range(static_cast<uint32_t>(program_counter_))) {
-        log_execution_event("Execution out of range");
-  break;
-}
+            if ((instruction_count_ & (kPublishInterval - 1)) == 0) publish_metrics();
  }
         
+    if (snapshot_reached_ && snapshot_stop_) {
+        snapshot_stop_ = false;
+        program_counter_ = snapshot_pc_;
+        log_execution_event("Stopped at HELP Snapshot");
+        return 0;
+    }
+    if (program_counter_ < code_size_) {
+        log_execution_event("Execution out of range");
+        return 0;
+    }
     log_execution_event("Execution completed successfully");
  return 0;
  
     } catch (const std::exception& e) {
         std::cerr << "Runtime exception: " << e.what() << std::endl;
+        handle_execution_error(e.what());
 
         if (self_healing_enabled_ && attempt_recovery()) {
             log_execution_event("Exception recovered");
-  return execute();  // Retry
+  return dispatch();  // Retry
         }
         
         return 1;
@@ -72,10 +418,13 @@ int FrameRuntime::execute() {
 }
 
 bool FrameRuntime::execute_instruction(uint8_t opcode) {
+    // Checked dispatch: room for the pushes here, depth checks per handler
     HEIPOpcode heip_opcode = static_cast<HEIPOpcode>(opcode);
-    return execute_heip_opcode(heip_opcode);
+    stack_.reserve(stack_.size() + kMaxPushes);
+    return execute_heip_opcode<true>(heip_opcode);
 }
 
+template <bool kChecked>
 bool FrameRuntime::execute_heip_opcode(HEIPOpcode opcode) {
  switch (opcode) {
       case HEIPOpcode::NOP:
@@ -83,131 +432,468 @@ bool FrameRuntime::execute_heip_opcode(HEIPOpcode opcode) {
             
         case HEIPOpcode::LOAD: {
  // Load value onto stack
-      if (program_counter_ + 4 > bytecode_.size()) return false;
-    uint32_t value = (bytecode_[program_counter_] << 24) |
-                 (bytecode_[program_counter_ + 1] << 16) |
-           (bytecode_[program_counter_ + 2] << 8) |
-           bytecode_[program_counter_ + 3];
+      if (program_counter_ + 4 > code_size_) return false;
+    uint32_t value = (code_[program_counter_] << 24) |
+                 (code_[program_counter_ + 1] << 16) |
+           (code_[program_counter_ + 2] << 8) |
+           code_[program_counter_ + 3];
      program_counter_ += 4;
-         stack_.push_back(value);
+         push_value(value);
           break;
         }
         
+        case HEIPOpcode::LOAD_I8: {
+            if (program_counter_ >= code_size_) return false;
+            push_value(static_cast<uint32_t>(static_cast<int8_t>(code_[program_counter_++])));
+            break;
+        }
+        
+        case HEIPOpcode::LOAD_F64: {
+            // Rebuilt through Value::number, so the bits can never forge
+            // a tagged value
+            uint32_t high, low;
+            if (!read_operand(high) || !read_operand(low)) return false;
+            uint64_t bits = (static_cast<uint64_t>(high) << 32) | low;
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            push(Value::number(value));
+            break;
+        }
+        
+        case HEIPOpcode::LOAD_STR: {
+            uint32_t index;
+            if (!read_operand(index) || index >= program_->strings.size()) return false;
+            push(Value::string(index));
+            break;
+        }
+        
     case HEIPOpcode::STORE: {
-     // Store top of stack to memory
-      if (stack_.empty()) return false;
-      uint32_t value = stack_.back();
-            stack_.pop_back();
+     // Store top of stack to memory as its 8-byte boxed form
+      if (kChecked && stack_.empty()) return false;
+      Value value = pop();
          
-     if (program_counter_ + 4 > bytecode_.size()) return false;
-       uint32_t address = (bytecode_[program_counter_] << 24) |
-      (bytecode_[program_counter_ + 1] << 16) |
-           (bytecode_[program_counter_ + 2] << 8) |
-          bytecode_[program_counter_ + 3];
-            program_counter_ += 4;
-            
-       if (address + 4 > memory_.size()) return false;
-    memory_[address] = (value >> 24) & 0xFF;
-        memory_[address + 1] = (value >> 16) & 0xFF;
-            memory_[address + 2] = (value >> 8) & 0xFF;
-  memory_[address + 3] = value & 0xFF;
+            uint32_t address;
+            if (!read_operand(address)) return false;
+       if (static_cast<size_t>(address) + 8 > kMemoryBytes) return false;
+            if (address + 8 > memory_.size()) memory_.resize(address + 8);
+            write_u32(&memory_[address], static_cast<uint32_t>(value.bits() >> 32));
+            write_u32(&memory_[address + 4], static_cast<uint32_t>(value.bits()));
             break;
      }
         
-        case HEIPOpcode::ADD: {
-          if (stack_.size() < 2) return false;
-            uint32_t b = stack_.back(); stack_.pop_back();
-            uint32_t a = stack_.back(); stack_.pop_back();
-   stack_.push_back(a + b);
-        break;
+        case HEIPOpcode::ADD:
+        case HEIPOpcode::SUB:
+        case HEIPOpcode::MUL:
+        case HEIPOpcode::DIV: {
+            if (kChecked && stack_.size() < 2) return false;
+            Value b = pop();
+            Value a = pop();
+            Value result;
+            if (!arithmetic(opcode, a, b, result)) return false;
+            push(result);
+            break;
         }
-     
-    case HEIPOpcode::SUB: {
-     if (stack_.size() < 2) return false;
-            uint32_t b = stack_.back(); stack_.pop_back();
-            uint32_t a = stack_.back(); stack_.pop_back();
-      stack_.push_back(a - b);
-   break;
+        
+        case HEIPOpcode::CMP: {
+            // Signed three-way result: -1, 0 or 1 (0 if either is NaN)
+            if (kChecked && stack_.size() < 2) return false;
+            Value b = pop();
+            Value a = pop();
+            if (a.is_int() && b.is_int()) {
+                push(Value::integer((a.as_int() > b.as_int()) - (a.as_int() < b.as_int())));
+            } else if (a.is_number() && b.is_number()) {
+                double x = a.to_double();
+                double y = b.to_double();
+                push(Value::integer((x > y) - (x < y)));
+            } else {
+                return false;
+            }
+            break;
         }
-     
-        case HEIPOpcode::MUL: {
-    if (stack_.size() < 2) return false;
-   uint32_t b = stack_.back(); stack_.pop_back();
-   uint32_t a = stack_.back(); stack_.pop_back();
-            stack_.push_back(a * b);
-  break;
+        
+        case HEIPOpcode::CMP_EQ:
+        case HEIPOpcode::CMP_NE:
+        case HEIPOpcode::CMP_LT:
+        case HEIPOpcode::CMP_LE:
+        case HEIPOpcode::CMP_GT:
+        case HEIPOpcode::CMP_GE: {
+            if (kChecked && stack_.size() < 2) return false;
+            Value b = pop();
+            Value a = pop();
+            bool result;
+            if (!relate(opcode, a, b, result)) return false;
+            push(Value::integer(result ? 1 : 0));
+            break;
         }
         
         case HEIPOpcode::CALL: {
-   // Save return address and jump
-            if (program_counter_ + 4 > bytecode_.size()) return false;
-       uint32_t target = (bytecode_[program_counter_] << 24) |
-             (bytecode_[program_counter_ + 1] << 16) |
-              (bytecode_[program_counter_ + 2] << 8) |
-   bytecode_[program_counter_ + 3];
-  program_counter_ += 4;
-       
-          stack_.push_back(static_cast<uint32_t>(program_counter_));
-     program_counter_ = target;
-  break;
-  }
-        
-        case HEIPOpcode::RET: {
-  if (stack_.empty()) return false;
-            program_counter_ = stack_.back();
-    stack_.pop_back();
-         break;
+            // The callee gets a fresh frame that records the return address
+            uint32_t target;
+            if (!read_operand(target)) return false;
+            return call_unit(target);
+        }
+        
+        case HEIPOpcode::TAILCALL: {
+            uint32_t target;
+            if (!read_operand(target)) return false;
+            return call_unit(target, true);
+        }
+        
+        case HEIPOpcode::RET:
+        case HEIPOpcode::FRAME_EXIT: {
+            return_from_frame();
+            break;
         }
         
         case HEIPOpcode::JMP: {
-   if (program_counter_ + 4 > bytecode_.size()) return false;
-        uint32_t target = (bytecode_[program_counter_] << 24) |
-           (bytecode_[program_counter_ + 1] << 16) |
-        (bytecode_[program_counter_ + 2] << 8) |
-           bytecode_[program_counter_ + 3];
-       program_counter_ = target;
-     break;
+            uint32_t target;
+            if (!read_operand(target) || target > code_size_) return false;
+            transfer_to(target);
+            break;
+        }
+        
+        case HEIPOpcode::JZ:
+        case HEIPOpcode::JNZ: {
+            size_t pc = program_counter_ - 1;
+            uint32_t target;
+            if (!read_operand(target) || target > code_size_) return false;
+            if (kChecked && stack_.empty()) return false;
+            bool zero = pop().is_zero();
+            bool taken = zero == (opcode == HEIPOpcode::JZ);
+            if (profiling_) profile_branch(pc, taken);
+            if (taken) transfer_to(target);
+            break;
+        }
+        
+        case HEIPOpcode::JEQ:
+        case HEIPOpcode::JNE:
+        case HEIPOpcode::JLT:
+        case HEIPOpcode::JLE:
+        case HEIPOpcode::JGT:
+        case HEIPOpcode::JGE: {
+            // Fused CMP_<relation>; JNZ (signed)
+            size_t pc = program_counter_ - 1;
+            uint32_t target;
+            if (!read_operand(target) || target > code_size_) return false;
+            if (kChecked && stack_.size() < 2) return false;
+            Value b = pop();
+            Value a = pop();
+            HEIPOpcode relation, jump;
+            split_superinstruction(opcode, relation, jump);
+            bool taken;
+            if (!relate(relation, a, b, taken)) return false;
+            if (profiling_) profile_branch(pc, taken);
+            if (taken) transfer_to(target);
+            break;
+        }
+        
+        case HEIPOpcode::ADD_IMM:
+        case HEIPOpcode::SUB_IMM:
+        case HEIPOpcode::ADD_I8:
+        case HEIPOpcode::SUB_I8: {
+            // Fused LOAD k; ADD/SUB
+            uint32_t value;
+            bool compact = opcode == HEIPOpcode::ADD_I8 || opcode == HEIPOpcode::SUB_I8;
+            if (!read_immediate(value, compact) || (kChecked && stack_.empty())) return false;
+            bool add = opcode == HEIPOpcode::ADD_IMM || opcode == HEIPOpcode::ADD_I8;
+            Value result;
+            if (!arithmetic(add ? HEIPOpcode::ADD : HEIPOpcode::SUB, pop(),
+                            Value::integer(static_cast<int32_t>(value)), result)) {
+                return false;
+            }
+            push(result);
+            break;
         }
  
         case HEIPOpcode::PUSH: {
-            if (stack_.empty()) return false;
+            if (kChecked && stack_.empty()) return false;
          // Push is implicit in our stack machine
         break;
         }
       
         case HEIPOpcode::POP: {
-            if (stack_.empty()) return false;
-            stack_.pop_back();
+            if (kChecked && stack_.empty()) return false;
+            pop_value();
+            break;
+        }
+        
+        case HEIPOpcode::ALLOC: {
+            // Operands: kind (1 byte), capacity (4 bytes)
+            heap_.safepoint();
+            if (program_counter_ + 1 > code_size_) return false;
+            uint8_t kind = code_[program_counter_++];
+            uint32_t capacity;
+            if (!read_operand(capacity) || capacity > GCHeap::kMaxCapacity) return false;
+            
+            HeapRef ref;
+            if (kind == static_cast<uint8_t>(ObjectKind::BUBBLE)) {
+                ref = heap_.allocate_bubble(capacity);
+            } else if (kind == static_cast<uint8_t>(ObjectKind::CHAIN)) {
+                ref = chains_.create();
+            } else if (kind == static_cast<uint8_t>(ObjectKind::ARRAY) ||
+                       kind == static_cast<uint8_t>(ObjectKind::CASE)) {
+                ref = heap_.allocate(static_cast<ObjectKind>(kind), capacity);
+            } else {
+                return false;
+            }
+            if (ref == kNullRef) return false;
+            push_value(ref, kTagRef);
+            break;
+        }
+        
+        case HEIPOpcode::FREE: {
+            // Drop the reference; the collector reclaims unreachable objects
+            HeapRef ref;
+            if (!pop_ref(ref)) return false;
+            break;
+        }
+        
+        case HEIPOpcode::SLOT_LOAD:
+        case HEIPOpcode::SLOT_LOAD_U8: {
+            uint32_t slot;
+            if (!read_operand(slot, opcode == HEIPOpcode::SLOT_LOAD_U8)) return false;
+            if (!current_frame_ || slot >= current_frame_->slots.size()) return false;
+            push(current_frame_->slots[slot]);
+            break;
+        }
+        
+        case HEIPOpcode::SLOT_STORE:
+        case HEIPOpcode::SLOT_STORE_U8: {
+            uint32_t slot;
+            if (!read_operand(slot, opcode == HEIPOpcode::SLOT_STORE_U8)) return false;
+            if (!current_frame_ || (kChecked && stack_.empty())) return false;
+            if (!reach_slot(slot)) return false;
+            current_frame_->slots[slot] = pop();
+            break;
+        }
+        
+        case HEIPOpcode::SLOT_LOAD2:
+        case HEIPOpcode::SLOT_LOAD2_U8: {
+            uint32_t first, second;
+            bool compact = opcode == HEIPOpcode::SLOT_LOAD2_U8;
+            if (!read_operand(first, compact) || !read_operand(second, compact)) return false;
+            if (!current_frame_ || first >= current_frame_->slots.size() ||
+                second >= current_frame_->slots.size()) {
+                return false;
+            }
+            push(current_frame_->slots[first]);
+            push(current_frame_->slots[second]);
+            break;
+        }
+        
+        case HEIPOpcode::SLOT_TEE:
+        case HEIPOpcode::SLOT_TEE_U8: {
+            // Store the top of the stack and keep it there
+            uint32_t slot;
+            if (!read_operand(slot, opcode == HEIPOpcode::SLOT_TEE_U8)) return false;
+            if (!current_frame_ || (kChecked && stack_.empty())) return false;
+            if (!reach_slot(slot)) return false;
+            current_frame_->slots[slot] = stack_.back();
+            break;
+        }
+        
+        case HEIPOpcode::ELEM_LOAD: {
+            if (kChecked && stack_.size() < 2) return false;
+            uint32_t index = pop_value();
+            HeapRef ref;
+            if (!pop_ref(ref)) return false;
+            
+            if (heap_.kind(ref) == ObjectKind::CHAIN) {
+                uint32_t value;
+                uint8_t tag;
+                if (!chains_.get(ref, index, value, tag)) return false;
+                push_cell(value, tag);
+            } else {
+                if (index >= heap_.length(ref)) return false;
+                push_cell(heap_.element(ref, index), heap_.element_tag(ref, index));
+            }
             break;
         }
         
+        case HEIPOpcode::ELEM_STORE: {
+            if (kChecked && stack_.size() < 3) return false;
+            uint8_t tag;
+            uint32_t value;
+            if (!pop_cell(value, tag)) return false;
+            uint32_t index = pop_value();
+            HeapRef ref;
+            if (!pop_ref(ref)) return false;
+            if (heap_.kind(ref) == ObjectKind::CHAIN) return false;  // Immutable
+            if (index >= heap_.length(ref)) return false;
+            heap_.set_element(ref, index, value, tag);
+            break;
+        }
+        
+        case HEIPOpcode::ELEM_COUNT: {
+            HeapRef ref;
+            if (!pop_ref(ref)) return false;
+            push_value(heap_.kind(ref) == ObjectKind::CHAIN ?
+                       chains_.count(ref) : heap_.length(ref));
+            break;
+        }
+        
+        case HEIPOpcode::CHAIN_NEW: {
+            // Builds a Chain from the top `count` stack entries
+            heap_.safepoint();
+            uint32_t count;
+            if (!read_operand(count) || (kChecked && count > stack_.size())) return false;
+            std::vector<uint32_t> cells(count);
+            std::vector<uint8_t> tags(count);
+            for (uint32_t i = count; i > 0; i--) {
+                if (!pop_cell(cells[i - 1], tags[i - 1])) return false;
+            }
+            HeapRef chain = chains_.from_values(cells.data(), tags.data(), count);
+            push_value(chain, kTagRef);
+            break;
+        }
+        
+        case HEIPOpcode::CHAIN_APPEND: {
+            heap_.safepoint();
+            if (kChecked && stack_.size() < 2) return false;
+            uint8_t tag;
+            uint32_t value;
+            if (!pop_cell(value, tag)) return false;
+            HeapRef chain;
+            if (!pop_ref(chain) || heap_.kind(chain) != ObjectKind::CHAIN) return false;
+            push_value(chains_.append(chain, value, tag), kTagRef);
+            break;
+        }
+        
+        case HEIPOpcode::CHAIN_SET: {
+            heap_.safepoint();
+            if (kChecked && stack_.size() < 3) return false;
+            uint8_t tag;
+            uint32_t value;
+            if (!pop_cell(value, tag)) return false;
+            uint32_t index = pop_value();
+            HeapRef chain;
+            if (!pop_ref(chain) || heap_.kind(chain) != ObjectKind::CHAIN) return false;
+            if (index >= chains_.count(chain)) return false;
+            push_value(chains_.update(chain, index, value, tag), kTagRef);
+            break;
+        }
+        
+        case HEIPOpcode::CHAIN_SLICE: {
+            heap_.safepoint();
+            if (kChecked && stack_.size() < 3) return false;
+            uint32_t end = pop_value();
+            uint32_t start = pop_value();
+            HeapRef chain;
+            if (!pop_ref(chain) || heap_.kind(chain) != ObjectKind::CHAIN) return false;
+            push_value(chains_.slice(chain, start, end), kTagRef);
+            break;
+        }
+        
+        case HEIPOpcode::BUBBLE_PUSH: {
+            heap_.safepoint();
+            if (kChecked && stack_.size() < 2) return false;
+            uint8_t tag;
+            uint32_t value;
+            if (!pop_cell(value, tag)) return false;
+            HeapRef ref;
+            if (!pop_ref(ref) || heap_.kind(ref) != ObjectKind::BUBBLE) return false;
+            if (!heap_.bubble_push(ref, value, tag)) return false;
+            break;
+        }
+        
+        case HEIPOpcode::VADD:
+        case HEIPOpcode::VSUB:
+        case HEIPOpcode::VMUL:
+        case HEIPOpcode::VSUM:
+        case HEIPOpcode::VMIN:
+        case HEIPOpcode::VMAX:
+        case HEIPOpcode::VCMPEQ:
+        case HEIPOpcode::VCMPLT:
+        case HEIPOpcode::VCMPGT:
+            return execute_vector_opcode(opcode);
+        
         case HEIPOpcode::FRAME_CREATE: {
+            // Operand: slot count; slots start zeroed, then checkpoint
+            uint32_t slot_count;
+            if (!read_operand(slot_count) || !current_frame_) return false;
+            if (slot_count > BytecodeImage::kMaxSlots) return false;
+            current_frame_->slots.assign(slot_count, Value());
       create_checkpoint();
             log_execution_event("Frame created");
           break;
         }
-  
-        case HEIPOpcode::FRAME_EXIT: {
-    log_execution_event("Frame exited");
-   break;
-        }
      
+        case HEIPOpcode::INLINE_ENTER: {
+            inline_marks_.push_back(InlineMark{program_counter_, stack_.size(),
+                                               frame_stack_.size()});
+            break;
+        }
+        
+        case HEIPOpcode::INLINE_EXIT: {
+            if (inline_marks_.empty()) return false;
+            inline_marks_.pop_back();
+            break;
+        }
+        
         case HEIPOpcode::HELP_LEARN: {
        log_execution_event("HELP learning invoked");
  break;
         }
         
+        case HEIPOpcode::HELP_ADAPT: {
+            log_execution_event("HELP adaptation invoked");
+            break;
+        }
+        
+        case HEIPOpcode::HELP_RECOMMEND: {
+            log_execution_event("HELP recommendation requested");
+            break;
+        }
+        
+        case HEIPOpcode::HELP_SNAPSHOT: {
+            // Ends the loop; execute() moves back to the next instruction
+            if (!snapshot_stop_ || snapshot_reached_) break;
+            snapshot_reached_ = true;
+            snapshot_pc_ = program_counter_;
+            program_counter_ = code_size_;
+            break;
+        }
+        
         case HEIPOpcode::HELP_HEAL: {
+            // Heal point: later faults in this frame restore to here
+            // instead of the frame start
   log_execution_event("HELP self-healing triggered");
-      attempt_recovery();
+            create_checkpoint();
             break;
         }
         
-        case HEIPOpcode::OVERLAY_EXPAND: {
-     // Overlay expansion handled during compilation
-  log_execution_event("Overlay expanded");
+        case HEIPOpcode::SYMBOL_RESOLVE: {
+            // Operand: site; resolves the symbol on the stack to its entry
+            uint32_t site;
+            if (!read_operand(site) || (kChecked && stack_.empty())) return false;
+            const ResolvedTarget* target =
+                resolver_.resolve_symbol(site, pop_value());
+            if (!target) return false;
+            push_value(target->entry);
             break;
-   }
+        }
+        
+        case HEIPOpcode::OVERLAY_EXPAND: {
+            // Operands: site, symbol; runs the overlay's shared body, which
+            // the site's inline cache resolves without a table lookup
+            uint32_t site, symbol;
+            if (!read_operand(site) || !read_operand(symbol)) return false;
+            const ResolvedTarget* target = resolver_.resolve_symbol(site, symbol);
+            if (!target) return false;
+            // Verification assumed the binding the image was loaded with
+            if (!kChecked && (symbol >= program_->symbol_entries.size() ||
+                              program_->symbol_entries[symbol] != target->entry)) {
+                drop_to_checked();
+            }
+            return call_unit(target->entry);
+        }
+        
+        case HEIPOpcode::SUPERLATIVE: {
+            // Operands: site, Superlative
+            uint32_t site, superlative;
+            if (!read_operand(site) || !read_operand(superlative)) return false;
+            return call_superlative(site, superlative, kChecked);
+        }
         
         default:
       return false;
@@ -216,6 +902,54 @@ bool FrameRuntime::execute_heip_opcode(HEIPOpcode opcode) {
     return true;
 }
 
+bool FrameRuntime::execute_vector_opcode(HEIPOpcode opcode) {
+    // One dispatch per batch: operands are whole numeric containers
+    heap_.safepoint();
+    
+    if (opcode == HEIPOpcode::VSUM || opcode == HEIPOpcode::VMIN ||
+        opcode == HEIPOpcode::VMAX) {
+        HeapRef a;
+        if (!pop_numeric(a)) return false;
+        uint32_t n = heap_.length(a);
+        const uint32_t* cells = heap_.element_cells(a);
+        
+        if (opcode == HEIPOpcode::VSUM) {
+            push_value(simd_->sum(cells, n));
+        } else {
+            if (n == 0) return false;
+            push_value(opcode == HEIPOpcode::VMIN ? simd_->min(cells, n) : simd_->max(cells, n));
+        }
+        return true;
+    }
+    
+    HeapRef a, b;
+    if (!pop_numeric(b) || !pop_numeric(a)) return false;
+    uint32_t n = heap_.length(a);
+    if (heap_.length(b) != n) return false;
+    
+    // Allocation never collects, so a and b stay put; fetch cell
+    // pointers only after it since the old space may have grown
+    HeapRef result = heap_.allocate_bubble(n);
+    if (result == kNullRef) return false;
+    heap_.set_length(result, n);
+    const uint32_t* pa = heap_.element_cells(a);
+    const uint32_t* pb = heap_.element_cells(b);
+    uint32_t* out = heap_.element_cells(result);
+    
+    switch (opcode) {
+        case HEIPOpcode::VADD: simd_->add(pa, pb, out, n); break;
+        case HEIPOpcode::VSUB: simd_->sub(pa, pb, out, n); break;
+        case HEIPOpcode::VMUL: simd_->mul(pa, pb, out, n); break;
+        case HEIPOpcode::VCMPEQ: simd_->cmp_eq(pa, pb, out, n); break;
+        case HEIPOpcode::VCMPLT: simd_->cmp_lt(pa, pb, out, n); break;
+        case HEIPOpcode::VCMPGT: simd_->cmp_gt(pa, pb, out, n); break;
+        default: return false;
+    }
+    
+    push_value(result, kTagRef);
+    return true;
+}
+
 std::shared_ptr<Frame> FrameRuntime::create_frame(const std::string& name) {
     auto frame = std::make_shared<Frame>();
     frame->name = name;
@@ -223,14 +957,18 @@ std::shared_ptr<Frame> FrameRuntime::create_frame(const std::string& name) {
     frame->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::high_resolution_clock::now().time_since_epoch()
     ).count();
+    frame->return_pc = 0;
+    frame->stack_verified = false;
     frame->can_recover = true;
     
     frame_stack_.push_back(frame);
+    RuntimeMetrics::bump(metrics_->frames_created);
     return frame;
 }
 
 void FrameRuntime::enter_frame(std::shared_ptr<Frame> frame) {
     current_frame_ = frame;
+    sync_current_frame();
     log_execution_event("Entered frame: " + frame->name);
 }
 
@@ -242,61 +980,334 @@ void FrameRuntime::exit_frame() {
     if (!frame_stack_.empty()) {
   current_frame_ = frame_stack_.back();
     }
+    sync_current_frame();
     
   log_execution_event("Exited frame");
 }
 
-void FrameRuntime::save_state() {
-    // Save current execution state
-  std::vector<uint8_t> state;
+bool FrameRuntime::call_unit(uint32_t entry, bool tail) {
+    // The root frame ends the run when it exits, and an inlined body's heal
+    // point needs the frame it was entered in: both take a plain call
+    tail = tail && frame_stack_.size() > 1 &&
+           (inline_marks_.empty() || inline_marks_.back().frame_depth < frame_stack_.size());
+    if (entry >= code_size_ || (!tail && frame_stack_.size() >= kMaxCallDepth)) return false;
+    if (!ensure_resident(entry)) return false;
+    if (profiling_) unit_calls_[entry]++;
+    const ProgramUnit* unit = program_->find_unit(entry);
+    bool pure = unit && unit->pure_verified;
+    if (!pure && !memo_pending_.empty()) memo_pending_.clear();
+    if (workers_ && workers_->delegates(entry) && can_delegate(entry)) return delegate_call(entry);
+    if (pure && !tail && memo_.capacity() > 0 && memo_call(entry, *unit)) return true;
     
-    // Save program counter
-    state.push_back((program_counter_ >> 24) & 0xFF);
-    state.push_back((program_counter_ >> 16) & 0xFF);
-    state.push_back((program_counter_ >> 8) & 0xFF);
-    state.push_back(program_counter_ & 0xFF);
+    // An unchecked caller was verified against the callee's claimed effect
+    bool verified = enter_verified(unit);
+    if (unchecked_ && !verified) drop_to_checked();
     
-// Save stack
-    for (uint32_t val : stack_) {
-  state.push_back((val >> 24) & 0xFF);
-     state.push_back((val >> 16) & 0xFF);
-        state.push_back((val >> 8) & 0xFF);
-        state.push_back(val & 0xFF);
+    auto name = program_->unit_names.find(entry);
+    std::string frame_name = name != program_->unit_names.end() ? name->second : std::string();
+    if (tail) {
+        // Same frame and return address; the callee's FRAME_CREATE resizes
+        // the slots and retakes the checkpoint in the buffers already there
+        current_frame_->name = frame_name;
+        current_frame_->execution_range.reset();
+        current_frame_->stack_verified = verified;
+        current_frame_->can_recover = true;
+        sync_current_frame();
+        log_execution_event("Tail call into frame: " + frame_name);
+    } else {
+        auto frame = create_frame(frame_name);
+        frame->return_pc = static_cast<uint32_t>(program_counter_);
+        frame->stack_verified = verified;
+        enter_frame(frame);
+    }
+    transfer_to(entry);
+    return true;
+}
+
+bool FrameRuntime::can_delegate(uint32_t entry) const {
+    // Heap references only mean something in this process
+    size_t arg_count = static_cast<size_t>(-program_->find_unit(entry)->stack.lowest);
+    return stack_.size() >= arg_count &&
+           std::none_of(stack_.end() - arg_count, stack_.end(),
+                        [](const Value& value) { return value.is_ref(); });
+}
+
+bool FrameRuntime::delegate_call(uint32_t entry) {
+    // Arguments stay on the stack until the worker answers, so a failed
+    // call faults with the caller's state intact
+    const ProgramUnit* unit = program_->find_unit(entry);
+    size_t arg_count = static_cast<size_t>(-unit->stack.lowest);
+    std::string error;
+    std::vector<Value> results;
+    if (!workers_->call(entry, stack_.end() - arg_count, arg_count, results, error)) {
+        log_execution_event("Delegated call failed: " + error);
+        return false;
     }
     
-    if (current_frame_) {
-     current_frame_->checkpoint_state = state;
+    for (size_t i = 0; i < arg_count; i++) pop();
+    stack_.reserve(stack_.size() + results.size() + kMaxPushes);
+    for (Value value : results) push(value);
+    return true;
+}
+
+bool FrameRuntime::memo_call(uint32_t entry, const ProgramUnit& unit) {
+    // Heap references move in a collection, so calls with them just run
+    size_t arg_count = static_cast<size_t>(-unit.stack.lowest);
+    if (stack_.size() < arg_count) return false;
+    const Value* args = stack_.end() - arg_count;
+    if (std::any_of(args, args + arg_count, [](const Value& v) { return v.is_ref(); })) {
+        return false;
+    }
+    
+    if (const std::vector<Value>* results = memo_.find(entry, args, arg_count)) {
+        for (size_t i = 0; i < arg_count; i++) pop();
+        stack_.reserve(stack_.size() + results->size() + kMaxPushes);
+        for (Value value : *results) push(value);
+        return true;
+    }
+    memo_pending_.push_back(PendingMemo{frame_stack_.size() + 1, entry,
+                                        std::vector<Value>(args, args + arg_count),
+                                        static_cast<size_t>(unit.stack.net - unit.stack.lowest)});
+    return false;
+}
+
+void FrameRuntime::record_memo() {
+    // A tail call may have replaced the frame's unit; its results are
+    // still the original call's
+    const PendingMemo& call = memo_pending_.back();
+    if (stack_.size() >= call.result_count) {
+        const Value* results = stack_.end() - call.result_count;
+        if (std::none_of(results, results + call.result_count,
+                         [](const Value& v) { return v.is_ref(); })) {
+            memo_.insert(call.entry, call.args.data(), call.args.size(), results,
+                         call.result_count);
+        }
+    }
+    memo_pending_.pop_back();
+}
+
+bool FrameRuntime::call_superlative(uint32_t site, uint32_t superlative, bool checked) {
+    // The site's inline cache holds the current winner; a miss ranks the
+    // candidates by the costs recorded so far
+    uint32_t candidate;
+    const ResolvedTarget* target = resolver_.resolve_superlative(site, superlative, candidate);
+    if (!target) return false;
+    
+    // Verification assumed the candidates the image was loaded with
+    if (!checked && (superlative >= program_->superlatives.size() ||
+                     candidate >= program_->superlatives[superlative].entries.size() ||
+                     program_->superlatives[superlative].entries[candidate] != target->entry)) {
+        drop_to_checked();
+    }
+    
+    // Memoized and delegated calls make no frame and cost nothing here
+    size_t depth = frame_stack_.size();
+    if (!call_unit(target->entry)) return false;
+    if (frame_stack_.size() > depth) {
+        cost_pending_.push_back(PendingCost{frame_stack_.size(), superlative, candidate,
+                                            instruction_count_});
+    } else {
+        resolver_.record_cost(superlative, candidate, 0);
+    }
+    return true;
+}
+
+void FrameRuntime::return_from_frame() {
+    if (!memo_pending_.empty() && memo_pending_.back().frame_depth == frame_stack_.size()) {
+        record_memo();
+    }
+    if (!cost_pending_.empty() && cost_pending_.back().frame_depth == frame_stack_.size()) {
+        const PendingCost& call = cost_pending_.back();
+        resolver_.record_cost(call.superlative, call.candidate, instruction_count_ - call.start);
+        cost_pending_.pop_back();
+    }
+    
+    // Leaving the outermost frame ends the program
+    if (frame_stack_.size() <= 1) {
+        program_counter_ = code_size_;
+        log_execution_event("Frame exited");
+        return;
     }
+    
+    uint32_t resume = current_frame_->return_pc;
+    exit_frame();
+    transfer_to(resume);
+}
+
+void FrameRuntime::enable_profiling(bool enable) {
+    profiling_ = enable;
+    if (!enable) return;
+    opcode_pairs_.assign(256 * 256, 0);
+    index_profile_sites();
+}
+
+void FrameRuntime::index_profile_sites() {
+    // The first site at an offset keeps it
+    site_at_pc_.assign(code_size_, -1);
+    for (size_t i = 0; i < site_counters_.size(); i++) {
+        uint32_t offset = site_counters_[i].site.offset;
+        if (offset < site_at_pc_.size() && site_at_pc_[offset] < 0) {
+            site_at_pc_[offset] = static_cast<int32_t>(i);
+        }
+    }
+}
+
+void FrameRuntime::profile_instruction(size_t pc, uint8_t opcode) {
+    // Superinstructions count as the pair they replace and compact forms
+    // as their 4-byte ones, so a profile of a linked image still selects
+    // the same fusions
+    opcode = static_cast<uint8_t>(wide_form(static_cast<HEIPOpcode>(opcode)));
+    auto count = [this](uint8_t next) {
+        if (last_opcode_ <= 0xFF) opcode_pairs_[(last_opcode_ << 8) | next]++;
+        last_opcode_ = next;
+    };
+    HEIPOpcode first, second;
+    if (split_superinstruction(static_cast<HEIPOpcode>(opcode), first, second)) {
+        count(static_cast<uint8_t>(first));
+        count(static_cast<uint8_t>(second));
+    } else {
+        count(opcode);
+    }
+    
+    if (pc < site_at_pc_.size() && site_at_pc_[pc] >= 0) {
+        SiteCounter& counter = site_counters_[site_at_pc_[pc]];
+        if (counter.site.kind == SiteKind::INLINE) counter.taken++;
+    }
+}
+
+void FrameRuntime::profile_branch(size_t pc, bool taken) {
+    if (pc >= site_at_pc_.size() || site_at_pc_[pc] < 0) return;
+    SiteCounter& counter = site_counters_[site_at_pc_[pc]];
+    if (counter.site.kind == SiteKind::INLINE) return;
+    (taken ? counter.taken : counter.not_taken)++;
+}
+
+void FrameRuntime::collect_profile(ExecutionProfile& profile) const {
+    profile.add_run();
+    for (const auto& call : unit_calls_) {
+        auto name = program_->unit_names.find(call.first);
+        if (name != program_->unit_names.end()) profile.add_calls(name->second, call.second);
+    }
+    
+    // Branch sites record taken/not taken; the profile wants how often the
+    // If/While condition held
+    for (const auto& counter : site_counters_) {
+        const std::string& source = program_->sources[counter.site.source];
+        switch (counter.site.kind) {
+            case SiteKind::INLINE:
+                profile.add_calls(source, counter.taken);
+                break;
+            case SiteKind::BRANCH:
+                profile.add_branch(source, counter.site.line, counter.taken, counter.not_taken);
+                break;
+            case SiteKind::BRANCH_INVERTED:
+                profile.add_branch(source, counter.site.line, counter.not_taken, counter.taken);
+                break;
+        }
+    }
+    
+    for (size_t i = 0; i < opcode_pairs_.size(); i++) {
+        profile.add_pair(static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i), opcode_pairs_[i]);
+    }
+}
+
+bool FrameRuntime::reach_slot(uint32_t slot) {
+    // Stores past FRAME_CREATE's count grow the frame, within kMaxSlots
+    if (slot >= BytecodeImage::kMaxSlots) return false;
+    if (slot >= current_frame_->slots.size()) {
+        current_frame_->slots.resize(static_cast<size_t>(slot) + 1);
+    }
+    return true;
+}
+
+void FrameRuntime::save_state() {
+    // Save current execution state into the frame's checkpoint, reusing
+    // its buffer: PC, slot count, then the slots and the operand stack as
+    // 8-byte boxed values
+    if (!current_frame_) return;
+    std::vector<uint8_t>& state = current_frame_->checkpoint_state;
+    const std::vector<Value>& slots = current_frame_->slots;
+    state.resize(kCheckpointHeader);
+    state.reserve(kCheckpointHeader + 8 * (slots.size() + stack_.size()));
+    write_u32(&state[0], static_cast<uint32_t>(program_counter_));
+    write_u32(&state[4], static_cast<uint32_t>(slots.size()));
+    
+    auto save = [&state](const Value& value) {
+        uint8_t bytes[8];
+        write_u32(bytes, static_cast<uint32_t>(value.bits() >> 32));
+        write_u32(bytes + 4, static_cast<uint32_t>(value.bits()));
+        state.insert(state.end(), bytes, bytes + 8);
+    };
+    for (const Value& value : slots) save(value);
+    for (const Value& value : stack_) save(value);
+}
+
+bool FrameRuntime::valid_checkpoint(const std::vector<uint8_t>& state) {
+    if (state.empty()) return true;
+    if (state.size() < kCheckpointHeader || (state.size() - kCheckpointHeader) % 8 != 0) {
+        return false;
+    }
+    return read_u32(&state[4]) <= (state.size() - kCheckpointHeader) / 8;
 }
 
 void FrameRuntime::restore_state() {
     if (current_frame_ && !current_frame_->checkpoint_state.empty()) {
         const auto& state = current_frame_->checkpoint_state;
+        auto value_at = [&state](size_t i) {
+            return Value::from_bits((static_cast<uint64_t>(read_u32(&state[i])) << 32) |
+                                    read_u32(&state[i + 4]));
+        };
         
-        // Restore program counter
-        program_counter_ = (state[0] << 24) | (state[1] << 16) | 
-          (state[2] << 8) | state[3];
+        transfer_to(read_u32(&state[0]));
         
-        // Restore stack
-     stack_.clear();
-    for (size_t i = 4; i < state.size(); i += 4) {
-            uint32_t val = (state[i] << 24) | (state[i+1] << 16) | 
-             (state[i+2] << 8) | state[i+3];
- stack_.push_back(val);
-    }
+        // Slots changed since the checkpoint would otherwise be replayed
+        // against
+        size_t i = kCheckpointHeader;
+        current_frame_->slots.resize(read_u32(&state[4]));
+        for (Value& slot : current_frame_->slots) {
+            slot = value_at(i);
+            i += 8;
+        }
+        
+        stack_.clear();
+        stack_.reserve((state.size() - i) / 8);
+        for (; i + 8 <= state.size(); i += 8) push(value_at(i));
         
-     log_execution_event("State restored from checkpoint");
+        log_execution_event("State restored from checkpoint");
     }
 }
 
 void FrameRuntime::create_checkpoint() {
     save_state();
     log_execution_event("Checkpoint created");
+    RuntimeMetrics::bump(metrics_->checkpoints);
 }
 
 bool FrameRuntime::attempt_recovery() {
     log_execution_event("Attempting self-healing recovery");
     
+    // A restore can leave depths no verification covered
+    drop_to_checked();
+    
+    // A healed call's results are not the unit's own; do not keep them
+    while (!memo_pending_.empty() && memo_pending_.back().frame_depth >= frame_stack_.size()) {
+        memo_pending_.pop_back();
+    }
+    
+    // Inlined bodies never pop below their entry depth, so cutting the
+    // stack back restores it exactly
+    if (!inline_marks_.empty() && inline_marks_.back().frame_depth == frame_stack_.size() &&
+        stack_.size() >= inline_marks_.back().stack_depth) {
+        const InlineMark& mark = inline_marks_.back();
+        transfer_to(mark.restart_pc);
+        while (stack_.size() > mark.stack_depth) pop_value();
+        error_log_.clear();
+        log_execution_event("State restored from inline heal point");
+        RuntimeMetrics::bump(metrics_->recoveries);
+        publish_metrics();
+        return true;
+    }
+    
     // Try to restore from checkpoint
     restore_state();
     
@@ -304,7 +1315,10 @@ bool FrameRuntime::attempt_recovery() {
     error_log_.clear();
     
     // Recovery successful if we have a valid checkpoint
-    return current_frame_ && !current_frame_->checkpoint_state.empty();
+    bool recovered = current_frame_ && !current_frame_->checkpoint_state.empty();
+    if (recovered) RuntimeMetrics::bump(metrics_->recoveries);
+    publish_metrics();
+    return recovered;
 }
 
 void FrameRuntime::set_execution_range(uint32_t start, uint32_t end) {
@@ -313,6 +1327,18 @@ void FrameRuntime::set_execution_range(uint32_t start, uint32_t end) {
         range->start = start;
         range->end = end;
         current_frame_->execution_range = range;
+        sync_current_frame();
+    }
+}
+
+void FrameRuntime::sync_current_frame() {
+    unchecked_ = current_frame_ && current_frame_->stack_verified;
+    range_start_ = 0;
+    code_limit_ = code_size_;
+    if (current_frame_ && current_frame_->execution_range) {
+        const Range& range = *current_frame_->execution_range;
+        range_start_ = range.start;
+        code_limit_ = std::min(code_limit_, static_cast<size_t>(range.end) + 1);
     }
 }
 
@@ -325,25 +1351,145 @@ bool FrameRuntime::in_range(uint32_t position) const {
 }
 
 uint64_t FrameRuntime::get_execution_time_us() const {
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
- end_time_ - start_time_
-    );
+    // Still running: time so far
+    auto end = metrics_->running.load(std::memory_order_relaxed) ?
+               std::chrono::high_resolution_clock::now() : end_time_;
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start_time_);
     return static_cast<uint64_t>(duration.count());
 }
 
+void FrameRuntime::push_value(uint32_t value, uint8_t tag) {
+    stack_.push(tag == kTagRef ? Value::reference(value) :
+                                      Value::integer(static_cast<int32_t>(value)));
+}
+
+uint32_t FrameRuntime::pop_value() {
+    return pop().to_u32();
+}
+
+bool FrameRuntime::pop_cell(uint32_t& cell, uint8_t& tag) {
+    if (stack_.empty()) return false;
+    Value value = pop();
+    if (value.is_double()) {
+        // Allocation never collects, so the box stays put until stored
+        HeapRef box = heap_.allocate(ObjectKind::BOX, 2);
+        if (box == kNullRef) return false;
+        heap_.set_cell(box, 0, static_cast<uint32_t>(value.bits() >> 32), kTagValue);
+        heap_.set_cell(box, 1, static_cast<uint32_t>(value.bits()), kTagValue);
+        cell = box;
+        tag = kTagRef;
+        return true;
+    }
+    cell = value.payload();
+    tag = value.is_ref() ? kTagRef : value.is_string() ? kTagString : kTagValue;
+    return true;
+}
+
+void FrameRuntime::push_cell(uint32_t cell, uint8_t tag) {
+    if (tag == kTagString) {
+        push(Value::string(cell));
+    } else if (tag == kTagRef && heap_.kind(cell) == ObjectKind::BOX) {
+        push(Value::from_bits((static_cast<uint64_t>(heap_.get_cell(cell, 0)) << 32) |
+                              heap_.get_cell(cell, 1)));
+    } else {
+        push_value(cell, tag);
+    }
+}
+
+bool FrameRuntime::pop_ref(HeapRef& ref) {
+    if (stack_.empty() || !stack_.back().is_ref()) return false;
+    ref = pop().payload();
+    return heap_.is_valid(ref);
+}
+
+bool FrameRuntime::pop_numeric(HeapRef& ref) {
+    // Vector operands must be contiguous and hold no references
+    if (!pop_ref(ref)) return false;
+    ObjectKind kind = heap_.kind(ref);
+    if (kind == ObjectKind::CHAIN || kind == ObjectKind::CHAIN_NODE) return false;
+    return !heap_.has_refs(ref);
+}
+
+bool FrameRuntime::read_operand(uint32_t& operand) {
+    if (program_counter_ + 4 > code_size_) return false;
+    operand = (code_[program_counter_] << 24) |
+              (code_[program_counter_ + 1] << 16) |
+              (code_[program_counter_ + 2] << 8) |
+              code_[program_counter_ + 3];
+    program_counter_ += 4;
+    return true;
+}
+
+void FrameRuntime::visit_roots(const GCHeap::RootVisitor& visit) {
+    auto visit_value = [&visit](Value& value) {
+        if (!value.is_ref()) return;
+        HeapRef ref = value.payload();
+        visit(ref);
+        value = Value::reference(ref);
+    };
+    
+    // Operand stack
+    for (auto& value : stack_) visit_value(value);
+    
+    for (const auto& frame : frame_stack_) {
+        // Frame slots
+        for (auto& value : frame->slots) visit_value(value);
+        
+        // Checkpointed slots and stack entries are patched in place
+        auto& state = frame->checkpoint_state;
+        for (size_t i = kCheckpointHeader; i + 8 <= state.size(); i += 8) {
+            Value value = Value::from_bits(
+                (static_cast<uint64_t>(read_u32(&state[i])) << 32) | read_u32(&state[i + 4]));
+            if (!value.is_ref()) continue;
+            visit_value(value);
+            write_u32(&state[i + 4], value.payload());
+        }
+    }
+}
+
 void FrameRuntime::log_execution_event(const std::string& event) {
     execution_log_.push_back(event);
 }
 
 bool FrameRuntime::handle_execution_error(const std::string& error) {
     error_log_.push_back(error);
+    RuntimeMetrics::bump(metrics_->faults);
     
-    // Update uptime percentage
-    float error_rate = static_cast<float>(error_log_.size()) / 
-          static_cast<float>(instruction_count_ + 1);
-    uptime_percentage_ = (1.0f - error_rate) * 100.0f;
+    // Update uptime percentage over the runtime's life; recovery clears
+    // error_log_, so this counts faults from the metrics
+    float error_rate = static_cast<float>(metrics_->faults.load(std::memory_order_relaxed)) /
+          static_cast<float>(instruction_count_ + retired_instructions_ + 1);
+    uptime_percentage_ = std::max(0.0f, (1.0f - error_rate) * 100.0f);
     
     return self_healing_enabled_;
 }
 
+bool FrameRuntime::export_metrics(const std::string& path, std::string& error) {
+    std::unique_ptr<MetricsSegment> segment(new MetricsSegment());
+    if (!segment->create(path, error)) return false;
+    
+    // Events counted so far carry over
+    RuntimeMetrics& metrics = *segment->get();
+    RuntimeMetrics::set(metrics.runs, metrics_->runs.load(std::memory_order_relaxed));
+    RuntimeMetrics::set(metrics.frames_created,
+                        metrics_->frames_created.load(std::memory_order_relaxed));
+    RuntimeMetrics::set(metrics.checkpoints, metrics_->checkpoints.load(std::memory_order_relaxed));
+    RuntimeMetrics::set(metrics.recoveries, metrics_->recoveries.load(std::memory_order_relaxed));
+    RuntimeMetrics::set(metrics.faults, metrics_->faults.load(std::memory_order_relaxed));
+    metrics_segment_ = std::move(segment);
+    metrics_ = &metrics;
+    publish_metrics();
+    return true;
+}
+
+void FrameRuntime::publish_metrics() {
+    const GCStats& gc = heap_.stats();
+    RuntimeMetrics::set(metrics_->instructions, retired_instructions_ + instruction_count_);
+    RuntimeMetrics::set(metrics_->ledger_entries, execution_log_.size());
+    RuntimeMetrics::set(metrics_->memory_bytes, memory_.size());
+    RuntimeMetrics::set(metrics_->heap_bytes, get_heap_used_bytes());
+    RuntimeMetrics::set(metrics_->gc_collections, gc.minor_collections + gc.major_collections);
+    RuntimeMetrics::set(metrics_->updated_us, wall_clock_us());
+}
+
 } // namespace heip
@@ -1,11 +1,52 @@
 #pragma once
 #include "../core/heip_types.h"
+#include "../core/bytecode_image.h"
+#include "../core/execution_profile.h"
+#include "gc_heap.h"
+#include "memo_table.h"
+#include "persistent_chain.h"
+#include "program.h"
+#include "runtime_metrics.h"
+#include "simd_kernels.h"
+#include "symbol_resolver.h"
+#include <algorithm>
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <fstream>
 
 namespace heip {
 
+class FranchiseWorkers;
+
+// Operand stack over storage that only grows when asked to. push and pop
+// never check: the checked dispatch loop reserves room for one
+// instruction's pushes, and a verified unit reserves its proven peak when
+// it is entered, so nothing reallocates inside its dispatch loop.
+class OperandStack {
+public:
+    OperandStack() : size_(0) {}
+    
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    Value& back() { return storage_[size_ - 1]; }
+    Value* begin() { return storage_.data(); }
+    Value* end() { return storage_.data() + size_; }
+    const Value* begin() const { return storage_.data(); }
+    const Value* end() const { return storage_.data() + size_; }
+    
+    void push(Value value) { storage_[size_++] = value; }
+    Value pop() { return storage_[--size_]; }
+    void clear() { size_ = 0; }
+    void reserve(size_t count) {
+        if (count > storage_.size()) storage_.resize(std::max(count, storage_.size() * 2));
+    }
+    
+private:
+    std::vector<Value> storage_;
+    size_t size_;
+};
+
 // Frame Interpreter Runtime (FIR)
 // The execution engine for H.E.I.P. compiled code
 class FrameRuntime {
@@ -17,13 +58,65 @@ public:
     bool load_bytecode(const std::vector<uint8_t>& bytecode);
     int execute();
     
+    // Runs a shared, fully loaded Program; the runtime only reads it.
+    // reset() then readies the runtime for another run of the same program
+    // (fresh root frame, empty stack, memory and heap) while keeping its
+    // allocations and warm inline caches, which is what pooled executions
+    // rely on.
+    void load_program(std::shared_ptr<const Program> program);
+    const std::shared_ptr<const Program>& get_program() const { return program_; }
+    void reset();
+    
+    // Runs one unit from a reset runtime with `args` on the stack, leaving
+    // what the unit left there in `results`; 0 on success
+    int run_unit(uint32_t entry, const Value* args, size_t arg_count, std::vector<Value>& results);
+    
+    // Calls into delegated franchises go to these workers, which must run
+    // this runtime's Program. A call whose arguments include a heap
+    // reference runs here instead; one the worker fails faults.
+    bool set_franchise_workers(std::shared_ptr<FranchiseWorkers> workers);
+    const FranchiseWorkers* get_franchise_workers() const { return workers_.get(); }
+    
+    // Memoization of pure units: a call whose arguments were seen before
+    // pushes the recorded results instead of running the unit. The table
+    // outlives reset(); capacity 0 turns it off.
+    void set_memo_capacity(size_t entries) { memo_.set_capacity(entries); }
+    const MemoTable& get_memo() const { return memo_; }
+    
+    // Lazy loading: reads an image file's tables and its entry unit only.
+    // Every other unit is read and validated on its first call, so startup
+    // and resident code grow with the code a run executes. The file stays
+    // open for the runtime's lifetime.
+    bool load_file(const std::string& path);
+    size_t get_code_bytes() const { return code_size_; }
+    size_t get_resident_code_bytes() const { return program_->resident_bytes; }
+    size_t get_unit_count() const { return program_->units.size(); }
+    size_t get_resident_units() const { return program_->resident_units; }
+    size_t get_verified_units() const;
+    
+    // Snapshots: with the stop set, execute() returns right after the
+    // first HELP Snapshot. save_snapshot then writes the image followed by
+    // the interpreter state (stack, memory, frames, heap, resident units);
+    // load_snapshot opens the embedded image lazily like load_file and
+    // restores that state, so execute() resumes after the HELP Snapshot.
+    // Both need an image opened from a file.
+    void set_snapshot_stop(bool stop) { snapshot_stop_ = stop; }
+    bool snapshot_reached() const { return snapshot_reached_; }
+    bool save_snapshot(const std::string& path);
+    bool load_snapshot(const std::string& path);
+    
     // Frame management
     std::shared_ptr<Frame> create_frame(const std::string& name);
     void enter_frame(std::shared_ptr<Frame> frame);
     void exit_frame();
     std::shared_ptr<Frame> current_frame() const { return current_frame_; }
+    std::shared_ptr<Frame> root_frame() const {
+        return frame_stack_.empty() ? nullptr : frame_stack_.front();
+    }
   
     // State management
+    static const size_t kCheckpointHeader = 8;   // PC, slot count
+    static bool valid_checkpoint(const std::vector<uint8_t>& state);
     void save_state();
   void restore_state();
     void create_checkpoint();
@@ -32,7 +125,19 @@ public:
     void enable_self_healing(bool enable) { self_healing_enabled_ = enable; }
     bool attempt_recovery();
     
-    // Range execution
+    // Symbol and superlative resolution (inline cached per site)
+    SymbolResolver& get_resolver() { return resolver_; }
+    const ResolverStats& get_resolver_stats() const { return resolver_.stats(); }
+    
+    // Profiling for `--profile-out`: counts the image's branch and inline
+    // sites, unit calls and executed opcode pairs; collect_profile adds
+    // them to `profile` as one run
+    void enable_profiling(bool enable);
+    void collect_profile(ExecutionProfile& profile) const;
+    
+    // Range execution: the current frame's range bounds the dispatch loop
+    // (code_limit_), so straight-line code runs unchecked; only branches,
+    // calls, returns and recovery compare against the range start
     void set_execution_range(uint32_t start, uint32_t end);
     bool in_range(uint32_t position) const;
 
@@ -40,38 +145,210 @@ public:
     uint64_t get_instruction_count() const { return instruction_count_; }
     uint64_t get_execution_time_us() const;
     float get_uptime_percentage() const { return uptime_percentage_; }
+    const char* get_vector_isa() const { return simd_->isa; }
+    const std::vector<std::string>& get_strings() const { return program_->strings; }   // By handle
+    const GCStats& get_gc_stats() const { return heap_.stats(); }
+    size_t get_heap_used_bytes() const {
+        return heap_.nursery_used_bytes() + heap_.old_used_bytes();
+    }
+    
+    // Live metrics, published while execute() runs: every
+    // kPublishInterval instructions and at checkpoints, recoveries and
+    // exit. export_metrics moves them into a shared file that `heip top`
+    // reads from another process.
+    bool export_metrics(const std::string& path, std::string& error);
+    const RuntimeMetrics& get_metrics() const { return *metrics_; }
     
 private:
-    // Bytecode execution
-    std::vector<uint8_t> bytecode_;
+    // Bytecode execution. code_ and code_size_ cache program_->code, which
+    // never reallocates once loaded. A lazily opened image has a Program of
+    // its own (own_program_) that ensure_resident fills in.
+    std::shared_ptr<const Program> program_;
+    std::shared_ptr<Program> own_program_;
+    const uint8_t* code_;
+    size_t code_size_;
     size_t program_counter_;
     
+    std::ifstream image_file_;
+    std::streamoff code_start_;            // Code section's offset in the file
+    std::streamoff image_base_;            // Image's offset and size in the file
+    std::streamoff image_size_;
+    bool lazy_;
+    bool open_image(const std::string& path, std::streamoff base, std::streamoff size);
+    void install_program();
+    
+    // Current frame's range as [range_start_, code_limit_); code_limit_ is
+    // dropped to 0 once a transfer lands below the start.
+    // sync_current_frame recomputes these and unchecked_ on a frame change.
+    size_t range_start_;
+    size_t code_limit_;
+    void sync_current_frame();
+    void transfer_to(size_t target) {
+        program_counter_ = target;
+        if (target < range_start_) code_limit_ = 0;
+    }
+    bool ensure_resident(uint32_t entry);
+    
+    // Stack verification. A unit is verified when it becomes resident
+    // (Program::make_resident), against the effects the image claims for
+    // its callees; a frame runs
+    // unchecked (unchecked_ mirrors the current frame) when its unit is
+    // verified and the stack covers the unit's lowest point. A call from an
+    // unchecked frame into anything else, and any recovery, drops every
+    // frame back to checked dispatch.
+    bool unchecked_;
+    bool enter_verified(const ProgramUnit* unit);
+    void drop_to_checked();
+    
     // Frame stack
     std::vector<std::shared_ptr<Frame>> frame_stack_;
     std::shared_ptr<Frame> current_frame_;
     uint64_t next_frame_id_;
+    
+    // Calls: each unit runs in its own frame; names come from the image. A
+    // tail call hands the callee the caller's frame instead, so it returns
+    // straight to the caller's caller and recursion runs in constant space.
+    static const size_t kMaxCallDepth = 10000;
+    bool call_unit(uint32_t entry, bool tail = false);
+    void return_from_frame();
+    
+    // A call that missed the memo table is recorded when the frame made
+    // for it returns; a call into a unit that did not verify pure drops
+    // every pending record, since its callers' results are then suspect
+    struct PendingMemo {
+        size_t frame_depth;
+        uint32_t entry;
+        std::vector<Value> args;
+        size_t result_count;
+    };
+    MemoTable memo_;
+    std::vector<PendingMemo> memo_pending_;
+    bool memo_call(uint32_t entry, const ProgramUnit& unit);
+    void record_memo();
+    
+    // A SUPERLATIVE call's cost, the instructions run until the frame made
+    // for it returns, is recorded for the resolver's ranking then
+    struct PendingCost {
+        size_t frame_depth;
+        uint32_t superlative;
+        uint32_t candidate;
+        uint64_t start;
+    };
+    std::vector<PendingCost> cost_pending_;
+    bool call_superlative(uint32_t site, uint32_t superlative, bool checked);
+    
+    // Franchise delegation
+    std::shared_ptr<FranchiseWorkers> workers_;
+    bool can_delegate(uint32_t entry) const;
+    bool delegate_call(uint32_t entry);
  
     // State checkpointing
     std::vector<std::vector<uint8_t>> checkpoint_stack_;
     
     // Execution engine
+    static const size_t kMaxPushes = 2;   // Most one instruction pushes (SLOT_LOAD2)
     bool execute_instruction(uint8_t opcode);
-    bool execute_heip_opcode(HEIPOpcode opcode);
+    template <bool kChecked> bool execute_heip_opcode(HEIPOpcode opcode);
+    bool execute_vector_opcode(HEIPOpcode opcode);
     
-    // Stack and memory
-    std::vector<uint32_t> stack_;
+    // Stack and memory. Memory grows as it is stored to, up to kMemoryBytes.
+    static const size_t kMemoryBytes = 1024 * 1024;
+    OperandStack stack_;
     std::vector<uint8_t> memory_;
     
-    // Self-healing
+    // push_value/pop_value move 32-bit cells (int or, tagged, a reference);
+    // pop_value reads doubles through Value::to_u32. pop_cell/push_cell
+    // move whole Values through container cells: ints, strings and
+    // references fit a cell, doubles go in a BOX object.
+    void push(Value value) { stack_.push(value); }
+    Value pop() { return stack_.pop(); }
+    void push_value(uint32_t value, uint8_t tag = kTagValue);
+    uint32_t pop_value();
+    bool pop_cell(uint32_t& cell, uint8_t& tag);
+    bool reach_slot(uint32_t slot);
+    void push_cell(uint32_t cell, uint8_t tag);
+    bool pop_ref(HeapRef& ref);
+    bool read_operand(uint32_t& operand);
+    
+    // A compact form's operand is its one byte; immediates sign-extend
+    bool read_operand(uint32_t& operand, bool compact) {
+        if (!compact) return read_operand(operand);
+        if (program_counter_ >= code_size_) return false;
+        operand = code_[program_counter_++];
+        return true;
+    }
+    bool read_immediate(uint32_t& operand, bool compact) {
+        if (!compact) return read_operand(operand);
+        if (program_counter_ >= code_size_) return false;
+        operand = static_cast<uint32_t>(static_cast<int8_t>(code_[program_counter_++]));
+        return true;
+    }
+    
+    // Managed heap for Bubble/Chain/Case containers
+    GCHeap heap_;
+    PersistentChain chains_;
+    const SimdKernels* simd_;
+    
+    // Overlay/franchise symbol table with per-site inline caches
+    SymbolResolver resolver_;
+    bool pop_numeric(HeapRef& ref);
+    void visit_roots(const GCHeap::RootVisitor& visit);
+    
+    // Self-healing; last_fault_pc_ stops a fault that survives a
+    // checkpoint restore from being retried forever
     bool self_healing_enabled_;
+    size_t last_fault_pc_;
     std::vector<std::string> error_log_;
+    
+    // Heal points of inlined protocol bodies (INLINE_ENTER/INLINE_EXIT). A
+    // fault inside one retries the body with the operand stack cut back to
+    // its entry depth, instead of taking a full frame checkpoint per call.
+    struct InlineMark {
+        size_t restart_pc;
+        size_t stack_depth;
+        size_t frame_depth;
+    };
+    std::vector<InlineMark> inline_marks_;
+    
+    // HELP Snapshot stop; snapshot_pc_ is where a resumed run continues
+    bool snapshot_stop_;
+    bool snapshot_reached_;
+    size_t snapshot_pc_;
     bool handle_execution_error(const std::string& error);
     
-    // Performance tracking
+    // Profile counters; site_at_pc_ maps a code offset to its site or -1
+    struct SiteCounter {
+        ImageSite site;
+        uint64_t taken;         // Branch taken, or inline site entered
+        uint64_t not_taken;
+    };
+    bool profiling_;
+    std::vector<SiteCounter> site_counters_;
+    std::vector<int32_t> site_at_pc_;
+    std::unordered_map<uint32_t, uint64_t> unit_calls_;   // Entry -> calls
+    std::vector<uint64_t> opcode_pairs_;                  // first << 8 | second
+    uint32_t last_opcode_;                                // > 0xFF before the first
+    void index_profile_sites();
+    void profile_instruction(size_t pc, uint8_t opcode);
+    void profile_branch(size_t pc, bool taken);
+    
+    // Performance tracking; end_time_ is set when execute() returns
     uint64_t instruction_count_;
     std::chrono::high_resolution_clock::time_point start_time_;
     std::chrono::high_resolution_clock::time_point end_time_;
     float uptime_percentage_;
+    int dispatch();
+    
+    // metrics_ is local_metrics_ or the exported segment's block;
+    // retired_instructions_ keeps the instruction counter monotonic across
+    // reset(). The dispatch loop publishes on a mask of instruction_count_,
+    // so the hot path gains one test and no atomic read-modify-write.
+    static const uint64_t kPublishInterval = 1u << 16;
+    RuntimeMetrics local_metrics_;
+    std::unique_ptr<MetricsSegment> metrics_segment_;
+    RuntimeMetrics* metrics_;
+    uint64_t retired_instructions_;
+    void publish_metrics();
     
   // Forensic ledger
     void log_execution_event(const std::string& event);
@@ -0,0 +1,455 @@
+#include "franchise_workers.h"
+#include "frame_runtime.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace heip {
+
+namespace {
+
+#ifndef _WIN32
+
+// Message::status
+const int32_t kCallDone = 0;
+const int32_t kCallFaulted = 1;
+const int32_t kCallTooManyResults = 2;
+const int32_t kCallReferenceResult = 3;
+
+const char* describe_status(int32_t status) {
+    switch (status) {
+        case kCallFaulted: return "unit faulted in its worker";
+        case kCallTooManyResults: return "too many results for a message";
+        case kCallReferenceResult: return "heap reference in the results";
+        default: return "unknown worker status";
+    }
+}
+
+// A write to a worker that died must fail, not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;   // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+const size_t kHeaderBytes = offsetof(FranchiseWorkers::Message, values);
+
+bool write_all(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = send(fd, bytes, size, kSendFlags);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+// With a shared slot the message is already in place; the socket call on
+// each side orders it against the other process's accesses
+bool transmit(int fd, const FranchiseWorkers::Message& message, bool shared) {
+    if (shared) {
+        char bell = 1;
+        return write_all(fd, &bell, 1);
+    }
+    return write_all(fd, &message, kHeaderBytes + message.count * sizeof(uint64_t));
+}
+
+bool receive(int fd, FranchiseWorkers::Message& message, bool shared) {
+    if (shared) {
+        char bell;
+        return read_all(fd, &bell, 1);
+    }
+    return read_all(fd, &message, kHeaderBytes) &&
+           message.count <= FranchiseWorkers::kMaxValues &&
+           read_all(fd, message.values, message.count * sizeof(uint64_t));
+}
+
+// Spawn replies carry the worker's socket as SCM_RIGHTS ancillary data
+bool send_with_fd(int socket, int32_t reply, int fd) {
+    iovec iov{&reply, sizeof reply};
+    msghdr msg;
+    std::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    union {
+        cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    } control;
+    if (fd >= 0) {
+        std::memset(&control, 0, sizeof control);
+        msg.msg_control = control.bytes;
+        msg.msg_controllen = sizeof control.bytes;
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof fd);
+    }
+    ssize_t sent;
+    while ((sent = sendmsg(socket, &msg, kSendFlags)) < 0 && errno == EINTR) {}
+    return sent == static_cast<ssize_t>(sizeof reply);
+}
+
+bool receive_with_fd(int socket, int32_t& reply, int& fd) {
+    iovec iov{&reply, sizeof reply};
+    msghdr msg;
+    std::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    union {
+        cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    } control;
+    msg.msg_control = control.bytes;
+    msg.msg_controllen = sizeof control.bytes;
+    ssize_t received;
+    while ((received = recvmsg(socket, &msg, 0)) < 0 && errno == EINTR) {}
+    fd = -1;
+    cmsghdr* cmsg = received > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        std::memcpy(&fd, CMSG_DATA(cmsg), sizeof fd);
+    }
+    if (received == static_cast<ssize_t>(sizeof reply)) return true;
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    return false;
+}
+
+// A worker's whole life: one runtime over the inherited Program, a fresh
+// run per call, until the caller's end of the socket closes
+[[noreturn]] void run_worker(const std::shared_ptr<const Program>& program, int fd,
+                             FranchiseWorkers::Message* shared) {
+    FrameRuntime runtime;
+    runtime.load_program(program);
+    FranchiseWorkers::Message local;
+    FranchiseWorkers::Message& message = shared ? *shared : local;
+    std::vector<Value> args;
+    std::vector<Value> results;
+
+    while (receive(fd, message, shared != nullptr)) {
+        args.clear();
+        for (uint32_t i = 0; i < message.count; i++) {
+            args.push_back(Value::from_bits(message.values[i]));
+        }
+        int32_t status = runtime.run_unit(message.entry, args.data(), args.size(), results) == 0 ?
+                         kCallDone : kCallFaulted;
+        if (status == kCallDone && results.size() > FranchiseWorkers::kMaxValues) {
+            status = kCallTooManyResults;
+        }
+        if (status == kCallDone &&
+            std::any_of(results.begin(), results.end(), [](Value v) { return v.is_ref(); })) {
+            status = kCallReferenceResult;
+        }
+
+        message.status = status;
+        message.count = status == kCallDone ? static_cast<uint32_t>(results.size()) : 0;
+        for (uint32_t i = 0; i < message.count; i++) message.values[i] = results[i].bits();
+        if (!transmit(fd, message, shared != nullptr)) break;
+    }
+    _exit(0);
+}
+
+#endif
+
+} // namespace
+
+FranchiseWorkers::FranchiseWorkers(std::shared_ptr<const Program> program, size_t count)
+    : program_(std::move(program))
+    , delegated_(program_->code.size(), false)
+    , delegated_units_(0)
+    , workers_(count, Worker{-1, false})
+    , supervisor_pid_(-1)
+    , control_fd_(-1)
+    , slots_(nullptr)
+    , shared_(false)
+    , calls_(0)
+    , crashes_(0) {
+#ifndef _WIN32
+    void* mapping = mmap(nullptr, count * sizeof(Message), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED) {
+        slots_ = static_cast<Message*>(mapping);
+        shared_ = true;
+        return;
+    }
+#endif
+    local_slots_.resize(count);
+    slots_ = local_slots_.data();
+}
+
+FranchiseWorkers::~FranchiseWorkers() {
+    for (auto& worker : workers_) reap(worker);
+#ifndef _WIN32
+    // The supervisor waits for its workers to see their sockets close
+    if (control_fd_ >= 0) ::close(control_fd_);
+    if (supervisor_pid_ > 0) {
+        while (waitpid(supervisor_pid_, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+    if (shared_) munmap(slots_, workers_.size() * sizeof(Message));
+#endif
+}
+
+std::shared_ptr<FranchiseWorkers> FranchiseWorkers::start(std::shared_ptr<const Program> program,
+                                                          const std::vector<std::string>& franchises,
+                                                          size_t count, std::string& error) {
+#ifdef _WIN32
+    (void)program;
+    (void)franchises;
+    (void)count;
+    error = "Franchise workers need fork(), which Windows does not have";
+    return nullptr;
+#else
+    // Workers start from the caller's copy, so nothing may be left to load
+    if (!program || !program->complete()) {
+        error = "Franchise workers need a fully loaded image";
+        return nullptr;
+    }
+    std::shared_ptr<FranchiseWorkers> pool(
+        new FranchiseWorkers(program, std::max<size_t>(count, 1)));
+
+    for (const auto& unit : program->units) {
+        auto name = program->unit_names.find(unit.offset);
+        if (name == program->unit_names.end()) continue;
+        bool member = std::any_of(franchises.begin(), franchises.end(),
+                                  [&name](const std::string& franchise) {
+                                      return name->second.compare(0, franchise.size() + 1,
+                                                                  franchise + ".") == 0;
+                                  });
+
+        // Arguments are what the unit pops below its entry depth
+        size_t arg_count = static_cast<size_t>(-unit.stack.lowest);
+        size_t result_count = static_cast<size_t>(unit.stack.net - unit.stack.lowest);
+        if (!member || !unit.stack_verified || arg_count > kMaxValues ||
+            result_count > kMaxValues) {
+            continue;
+        }
+        pool->delegated_[unit.offset] = true;
+        pool->delegated_units_++;
+    }
+    if (pool->delegated_units_ == 0) {
+        error = "No delegable units in the named franchises";
+        return nullptr;
+    }
+
+    if (!pool->start_supervisor(error)) return nullptr;
+    for (size_t i = 0; i < pool->workers_.size(); i++) {
+        if (!pool->spawn(i, error)) return nullptr;
+    }
+    return pool;
+#endif
+}
+
+bool FranchiseWorkers::start_supervisor(std::string& error) {
+#ifdef _WIN32
+    error = "Franchise workers need fork(), which Windows does not have";
+    return false;
+#else
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        error = "Could not create the supervisor socket";
+        return false;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+    setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+#endif
+
+    // Buffered output would otherwise be written by both processes
+    std::cout.flush();
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        error = "Could not fork the worker supervisor";
+        return false;
+    }
+    if (pid == 0) {
+        ::close(fds[0]);
+        supervise(fds[1]);
+    }
+
+    ::close(fds[1]);
+    supervisor_pid_ = pid;
+    control_fd_ = fds[0];
+    return true;
+#endif
+}
+
+void FranchiseWorkers::supervise(int control) {
+#ifndef _WIN32
+    // Faults come back as call errors, so workers keep the host's output
+    // clean; they inherit this from the supervisor
+    int null = ::open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        ::close(null);
+    }
+
+    // One request per spawn: the worker's index in, its socket out
+    uint32_t index;
+    while (read_all(control, &index, sizeof index)) {
+        while (waitpid(-1, nullptr, WNOHANG) > 0) {}   // Crashed workers
+
+        int fds[2];
+        if (index >= workers_.size() || socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            if (!send_with_fd(control, -1, -1)) break;
+            continue;
+        }
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+        setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+#endif
+        pid_t pid = fork();
+        if (pid == 0) {
+            // The supervisor holds no other worker's socket, so closing
+            // these two leaves the worker only its own
+            ::close(control);
+            ::close(fds[0]);
+            run_worker(program_, fds[1], shared_ ? &slots_[index] : nullptr);
+        }
+        ::close(fds[1]);
+        bool sent = send_with_fd(control, pid < 0 ? -1 : 0, pid < 0 ? -1 : fds[0]);
+        ::close(fds[0]);
+        if (!sent) break;
+    }
+
+    // The pool is gone; its workers exit as their sockets close
+    ::close(control);
+    while (wait(nullptr) > 0 || errno == EINTR) {}
+    _exit(0);
+#else
+    (void)control;
+    std::abort();
+#endif
+}
+
+bool FranchiseWorkers::spawn(size_t index, std::string& error) {
+#ifdef _WIN32
+    (void)index;
+    error = "Franchise workers need fork(), which Windows does not have";
+    return false;
+#else
+    // Forked by the supervisor rather than here: the caller may be any of
+    // the host's threads, and a child of a multithreaded process can
+    // deadlock on a lock another thread held at the fork
+    uint32_t request = static_cast<uint32_t>(index);
+    int32_t reply;
+    int fd;
+    if (!write_all(control_fd_, &request, sizeof request) ||
+        !receive_with_fd(control_fd_, reply, fd)) {
+        error = "Worker supervisor is gone";
+        return false;
+    }
+    if (reply != 0 || fd < 0) {
+        if (fd >= 0) ::close(fd);
+        error = "Could not fork a worker";
+        return false;
+    }
+    workers_[index].fd = fd;
+    return true;
+#endif
+}
+
+void FranchiseWorkers::reap(Worker& worker) {
+#ifndef _WIN32
+    // An idle worker exits when its socket closes; a crashed one is gone.
+    // Either way the supervisor collects its exit status.
+    if (worker.fd >= 0) ::close(worker.fd);
+#endif
+    worker.fd = -1;
+}
+
+bool FranchiseWorkers::call(uint32_t entry, const Value* args, size_t arg_count,
+                            std::vector<Value>& results, std::string& error) {
+#ifdef _WIN32
+    (void)entry;
+    (void)args;
+    (void)arg_count;
+    (void)results;
+    error = "Franchise workers need fork(), which Windows does not have";
+    return false;
+#else
+    if (!delegates(entry) || arg_count > kMaxValues) {
+        error = "Unit is not delegated";
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto idle = std::find_if(workers_.begin(), workers_.end(),
+                             [](const Worker& w) { return !w.busy; });
+    while (idle == workers_.end()) {
+        idle_.wait(lock);
+        idle = std::find_if(workers_.begin(), workers_.end(),
+                            [](const Worker& w) { return !w.busy; });
+    }
+    size_t index = static_cast<size_t>(idle - workers_.begin());
+    Worker& worker = *idle;
+
+    // A worker that could not be replaced earlier gets another try
+    if (worker.fd < 0 && !spawn(index, error)) return false;
+    worker.busy = true;
+    lock.unlock();
+
+    Message& message = slots_[index];
+    message.entry = entry;
+    message.count = static_cast<uint32_t>(arg_count);
+    message.status = kCallDone;
+    for (size_t i = 0; i < arg_count; i++) message.values[i] = args[i].bits();
+    bool answered = transmit(worker.fd, message, shared_) && receive(worker.fd, message, shared_);
+    calls_.fetch_add(1, std::memory_order_relaxed);
+
+    bool done = answered && message.status == kCallDone;
+    if (done) {
+        results.clear();
+        for (uint32_t i = 0; i < message.count; i++) {
+            results.push_back(Value::from_bits(message.values[i]));
+        }
+    } else {
+        error = answered ? describe_status(message.status) : "worker exited during the call";
+    }
+
+    lock.lock();
+    if (!answered) {
+        crashes_.fetch_add(1, std::memory_order_relaxed);
+        reap(worker);
+        std::string spawn_error;
+        spawn(index, spawn_error);
+    }
+    worker.busy = false;
+    lock.unlock();
+    idle_.notify_one();
+    return done;
+#endif
+}
+
+} // namespace heip
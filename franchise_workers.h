@@ -0,0 +1,94 @@
+#pragma once
+#include "program.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace heip {
+
+// Franchise delegation: calls into chosen franchises run in forked worker
+// processes over the same Program, so a franchise that crashes takes down
+// only its worker. Workers are forked by a supervisor process that start()
+// forks while the host is still single-threaded, so a replacement never
+// inherits another thread's locks. Each worker has a message slot in
+// memory mapped shared before the fork: the caller pops arguments straight into it and the
+// worker pushes them from there, and results come back the same way, so
+// the socket between them only rings a doorbell. Where the shared mapping
+// cannot be made, the whole message travels over the socket instead.
+//
+// A delegated unit runs in a fresh runtime (its own memory and heap), so
+// only its stack arguments and results cross; heap references cannot. One
+// pool serves any number of runtimes and threads over its Program, one
+// call per worker at a time. POSIX only: start() fails on Windows.
+class FranchiseWorkers {
+public:
+    static const size_t kMaxValues = 32;   // Arguments or results of one call
+
+    // Forks the supervisor and `count` workers over a fully loaded program
+    // and delegates the units named "<franchise>." for each franchise
+    // (nested ones too) whose verified stack effect fits a message. Start
+    // it before the host creates threads: the supervisor is forked, not
+    // exec'd. Workers print nothing; faults come back as call errors.
+    static std::shared_ptr<FranchiseWorkers> start(std::shared_ptr<const Program> program,
+                                                   const std::vector<std::string>& franchises,
+                                                   size_t count, std::string& error);
+    ~FranchiseWorkers();
+    FranchiseWorkers(const FranchiseWorkers&) = delete;
+    FranchiseWorkers& operator=(const FranchiseWorkers&) = delete;
+
+    bool delegates(uint32_t entry) const {
+        return entry < delegated_.size() && delegated_[entry];
+    }
+
+    // Runs a delegated unit in an idle worker. False when the unit faulted
+    // or the worker died (it is replaced), with the reason in `error`.
+    bool call(uint32_t entry, const Value* args, size_t arg_count,
+              std::vector<Value>& results, std::string& error);
+
+    const Program& program() const { return *program_; }
+    size_t size() const { return workers_.size(); }
+    size_t delegated_units() const { return delegated_units_; }
+    bool shared_memory() const { return shared_; }
+    uint64_t calls() const { return calls_.load(std::memory_order_relaxed); }
+    uint64_t crashes() const { return crashes_.load(std::memory_order_relaxed); }
+
+    // One call's arguments on the way in, its results on the way out
+    struct Message {
+        uint32_t entry;
+        uint32_t count;              // Values in use
+        int32_t status;              // Reply: 0, or why the call failed
+        uint32_t reserved;
+        uint64_t values[kMaxValues];
+    };
+
+private:
+    struct Worker {
+        int fd;                      // Caller's end of the socket pair
+        bool busy;
+    };
+
+    FranchiseWorkers(std::shared_ptr<const Program> program, size_t count);
+    bool start_supervisor(std::string& error);
+    [[noreturn]] void supervise(int control);
+    bool spawn(size_t index, std::string& error);
+    void reap(Worker& worker);
+
+    std::shared_ptr<const Program> program_;
+    std::vector<bool> delegated_;    // By code offset
+    size_t delegated_units_;
+    std::vector<Worker> workers_;
+    int supervisor_pid_;             // Parent of every worker; reaps them
+    int control_fd_;                 // Spawn requests to the supervisor
+    Message* slots_;                 // One per worker
+    bool shared_;                    // slots_ is the shared mapping, else local_slots_
+    std::vector<Message> local_slots_;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::atomic<uint64_t> calls_;
+    std::atomic<uint64_t> crashes_;
+};
+
+} // namespace heip
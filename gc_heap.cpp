@@ -0,0 +1,536 @@
+#include "gc_heap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace heip {
+
+GCHeap::GCHeap(size_t nursery_bytes)
+    : nursery_(std::max<size_t>(nursery_bytes / sizeof(uint32_t), 1024))
+    , nursery_top_(1)
+    , old_(nursery_.size())
+    , old_top_(1)
+    , initial_major_threshold_(static_cast<uint32_t>(nursery_.size() * 4))
+    , major_threshold_(initial_major_threshold_)
+    , collection_requested_(false)
+    , stats_() {
+    // Offset 0 of each space is reserved so that 0 stays the null reference
+}
+
+uint32_t* GCHeap::header(HeapRef ref) {
+    return (ref & kOldGenBit) ? &old_[ref & ~kOldGenBit] : &nursery_[ref];
+}
+
+const uint32_t* GCHeap::header(HeapRef ref) const {
+    return (ref & kOldGenBit) ? &old_[ref & ~kOldGenBit] : &nursery_[ref];
+}
+
+uint8_t* GCHeap::tags(HeapRef ref) {
+    uint32_t* h = header(ref);
+    return reinterpret_cast<uint8_t*>(h + kHeaderWords + h[kWordCapacity]);
+}
+
+const uint8_t* GCHeap::tags(HeapRef ref) const {
+    const uint32_t* h = header(ref);
+    return reinterpret_cast<const uint8_t*>(h + kHeaderWords + h[kWordCapacity]);
+}
+
+HeapRef GCHeap::allocate(ObjectKind kind, uint32_t capacity) {
+    if (capacity > kMaxCapacity) return kNullRef;
+    uint32_t words = static_cast<uint32_t>(object_words(capacity));
+
+    if (nursery_top_ + words > nursery_.size()) {
+        // Nursery exhausted - allocate in the old generation and collect
+        // at the next safepoint
+        collection_requested_ = true;
+        return allocate_old(kind, capacity);
+    }
+
+    HeapRef ref = nursery_top_;
+    nursery_top_ += words;
+    stats_.bytes_allocated += words * sizeof(uint32_t);
+
+    uint32_t* h = &nursery_[ref];
+    std::fill(h, h + words, 0u);
+    h[kWordHeader] = static_cast<uint32_t>(kind);
+    h[kWordCapacity] = capacity;
+    h[kWordCount] = (kind == ObjectKind::BUBBLE) ? 0 : capacity;
+    return ref;
+}
+
+HeapRef GCHeap::allocate_old(ObjectKind kind, uint32_t capacity) {
+    if (capacity > kMaxCapacity) return kNullRef;
+    // Old offsets must stay below the generation bit
+    uint32_t words = static_cast<uint32_t>(object_words(capacity));
+    if (words >= kOldGenBit - old_top_) return kNullRef;
+    stats_.bytes_allocated += words * sizeof(uint32_t);
+    if (old_top_ + words > old_.size()) {
+        old_.resize(std::max<size_t>(old_.size() * 2, old_top_ + words));
+    }
+
+    uint32_t offset = old_top_;
+    old_top_ += words;
+    if (old_top_ > major_threshold_) {
+        collection_requested_ = true;
+    }
+
+    uint32_t* h = &old_[offset];
+    std::fill(h, h + words, 0u);
+    h[kWordHeader] = static_cast<uint32_t>(kind);
+    h[kWordCapacity] = capacity;
+    h[kWordCount] = (kind == ObjectKind::BUBBLE) ? 0 : capacity;
+    return offset | kOldGenBit;
+}
+
+HeapRef GCHeap::allocate_bubble(uint32_t capacity) {
+    // The storage array is allocated first; allocation never collects,
+    // so it cannot move before the bubble points at it
+    HeapRef storage = allocate(ObjectKind::ARRAY, std::max<uint32_t>(capacity, 4));
+    if (storage == kNullRef) return kNullRef;
+    set_count(storage, 0);
+    HeapRef bubble = allocate(ObjectKind::BUBBLE, 1);
+    if (bubble == kNullRef) return kNullRef;
+    set_cell(bubble, 0, storage, kTagRef);
+    return bubble;
+}
+
+bool GCHeap::is_valid(HeapRef ref) const {
+    if (ref == kNullRef) return false;
+    if (ref & kOldGenBit) return (ref & ~kOldGenBit) < old_top_;
+    return ref < nursery_top_;
+}
+
+ObjectKind GCHeap::kind(HeapRef ref) const {
+    return static_cast<ObjectKind>(header(ref)[kWordHeader] & kKindMask);
+}
+
+uint32_t GCHeap::capacity(HeapRef ref) const {
+    return header(ref)[kWordCapacity];
+}
+
+uint32_t GCHeap::count(HeapRef ref) const {
+    return header(ref)[kWordCount];
+}
+
+void GCHeap::set_count(HeapRef ref, uint32_t count) {
+    header(ref)[kWordCount] = count;
+}
+
+uint32_t GCHeap::get_cell(HeapRef ref, uint32_t index) const {
+    return header(ref)[kHeaderWords + index];
+}
+
+uint8_t GCHeap::get_tag(HeapRef ref, uint32_t index) const {
+    return tags(ref)[index];
+}
+
+void GCHeap::set_cell(HeapRef ref, uint32_t index, uint32_t value, uint8_t tag) {
+    uint32_t* h = header(ref);
+    h[kHeaderWords + index] = value;
+    tags(ref)[index] = tag;
+
+    // Strings set the flag too so vector kernels see only plain numbers
+    if (tag != kTagValue) h[kWordHeader] |= kFlagHasRefs;
+    if (tag == kTagRef) {
+
+        // Write barrier: remember old objects that point into the nursery
+        if (!is_young(ref) && is_young(value) && !(h[kWordHeader] & kFlagRemembered)) {
+            h[kWordHeader] |= kFlagRemembered;
+            remembered_set_.push_back(ref);
+        }
+    }
+}
+
+HeapRef GCHeap::storage_of(HeapRef ref) const {
+    return kind(ref) == ObjectKind::BUBBLE ? get_cell(ref, 0) : ref;
+}
+
+uint32_t GCHeap::length(HeapRef ref) const {
+    return count(storage_of(ref));
+}
+
+uint32_t GCHeap::element(HeapRef ref, uint32_t index) const {
+    return get_cell(storage_of(ref), index);
+}
+
+uint8_t GCHeap::element_tag(HeapRef ref, uint32_t index) const {
+    return get_tag(storage_of(ref), index);
+}
+
+void GCHeap::set_element(HeapRef ref, uint32_t index, uint32_t value, uint8_t tag) {
+    set_cell(storage_of(ref), index, value, tag);
+}
+
+void GCHeap::set_length(HeapRef ref, uint32_t length) {
+    set_count(storage_of(ref), length);
+}
+
+bool GCHeap::bubble_push(HeapRef bubble, uint32_t value, uint8_t tag) {
+    HeapRef storage = storage_of(bubble);
+    uint32_t n = count(storage);
+
+    if (n == capacity(storage)) {
+        // Grow the backing store; the bubble keeps its identity
+        if (n >= kMaxCapacity) return false;
+        HeapRef grown = allocate(ObjectKind::ARRAY, n < 2 ? 4 :
+                                 n < kMaxCapacity / 2 ? n * 2 : kMaxCapacity);
+        if (grown == kNullRef) return false;
+        for (uint32_t i = 0; i < n; i++) {
+            set_cell(grown, i, get_cell(storage, i), get_tag(storage, i));
+        }
+        set_cell(bubble, 0, grown, kTagRef);
+        storage = grown;
+    }
+
+    set_cell(storage, n, value, tag);
+    set_count(storage, n + 1);
+    return true;
+}
+
+uint32_t* GCHeap::element_cells(HeapRef ref) {
+    return header(storage_of(ref)) + kHeaderWords;
+}
+
+bool GCHeap::has_refs(HeapRef ref) const {
+    return (header(storage_of(ref))[kWordHeader] & kFlagHasRefs) != 0;
+}
+
+void GCHeap::scan_object(HeapRef ref, const RootVisitor& visitor) {
+    uint32_t* h = header(ref);
+    if (!(h[kWordHeader] & kFlagHasRefs)) return;
+
+    uint32_t cap = h[kWordCapacity];
+    const uint8_t* t = tags(ref);
+    for (uint32_t i = 0; i < cap; i++) {
+        if (t[i] == kTagRef) {
+            HeapRef field = h[kHeaderWords + i];
+            visitor(field);
+            // The visitor never reallocates a space, so h stays valid
+            h[kHeaderWords + i] = field;
+        }
+    }
+}
+
+HeapRef GCHeap::evacuate(HeapRef ref) {
+    uint32_t* h = &nursery_[ref];
+    if (h[kWordHeader] & kFlagForwarded) {
+        return h[kWordForward];
+    }
+
+    uint32_t words = object_words(h[kWordCapacity]);
+    uint32_t dst = old_top_;
+    old_top_ += words;
+
+    std::copy(h, h + words, &old_[dst]);
+    old_[dst + kWordHeader] &= ~(kFlagMarked | kFlagRemembered);
+
+    h[kWordHeader] |= kFlagForwarded;
+    h[kWordForward] = dst | kOldGenBit;
+    return dst | kOldGenBit;
+}
+
+void GCHeap::minor_phase() {
+    // Worst case every nursery object survives; size the old space up
+    // front so evacuation never reallocates mid-scan
+    if (old_top_ + nursery_top_ > old_.size()) {
+        old_.resize(std::max<size_t>(old_.size() * 2, old_top_ + nursery_top_));
+    }
+
+    uint32_t scan = old_top_;
+    uint32_t promoted_from = old_top_;
+
+    RootVisitor evacuate_young = [this](HeapRef& ref) {
+        if (is_young(ref)) ref = evacuate(ref);
+    };
+
+    if (enumerate_roots_) enumerate_roots_(evacuate_young);
+
+    for (HeapRef obj : remembered_set_) {
+        header(obj)[kWordHeader] &= ~kFlagRemembered;
+        scan_object(obj, evacuate_young);
+    }
+    remembered_set_.clear();
+
+    // Cheney scan over the freshly promoted objects
+    while (scan < old_top_) {
+        HeapRef obj = scan | kOldGenBit;
+        scan_object(obj, evacuate_young);
+        scan += object_words(old_[scan + kWordCapacity]);
+    }
+
+    uint64_t promoted = static_cast<uint64_t>(old_top_ - promoted_from) * sizeof(uint32_t);
+    uint64_t used = static_cast<uint64_t>(nursery_top_ - 1) * sizeof(uint32_t);
+    stats_.bytes_promoted += promoted;
+    stats_.bytes_reclaimed += used > promoted ? used - promoted : 0;
+    stats_.minor_collections++;
+
+    nursery_top_ = 1;
+}
+
+void GCHeap::major_phase() {
+    // Mark
+    std::vector<HeapRef> worklist;
+    RootVisitor mark = [this, &worklist](HeapRef& ref) {
+        if (ref == kNullRef) return;
+        uint32_t* h = header(ref);
+        if (!(h[kWordHeader] & kFlagMarked)) {
+            h[kWordHeader] |= kFlagMarked;
+            worklist.push_back(ref);
+        }
+    };
+
+    if (enumerate_roots_) enumerate_roots_(mark);
+    while (!worklist.empty()) {
+        HeapRef obj = worklist.back();
+        worklist.pop_back();
+        scan_object(obj, mark);
+    }
+
+    // Compute forwarding addresses (sliding, address-ordered)
+    uint32_t dst = 1;
+    for (uint32_t scan = 1; scan < old_top_; scan += object_words(old_[scan + kWordCapacity])) {
+        uint32_t* h = &old_[scan];
+        if (h[kWordHeader] & kFlagMarked) {
+            h[kWordForward] = dst | kOldGenBit;
+            dst += object_words(h[kWordCapacity]);
+        }
+    }
+
+    // Update references
+    RootVisitor update = [this](HeapRef& ref) {
+        if (ref != kNullRef) ref = old_[(ref & ~kOldGenBit) + kWordForward];
+    };
+
+    if (enumerate_roots_) enumerate_roots_(update);
+    for (uint32_t scan = 1; scan < old_top_; scan += object_words(old_[scan + kWordCapacity])) {
+        if (old_[scan + kWordHeader] & kFlagMarked) {
+            scan_object(scan | kOldGenBit, update);
+        }
+    }
+
+    // Slide live objects down
+    uint32_t scan = 1;
+    while (scan < old_top_) {
+        uint32_t* h = &old_[scan];
+        uint32_t words = object_words(h[kWordCapacity]);
+        if (h[kWordHeader] & kFlagMarked) {
+            uint32_t target = h[kWordForward] & ~kOldGenBit;
+            h[kWordHeader] &= ~(kFlagMarked | kFlagRemembered);
+            if (target != scan) {
+                std::memmove(&old_[target], h, words * sizeof(uint32_t));
+            }
+        }
+        scan += words;
+    }
+
+    stats_.bytes_reclaimed += static_cast<uint64_t>(old_top_ - dst) * sizeof(uint32_t);
+    stats_.old_live_bytes = static_cast<uint64_t>(dst) * sizeof(uint32_t);
+    stats_.major_collections++;
+
+    old_top_ = dst;
+    major_threshold_ = std::max(initial_major_threshold_, old_top_ * 2);
+}
+
+void GCHeap::collect_minor() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    minor_phase();
+    if (old_top_ > major_threshold_) {
+        major_phase();
+    }
+    collection_requested_ = false;
+
+    record_pause(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count());
+}
+
+void GCHeap::collect_major() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Empty the nursery first so every live object is in the old space
+    minor_phase();
+    major_phase();
+    collection_requested_ = false;
+
+    record_pause(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count());
+}
+
+void GCHeap::save_words(std::vector<uint32_t>& out) const {
+    const uint64_t counters[] = {
+        stats_.minor_collections, stats_.major_collections, stats_.total_pause_us,
+        stats_.max_pause_us, stats_.bytes_allocated, stats_.bytes_promoted,
+        stats_.bytes_reclaimed, stats_.old_live_bytes
+    };
+
+    out.push_back(nursery_top_);
+    out.push_back(old_top_);
+    out.push_back(major_threshold_);
+    out.push_back(collection_requested_ ? 1 : 0);
+    for (uint64_t counter : counters) {
+        out.push_back(static_cast<uint32_t>(counter >> 32));
+        out.push_back(static_cast<uint32_t>(counter));
+    }
+    out.push_back(static_cast<uint32_t>(remembered_set_.size()));
+    out.insert(out.end(), remembered_set_.begin(), remembered_set_.end());
+    out.insert(out.end(), nursery_.begin(), nursery_.begin() + nursery_top_);
+    out.insert(out.end(), old_.begin(), old_.begin() + old_top_);
+}
+
+void GCHeap::reset() {
+    nursery_top_ = 1;
+    old_top_ = 1;
+    major_threshold_ = initial_major_threshold_;
+    collection_requested_ = false;
+    remembered_set_.clear();
+    stats_ = GCStats();
+}
+
+bool GCHeap::load_words(const std::vector<uint32_t>& in, const ObjectCheck& check) {
+    const size_t kFixedWords = 4 + 16 + 1;
+    if (in.size() < kFixedWords) return false;
+
+    uint32_t nursery_top = in[0];
+    uint32_t old_top = in[1];
+    size_t remembered = in[20];
+    if (nursery_top == 0 || old_top == 0 || nursery_top > nursery_.size() || old_top >= kOldGenBit ||
+        in.size() != kFixedWords + remembered + nursery_top + old_top) {
+        return false;
+    }
+
+    uint64_t counters[8];
+    for (size_t i = 0; i < 8; i++) {
+        counters[i] = (static_cast<uint64_t>(in[4 + i * 2]) << 32) | in[5 + i * 2];
+    }
+    stats_.minor_collections = counters[0];
+    stats_.major_collections = counters[1];
+    stats_.total_pause_us = counters[2];
+    stats_.max_pause_us = counters[3];
+    stats_.bytes_allocated = counters[4];
+    stats_.bytes_promoted = counters[5];
+    stats_.bytes_reclaimed = counters[6];
+    stats_.old_live_bytes = counters[7];
+
+    nursery_top_ = nursery_top;
+    old_top_ = old_top;
+    major_threshold_ = in[2];
+    collection_requested_ = in[3] != 0;
+
+    auto next = in.begin() + kFixedWords;
+    remembered_set_.assign(next, next + remembered);
+    next += remembered;
+    std::copy(next, next + nursery_top, nursery_.begin());
+    next += nursery_top;
+    if (old_.size() < old_top) old_.resize(old_top);
+    std::copy(next, next + old_top, old_.begin());
+
+    // The collectors trust every header and reference they walk
+    if (!valid_objects(check)) {
+        reset();
+        return false;
+    }
+    return true;
+}
+
+bool GCHeap::valid_objects(const ObjectCheck& check) const {
+    // Headers: each space must parse as a run of whole objects
+    std::vector<bool> young_starts(nursery_top_), old_starts(old_top_);
+    auto parse = [](const std::vector<uint32_t>& space, uint32_t top, uint32_t flags,
+                    std::vector<bool>& starts) {
+        for (uint32_t at = 1; at < top;) {
+            if (top - at < kHeaderWords) return false;
+            const uint32_t* h = &space[at];
+            if ((h[kWordHeader] & kKindMask) > static_cast<uint32_t>(ObjectKind::BOX) ||
+                (h[kWordHeader] & ~(kKindMask | flags)) != 0 ||
+                h[kWordCapacity] > kMaxCapacity || h[kWordCount] > h[kWordCapacity] ||
+                object_words(h[kWordCapacity]) > top - at) {
+                return false;
+            }
+            starts[at] = true;
+            at += static_cast<uint32_t>(object_words(h[kWordCapacity]));
+        }
+        return true;
+    };
+    if (!parse(nursery_, nursery_top_, kFlagHasRefs, young_starts) ||
+        !parse(old_, old_top_, kFlagHasRefs | kFlagRemembered, old_starts)) {
+        return false;
+    }
+
+    auto is_object = [&](HeapRef ref) {
+        if (ref & kOldGenBit) {
+            uint32_t at = ref & ~kOldGenBit;
+            return at < old_top_ && old_starts[at];
+        }
+        return ref < nursery_top_ && young_starts[ref];
+    };
+
+    // The remembered flag and the set must agree, or a minor collection
+    // misses an old object's nursery references
+    std::vector<bool> remembered(old_top_);
+    for (HeapRef ref : remembered_set_) {
+        if (is_young(ref) || !is_object(ref)) return false;
+        remembered[ref & ~kOldGenBit] = true;
+    }
+
+    // Fields: tags in range and flagged, references at object starts, and
+    // old objects pointing into the nursery remembered
+    auto fields = [&](HeapRef ref) {
+        const uint32_t* h = header(ref);
+        const uint8_t* t = tags(ref);
+        bool young_field = false;
+        for (uint32_t i = 0; i < h[kWordCapacity]; i++) {
+            if (t[i] > kTagString || (t[i] != kTagValue && !(h[kWordHeader] & kFlagHasRefs))) {
+                return false;
+            }
+            if (t[i] != kTagRef) continue;
+            HeapRef field = h[kHeaderWords + i];
+            if (field != kNullRef && !is_object(field)) return false;
+            young_field = young_field || is_young(field);
+        }
+        if (!is_young(ref)) {
+            bool in_set = remembered[ref & ~kOldGenBit];
+            if (in_set != ((h[kWordHeader] & kFlagRemembered) != 0) || (young_field && !in_set)) {
+                return false;
+            }
+        }
+
+        // Readers index a Bubble's storage and a box's two halves directly
+        ObjectKind kind = static_cast<ObjectKind>(h[kWordHeader] & kKindMask);
+        if (kind == ObjectKind::BUBBLE) {
+            HeapRef storage = h[kHeaderWords];
+            return h[kWordCapacity] >= 1 && t[0] == kTagRef && storage != kNullRef &&
+                   this->kind(storage) == ObjectKind::ARRAY;
+        }
+        return kind != ObjectKind::BOX || h[kWordCapacity] >= 2;
+    };
+    for (uint32_t at = 1; at < nursery_top_; at += object_words(nursery_[at + kWordCapacity])) {
+        if (!fields(at)) return false;
+    }
+    for (uint32_t at = 1; at < old_top_; at += object_words(old_[at + kWordCapacity])) {
+        if (!fields(at | kOldGenBit)) return false;
+    }
+
+    bool roots_valid = true;
+    if (enumerate_roots_) {
+        enumerate_roots_([&](HeapRef& ref) {
+            if (ref != kNullRef && !is_object(ref)) roots_valid = false;
+        });
+    }
+    if (!roots_valid) return false;
+
+    if (!check) return true;
+    for (uint32_t at = 1; at < nursery_top_; at += object_words(nursery_[at + kWordCapacity])) {
+        if (!check(at)) return false;
+    }
+    for (uint32_t at = 1; at < old_top_; at += object_words(old_[at + kWordCapacity])) {
+        if (!check(at | kOldGenBit)) return false;
+    }
+    return true;
+}
+
+void GCHeap::record_pause(uint64_t pause_us) {
+    stats_.total_pause_us += pause_us;
+    stats_.max_pause_us = std::max(stats_.max_pause_us, pause_us);
+}
+
+} // namespace heip
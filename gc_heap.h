@@ -0,0 +1,151 @@
+#pragma once
+#include "../core/heip_types.h"
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace heip {
+
+// Heap references are word offsets tagged with their generation.
+// Bit 31 selects the old generation; 0 is the null reference.
+using HeapRef = uint32_t;
+const HeapRef kNullRef = 0;
+const HeapRef kOldGenBit = 0x80000000u;
+
+// Cell tags for precise root and field scanning
+const uint8_t kTagValue = 0;
+const uint8_t kTagRef = 1;
+const uint8_t kTagString = 2;   // String table index; not a heap reference
+
+// GC pause and throughput statistics
+struct GCStats {
+    uint64_t minor_collections;
+    uint64_t major_collections;
+    uint64_t total_pause_us;
+    uint64_t max_pause_us;
+    uint64_t bytes_allocated;
+    uint64_t bytes_promoted;
+    uint64_t bytes_reclaimed;
+    uint64_t old_live_bytes;
+};
+
+// Generational heap for Bubble/Chain/Case containers
+// - Nursery: bump-allocated, evacuated by a copying minor collector
+// - Old generation: mark-compact (sliding) major collector
+// Collections only run at safepoints, so a reference held across an
+// allocation inside an opcode handler is never moved underneath it.
+class GCHeap {
+public:
+    using RootVisitor = std::function<void(HeapRef&)>;
+    using RootEnumerator = std::function<void(const RootVisitor&)>;
+    using ObjectCheck = std::function<bool(HeapRef)>;
+
+    // Largest object, in cells. Capacities come from bytecode, so larger
+    // requests fail instead of wrapping the object's word count.
+    static const uint32_t kMaxCapacity = 1u << 24;
+
+    explicit GCHeap(size_t nursery_bytes = 1024 * 1024);
+
+    // Root enumeration is supplied by the runtime (frame slots, stack)
+    void set_root_enumerator(RootEnumerator enumerator) { enumerate_roots_ = enumerator; }
+
+    // Allocation - never collects; overflows into the old generation.
+    // kNullRef past kMaxCapacity or when the old generation is full.
+    HeapRef allocate(ObjectKind kind, uint32_t capacity);
+    HeapRef allocate_bubble(uint32_t capacity);
+
+    // Raw object access (index must be below capacity)
+    bool is_valid(HeapRef ref) const;
+    ObjectKind kind(HeapRef ref) const;
+    uint32_t capacity(HeapRef ref) const;
+    uint32_t count(HeapRef ref) const;
+    void set_count(HeapRef ref, uint32_t count);
+    uint32_t get_cell(HeapRef ref, uint32_t index) const;
+    uint8_t get_tag(HeapRef ref, uint32_t index) const;
+    void set_cell(HeapRef ref, uint32_t index, uint32_t value, uint8_t tag);
+
+    // Container access - Bubbles are resolved through their storage
+    uint32_t length(HeapRef ref) const;
+    uint32_t element(HeapRef ref, uint32_t index) const;
+    uint8_t element_tag(HeapRef ref, uint32_t index) const;
+    void set_element(HeapRef ref, uint32_t index, uint32_t value, uint8_t tag);
+    void set_length(HeapRef ref, uint32_t length);   // length <= storage capacity
+    bool bubble_push(HeapRef bubble, uint32_t value, uint8_t tag);   // False if it cannot grow
+
+    // Contiguous element storage (valid until the next allocation)
+    uint32_t* element_cells(HeapRef ref);
+    bool has_refs(HeapRef ref) const;
+
+    // Collection
+    void safepoint() { if (collection_requested_) collect_minor(); }
+    void collect_minor();
+    void collect_major();
+    bool collection_requested() const { return collection_requested_; }
+
+    // Snapshots: the used part of both spaces plus collector state as
+    // words. References are offsets, so they stay valid once loaded.
+    // Loading rejects, and empties the heap on, any object with a bad
+    // header or tag, and any field, remembered entry or root (enumerated
+    // from the runtime, so its roots must be in place) that is not null or
+    // an object start. `check` then sees each object for layout-specific
+    // checks; it can trust headers and references.
+    void save_words(std::vector<uint32_t>& out) const;
+    bool load_words(const std::vector<uint32_t>& in, const ObjectCheck& check = ObjectCheck());
+
+    // Empties both spaces for a fresh run; their storage is kept
+    void reset();
+
+    const GCStats& stats() const { return stats_; }
+    size_t nursery_used_bytes() const { return nursery_top_ * sizeof(uint32_t); }
+    size_t old_used_bytes() const { return old_top_ * sizeof(uint32_t); }
+
+private:
+    // Object header layout (in 32-bit words), followed by
+    // `capacity` cells and `capacity` tag bytes
+    static const uint32_t kHeaderWords = 4;
+    static const uint32_t kWordHeader = 0;    // kind | flags
+    static const uint32_t kWordCapacity = 1;
+    static const uint32_t kWordCount = 2;
+    static const uint32_t kWordForward = 3;
+
+    static const uint32_t kKindMask = 0xFF;
+    static const uint32_t kFlagMarked = 0x100;
+    static const uint32_t kFlagForwarded = 0x200;
+    static const uint32_t kFlagHasRefs = 0x400;
+    static const uint32_t kFlagRemembered = 0x800;
+
+    static size_t object_words(uint32_t capacity) {
+        return kHeaderWords + static_cast<size_t>(capacity) + (static_cast<size_t>(capacity) + 3) / 4;
+    }
+    static bool is_young(HeapRef ref) { return ref != kNullRef && !(ref & kOldGenBit); }
+
+    std::vector<uint32_t> nursery_;
+    uint32_t nursery_top_;
+    std::vector<uint32_t> old_;
+    uint32_t old_top_;
+    uint32_t initial_major_threshold_;
+    uint32_t major_threshold_;
+    bool collection_requested_;
+
+    // Old objects holding nursery references (write barrier)
+    std::vector<HeapRef> remembered_set_;
+
+    RootEnumerator enumerate_roots_;
+    GCStats stats_;
+
+    uint32_t* header(HeapRef ref);
+    const uint32_t* header(HeapRef ref) const;
+    uint8_t* tags(HeapRef ref);
+    const uint8_t* tags(HeapRef ref) const;
+    HeapRef storage_of(HeapRef ref) const;
+    bool valid_objects(const ObjectCheck& check) const;
+
+    HeapRef allocate_old(ObjectKind kind, uint32_t capacity);
+    HeapRef evacuate(HeapRef ref);
+    void scan_object(HeapRef ref, const RootVisitor& visitor);
+    void minor_phase();
+    void major_phase();
+    void record_pause(uint64_t pause_us);
+};
+
+} // namespace heip
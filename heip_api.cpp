@@ -0,0 +1,51 @@
+#include "heip_api.h"
+
+namespace heip {
+
+Execution::Execution(std::shared_ptr<const Program> program) {
+    runtime_.load_program(std::move(program));
+}
+
+size_t Execution::slot_count() const {
+    auto root = runtime_.root_frame();
+    return root ? root->slots.size() : 0;
+}
+
+bool Execution::slot(size_t index, Value& value) const {
+    auto root = runtime_.root_frame();
+    if (!root || index >= root->slots.size()) return false;
+    value = root->slots[index];
+    return true;
+}
+
+ExecutionPool::ExecutionPool(std::shared_ptr<const Program> program, size_t max_idle)
+    : program_(std::move(program))
+    , max_idle_(max_idle) {
+}
+
+std::unique_ptr<Execution> ExecutionPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            std::unique_ptr<Execution> execution = std::move(idle_.back());
+            idle_.pop_back();
+            return execution;
+        }
+    }
+    return std::unique_ptr<Execution>(new Execution(program_));
+}
+
+void ExecutionPool::release(std::unique_ptr<Execution> execution) {
+    // Executions of another program would run the wrong code
+    if (!execution || &execution->program() != program_.get()) return;
+    execution->reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_.size() < max_idle_) idle_.push_back(std::move(execution));
+}
+
+size_t ExecutionPool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+} // namespace heip
@@ -0,0 +1,62 @@
+#pragma once
+#include "../runtime/frame_runtime.h"
+#include "../runtime/program.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace heip {
+
+// Embedding API (libheip)
+// A Program is loaded once and shared read-only by every Execution that
+// runs it, on any thread. An Execution owns everything a run mutates
+// (stack, frames, memory, heap, inline caches) and is used by one thread
+// at a time; an ExecutionPool hands them out so requests skip the cost of
+// setting one up.
+
+// One run context over a shared Program
+class Execution {
+public:
+    explicit Execution(std::shared_ptr<const Program> program);
+
+    // Runs from the program's entry; 0 on success. Call reset() before
+    // running again.
+    int run() { return runtime_.execute(); }
+    void reset() { runtime_.reset(); }
+
+    const Program& program() const { return *runtime_.get_program(); }
+    uint64_t instruction_count() const { return runtime_.get_instruction_count(); }
+
+    // Slots of the root frame, where a program leaves its results
+    size_t slot_count() const;
+    bool slot(size_t index, Value& value) const;
+
+    // Configuration and statistics beyond the above
+    FrameRuntime& runtime() { return runtime_; }
+
+private:
+    FrameRuntime runtime_;
+};
+
+// Thread-safe pool of Executions for one Program. Released executions are
+// reset and kept, up to `max_idle`, so their heap, stack storage and warm
+// inline caches carry over to the next request.
+class ExecutionPool {
+public:
+    explicit ExecutionPool(std::shared_ptr<const Program> program, size_t max_idle = 16);
+
+    std::unique_ptr<Execution> acquire();
+    void release(std::unique_ptr<Execution> execution);
+
+    const std::shared_ptr<const Program>& program() const { return program_; }
+    size_t idle() const;
+
+private:
+    std::shared_ptr<const Program> program_;
+    size_t max_idle_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Execution>> idle_;
+};
+
+} // namespace heip
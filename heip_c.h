@@ -0,0 +1,41 @@
+#pragma once
+
+/* C ABI of libheip. Handles are opaque; a program may be released while
+ * pools created from it are still alive. Pools are thread-safe, an
+ * execution is used by one thread at a time. Nothing here throws. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct heip_program heip_program;
+typedef struct heip_pool heip_pool;
+typedef struct heip_execution heip_execution;
+
+/* Linked images or raw bytecode. NULL on failure, with the reason copied
+ * to `error` (truncated to `error_size`) when it is not NULL. */
+heip_program* heip_program_load(const uint8_t* data, size_t size,
+                                char* error, size_t error_size);
+heip_program* heip_program_load_file(const char* path, char* error, size_t error_size);
+void heip_program_release(heip_program* program);
+
+/* Up to `max_idle` released executions are kept for reuse */
+heip_pool* heip_pool_create(const heip_program* program, size_t max_idle);
+void heip_pool_destroy(heip_pool* pool);
+heip_execution* heip_pool_acquire(heip_pool* pool);
+void heip_pool_release(heip_pool* pool, heip_execution* execution);
+
+/* 0 on success. Root frame slots hold the results; the accessors return
+ * 0 when the slot is missing or not an int (a number, for doubles). */
+int heip_execution_run(heip_execution* execution);
+uint64_t heip_execution_instructions(const heip_execution* execution);
+size_t heip_execution_slot_count(const heip_execution* execution);
+int heip_execution_slot_int(const heip_execution* execution, size_t index, int32_t* value);
+int heip_execution_slot_double(const heip_execution* execution, size_t index, double* value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+#include "heip_c.h"
+#include "heip_api.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+// Handles wrap the C++ objects; exceptions stop at this boundary
+
+struct heip_program {
+    std::shared_ptr<const heip::Program> program;
+};
+
+struct heip_pool {
+    heip::ExecutionPool pool;
+    heip_pool(std::shared_ptr<const heip::Program> program, size_t max_idle)
+        : pool(std::move(program), max_idle) {}
+};
+
+struct heip_execution {
+    std::unique_ptr<heip::Execution> execution;
+};
+
+namespace {
+
+void copy_error(const std::string& message, char* error, size_t error_size) {
+    if (!error || error_size == 0) return;
+    size_t length = std::min(message.size(), error_size - 1);
+    std::memcpy(error, message.data(), length);
+    error[length] = '\0';
+}
+
+heip_program* wrap(std::shared_ptr<const heip::Program> program, const std::string& message,
+                   char* error, size_t error_size) {
+    if (!program) {
+        copy_error(message, error, error_size);
+        return nullptr;
+    }
+    return new (std::nothrow) heip_program{std::move(program)};
+}
+
+} // namespace
+
+extern "C" {
+
+heip_program* heip_program_load(const uint8_t* data, size_t size,
+                                char* error, size_t error_size) {
+    try {
+        std::string message;
+        std::vector<uint8_t> bytes(data, data + size);
+        return wrap(heip::Program::load(bytes, message), message, error, error_size);
+    } catch (const std::exception& e) {
+        copy_error(e.what(), error, error_size);
+        return nullptr;
+    }
+}
+
+heip_program* heip_program_load_file(const char* path, char* error, size_t error_size) {
+    try {
+        std::string message;
+        return wrap(heip::Program::load_file(path, message), message, error, error_size);
+    } catch (const std::exception& e) {
+        copy_error(e.what(), error, error_size);
+        return nullptr;
+    }
+}
+
+void heip_program_release(heip_program* program) {
+    delete program;
+}
+
+heip_pool* heip_pool_create(const heip_program* program, size_t max_idle) {
+    if (!program) return nullptr;
+    return new (std::nothrow) heip_pool(program->program, max_idle);
+}
+
+void heip_pool_destroy(heip_pool* pool) {
+    delete pool;
+}
+
+heip_execution* heip_pool_acquire(heip_pool* pool) {
+    if (!pool) return nullptr;
+    try {
+        std::unique_ptr<heip_execution> handle(new heip_execution{pool->pool.acquire()});
+        return handle.release();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void heip_pool_release(heip_pool* pool, heip_execution* execution) {
+    if (!execution) return;
+    if (pool) {
+        try {
+            pool->pool.release(std::move(execution->execution));
+        } catch (const std::exception&) {
+            // Not kept for reuse; freed below
+        }
+    }
+    delete execution;
+}
+
+int heip_execution_run(heip_execution* execution) {
+    if (!execution) return 1;
+    try {
+        return execution->execution->run();
+    } catch (const std::exception&) {
+        return 1;
+    }
+}
+
+uint64_t heip_execution_instructions(const heip_execution* execution) {
+    return execution ? execution->execution->instruction_count() : 0;
+}
+
+size_t heip_execution_slot_count(const heip_execution* execution) {
+    return execution ? execution->execution->slot_count() : 0;
+}
+
+int heip_execution_slot_int(const heip_execution* execution, size_t index, int32_t* value) {
+    heip::Value slot;
+    if (!execution || !value || !execution->execution->slot(index, slot) || !slot.is_int()) {
+        return 0;
+    }
+    *value = slot.as_int();
+    return 1;
+}
+
+int heip_execution_slot_double(const heip_execution* execution, size_t index, double* value) {
+    heip::Value slot;
+    if (!execution || !value || !execution->execution->slot(index, slot) || !slot.is_number()) {
+        return 0;
+    }
+    *value = slot.to_double();
+    return 1;
+}
+
+} // extern "C"
@@ -4,11 +4,17 @@
 #include <memory>
 #include <unordered_map>
 #include <cstdint>
+#include <cstring>
 
 namespace heip {
 
-// Dodecagramic symbol type (0-9, a-b, then c-z as needed)
-using DodecaSymbol = char;
+// Dodecagramic symbol ordinal. Ordinals 0-35 are the single-character
+// symbols 0-9, a-z; larger ordinals spell multi-character symbols
+// ("00", "01", ... "zz", "000", ...). Loaders index tables by ordinal, so
+// ordinals stay below kSymbolLimit (every 1-3 character symbol fits).
+using DodecaSymbol = uint32_t;
+const DodecaSymbol kInvalidSymbol = 0xFFFFFFFFu;
+const DodecaSymbol kSymbolLimit = 1u << 20;
 
 // Core types for the H.E.I.P. language
 enum class InstructionType {
@@ -22,7 +28,14 @@ enum class InstructionType {
     PROTOCOL,      // Instruction sequence
     RANGE,         // Contextual execution boundary
     OVERLAY,       // Symbolic compression keyword
-    SUPERLATIVE    // Dynamic best-reference resolver
+    SUPERLATIVE,   // Dynamic best-reference resolver
+    ELEMENT,       // Container element line (`push 100`, `42`)
+    IF,            // Conditional block (optional Else)
+    ELSE,
+    WHILE,         // Loop block
+    BREAK,         // Leave the innermost While
+    CONTINUE,      // Next iteration of the innermost While
+    END            // Block terminator
 };
 
 enum class MutabilityType {
@@ -49,29 +62,121 @@ LOAD = 0x01,
     POP = 0x0E,
     ALLOC = 0x0F,
     FREE = 0x10,
+    // Relational compares push 1 or 0 (signed)
+    CMP_EQ = 0x11,
+    CMP_NE = 0x12,
+    CMP_LT = 0x13,
+    CMP_LE = 0x14,
+    CMP_GT = 0x15,
+    CMP_GE = 0x16,
+    // Typed constants; LOAD pushes an int
+    LOAD_F64 = 0x17,        // Operands: high and low word of the double's bits
+    LOAD_STR = 0x18,        // Operand: index into the image's string table
     // HELP-specific opcodes
     HELP_LEARN = 0x20,
     HELP_ADAPT = 0x21,
     HELP_HEAL = 0x22,
     HELP_RECOMMEND = 0x23,
+    HELP_SNAPSHOT = 0x24,   // Where `heip snapshot` stops; a no-op otherwise
     // Frame runtime opcodes
     FRAME_CREATE = 0x30,
     FRAME_ENTER = 0x31,
     FRAME_EXIT = 0x32,
     STATE_SAVE = 0x33,
     STATE_RESTORE = 0x34,
+    SLOT_LOAD = 0x35,
+    SLOT_STORE = 0x36,
+    INLINE_ENTER = 0x37,    // Heal point for an inlined protocol body
+    INLINE_EXIT = 0x38,
+    TAILCALL = 0x39,        // CALL whose callee takes over the caller's frame
     // Overlay compressed opcodes (exponential forms)
     OVERLAY_EXPAND = 0x40,
-    SYMBOL_RESOLVE = 0x41
+    SYMBOL_RESOLVE = 0x41,
+    SUPERLATIVE = 0x42,     // Call a Superlative's best-ranked candidate
+    // Managed container opcodes (Bubble/Chain/Case)
+    ELEM_LOAD = 0x50,
+    ELEM_STORE = 0x51,
+    ELEM_COUNT = 0x52,
+    BUBBLE_PUSH = 0x53,
+    CHAIN_NEW = 0x54,
+    CHAIN_APPEND = 0x55,
+    CHAIN_SET = 0x56,
+    CHAIN_SLICE = 0x57,
+    // Vector opcodes over contiguous numeric containers
+    VADD = 0x60,
+    VSUB = 0x61,
+    VMUL = 0x62,
+    VSUM = 0x63,
+    VMIN = 0x64,
+    VMAX = 0x65,
+    VCMPEQ = 0x66,
+    VCMPLT = 0x67,
+    VCMPGT = 0x68,
+    // Superinstructions fused from hot opcode pairs (profile-guided)
+    ADD_IMM = 0x70,         // LOAD k; ADD
+    SUB_IMM = 0x71,         // LOAD k; SUB
+    SLOT_LOAD2 = 0x72,      // SLOT_LOAD a; SLOT_LOAD b
+    SLOT_TEE = 0x73,        // SLOT_STORE s; SLOT_LOAD s
+    JEQ = 0x74,             // CMP_<rel>; JNZ (or the inverse relation; JZ)
+    JNE = 0x75,
+    JLT = 0x76,
+    JLE = 0x77,
+    JGT = 0x78,
+    JGE = 0x79,
+    // Compact operand forms: the 4-byte form's operation with each operand
+    // in one byte (immediates sign-extended)
+    LOAD_I8 = 0x80,         // LOAD
+    SLOT_LOAD_U8 = 0x81,    // SLOT_LOAD
+    SLOT_STORE_U8 = 0x82,   // SLOT_STORE
+    SLOT_TEE_U8 = 0x83,     // SLOT_TEE
+    SLOT_LOAD2_U8 = 0x84,   // SLOT_LOAD2
+    ADD_I8 = 0x85,          // ADD_IMM
+    SUB_I8 = 0x86           // SUB_IMM
+};
+
+// What a Relocation records
+enum class RelocationKind : uint8_t {
+    CALL_TARGET,    // The 4-byte operand at `offset` receives the code offset
+                    // of the protocol named `target` once units are laid out
+    BRANCH_SITE,    // Conditional branch whose operand is at `offset`, profiled
+                    // under (`target`, `line`)
+    INLINE_SITE     // Protocol `target` was inlined starting at `offset`
+};
+
+// Code annotation that follows its instruction through splicing,
+// optimization and linking
+struct Relocation {
+    uint32_t offset;
+    std::string target;
+    RelocationKind kind;
+    uint32_t line;          // BRANCH_SITE: source line of the If/While
+    bool inverted;          // BRANCH_SITE: taken when the condition is false
+};
+
+// Managed object kinds backing the first-class containers; also the
+// kind byte of the ALLOC opcode
+enum class ObjectKind : uint8_t {
+    ARRAY = 0,     // Raw cell storage (Bubble backing store)
+    BUBBLE = 1,    // Mutable, growable container
+    CHAIN = 2,     // Immutable sequence
+    CASE = 3,      // Standardized fixed-shape container
+    CHAIN_NODE = 4, // Interior/leaf node of a persistent Chain
+    BOX = 5         // A double held in a container cell (high word, low word)
 };
 
 // Overlay definition - replaces entire structures with symbols
 struct Overlay {
     std::string name;
     DodecaSymbol symbol;
-    std::vector<uint8_t> compressed_bytecode;  // Exponentially folded form
-    size_t original_size;
-    size_t compressed_size;
+    std::vector<uint8_t> compressed_bytecode;  // Compiled body (no frame prologue)
+    size_t original_size;                      // Bytes an inline expansion costs
+    size_t compressed_size;                    // Bytes of a shared expansion site
+    
+    // Compiled-once body metadata
+    uint32_t slot_count;                       // Body-local frame slots
+    std::vector<Relocation> relocations;       // Relative to compressed_bytecode
+    uint32_t use_count;                        // Expansion sites in the program
+    bool expanded_shared;                      // Some site runs the shared body
     
     float compression_ratio() const {
         return original_size > 0 ? 
@@ -91,8 +196,12 @@ struct Instruction {
 };
 
 // Protocol - sequence of instructions forming behavioral etiquette
+// Overlay and Range blocks compile through the same structure; `kind`
+// says which block produced it.
 struct Protocol {
   std::string name;
+    InstructionType kind;        // PROTOCOL, OVERLAY or RANGE
+    std::string scope;           // Enclosing franchise path ("" at top level)
     std::vector<std::shared_ptr<Instruction>> instructions;
     std::unordered_map<std::string, std::string> state_variables;
     uint32_t range_scope;
@@ -121,16 +230,49 @@ struct Range {
     std::vector<std::shared_ptr<State>> states;
 };
 
+// Open-addressing keyword -> symbol index
+// Linear probing over a power-of-two slot array; keyword bytes live in one
+// contiguous arena so a probe touches the slot and, on a hash match, a
+// single string.
+class KeywordTable {
+public:
+    KeywordTable();
+    
+    DodecaSymbol find(const std::string& keyword) const;
+    void insert(const std::string& keyword, DodecaSymbol symbol);
+    size_t size() const { return size_; }
+    
+private:
+    struct Slot {
+        uint64_t hash;           // 0 marks an empty slot
+        uint32_t key_offset;
+        uint32_t key_length;
+        DodecaSymbol symbol;
+    };
+    
+    std::vector<Slot> slots_;
+    std::string arena_;
+    size_t size_;
+    
+    static uint64_t hash_of(const std::string& keyword);
+    size_t probe(const std::string& keyword, uint64_t hash) const;
+    void grow();
+};
+
 // Dodecagramic compression mapping
 struct DodecaMap {
-    std::unordered_map<DodecaSymbol, std::shared_ptr<Overlay>> symbol_to_overlay;
-    std::unordered_map<std::string, DodecaSymbol> keyword_to_symbol;
+    // Direct-indexed by symbol ordinal (the first 36 are 0-9, a-z)
+    std::vector<std::shared_ptr<Overlay>> symbol_to_overlay;
+    KeywordTable keyword_to_symbol;
     
  // Convert complex structures to dodecagramic symbols
-    DodecaSymbol compress(const std::string& keyword);
-    std::shared_ptr<Overlay> decompress(DodecaSymbol symbol);
+    DodecaSymbol compress(const std::string& keyword) const;
+    std::shared_ptr<Overlay> decompress(DodecaSymbol symbol) const;
+    void bind(const std::string& keyword, const std::shared_ptr<Overlay>& overlay);
 };
 
+class ExecutionProfile;
+
 // HELP context for learning and adaptation
 struct HELPContext {
     uint64_t compilation_count;
@@ -138,11 +280,80 @@ struct HELPContext {
     std::vector<std::string> adaptation_history;
   std::unordered_map<std::string, float> heuristic_scores;
     
+    // Profile from `--profile-in`; drives block layout, inlining and
+    // superinstruction selection
+    std::shared_ptr<const ExecutionProfile> profile;
+    
     void learn_from_error(const std::string& error_type);
     void adapt_optimization(const std::string& pattern);
     std::string recommend_fix(const std::string& issue);
 };
 
+// Runtime value: a NaN-boxed 64-bit word. Doubles are stored as
+// themselves, with NaN results canonicalised so that the negative quiet-NaN
+// space above 0xFFF8 is free for tagged kinds, each a 16-bit tag over a
+// 32-bit payload:
+//   0xFFF9 int32, 0xFFFA heap reference, 0xFFFB interned string handle
+class Value {
+public:
+    Value() : bits_(kIntTag) {}   // Int 0
+
+    static Value integer(int32_t value) { return Value(kIntTag | static_cast<uint32_t>(value)); }
+    static Value reference(uint32_t ref) { return Value(kRefTag | ref); }
+    static Value string(uint32_t handle) { return Value(kStringTag | handle); }
+    static Value number(double value) {
+        if (value != value) return Value(kCanonicalNaN);
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return Value(bits);
+    }
+    static Value from_bits(uint64_t bits) { return Value(bits); }
+
+    bool is_double() const { return bits_ < kIntTag; }
+    bool is_int() const { return (bits_ & kTagMask) == kIntTag; }
+    bool is_ref() const { return (bits_ & kTagMask) == kRefTag; }
+    bool is_string() const { return (bits_ & kTagMask) == kStringTag; }
+    bool is_number() const { return is_int() || is_double(); }
+
+    int32_t as_int() const { return static_cast<int32_t>(payload()); }
+    uint32_t payload() const { return static_cast<uint32_t>(bits_); }
+    double as_double() const {
+        double value;
+        std::memcpy(&value, &bits_, sizeof(value));
+        return value;
+    }
+    double to_double() const { return is_int() ? as_int() : as_double(); }
+
+    // Int view for operands that must be 32-bit (indices, symbols):
+    // doubles truncate toward zero and saturate, NaN becomes 0
+    uint32_t to_u32() const {
+        if (!is_double()) return payload();
+        double value = as_double();
+        if (value != value) return 0;
+        if (value >= 2147483647.0) return 0x7FFFFFFFu;
+        if (value <= -2147483648.0) return 0x80000000u;
+        return static_cast<uint32_t>(static_cast<int32_t>(value));
+    }
+
+    // Condition of JZ/JNZ: int 0, ±0.0 and the null reference
+    bool is_zero() const {
+        return is_double() ? as_double() == 0.0 : !is_string() && payload() == 0;
+    }
+
+    uint64_t bits() const { return bits_; }
+    bool operator==(const Value& other) const { return bits_ == other.bits_; }
+
+private:
+    static const uint64_t kTagMask = 0xFFFF000000000000ull;
+    static const uint64_t kIntTag = 0xFFF9000000000000ull;
+    static const uint64_t kRefTag = 0xFFFA000000000000ull;
+    static const uint64_t kStringTag = 0xFFFB000000000000ull;
+    static const uint64_t kCanonicalNaN = 0x7FF8000000000000ull;
+
+    explicit Value(uint64_t bits) : bits_(bits) {}
+    uint64_t bits_;
+};
+
 // Frame - execution context with temporal state
 struct Frame {
     std::string name;
@@ -152,6 +363,16 @@ struct Frame {
     uint64_t frame_id;
   uint64_t timestamp;
     
+    // Local slots
+    std::vector<Value> slots;
+    
+    // Code offset to resume at when the frame exits
+    uint32_t return_pc;
+    
+    // Entered at a unit whose stack effect was proven, with the stack deep
+    // enough for it: runs without stack checks
+    bool stack_verified;
+    
     // Self-healing properties
     bool can_recover;
     std::vector<uint8_t> checkpoint_state;
@@ -0,0 +1,238 @@
+// Regression tests for loading hand-built images and snapshots. Each case
+// builds input the compiler or runtime would never write and checks that
+// the loader or the verifier refuses to trust it. Run through `ctest`;
+// exits non-zero if any check fails.
+#include "bytecode_image.h"
+#include "opcode_table.h"
+#include "frame_runtime.h"
+#include "program.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace heip;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+void emit(std::vector<uint8_t>& code, HEIPOpcode opcode) {
+    code.push_back(static_cast<uint8_t>(opcode));
+}
+
+void emit(std::vector<uint8_t>& code, HEIPOpcode opcode, uint32_t operand) {
+    emit(code, opcode);
+    uint8_t bytes[4];
+    write_u32(bytes, operand);
+    code.insert(code.end(), bytes, bytes + 4);
+}
+
+void add_unit(BytecodeImage& image, const std::string& name, UnitKind kind,
+              const std::vector<uint8_t>& code, bool claimed, StackEffect effect) {
+    image.units.push_back(ImageUnit{name, kind, kInvalidSymbol,
+                                    static_cast<uint32_t>(image.code.size()),
+                                    static_cast<uint32_t>(code.size()), 0, claimed, effect,
+                                    false});
+    image.code.insert(image.code.end(), code.begin(), code.end());
+}
+
+// __main__ calls A, whose TAILCALL hands its frame to B. B pushes 50
+// values; the code after the TAILCALL, which only runs when the call is
+// not a tail call, pops them again.
+BytecodeImage tailcall_image(uint32_t pops_after) {
+    const uint32_t kPushes = 50;
+    const uint32_t main_size = 6;                   // CALL A; RET
+    const uint32_t a_size = 5 + pops_after + 1;     // TAILCALL B; POP...; RET
+
+    BytecodeImage image;
+    std::vector<uint8_t> main_code, a, b;
+    emit(main_code, HEIPOpcode::CALL, main_size);
+    emit(main_code, HEIPOpcode::RET);
+    emit(a, HEIPOpcode::TAILCALL, main_size + a_size);
+    for (uint32_t i = 0; i < pops_after; i++) emit(a, HEIPOpcode::POP);
+    emit(a, HEIPOpcode::RET);
+    for (uint32_t i = 0; i < kPushes; i++) {
+        b.push_back(static_cast<uint8_t>(HEIPOpcode::LOAD_I8));
+        b.push_back(1);
+    }
+    emit(b, HEIPOpcode::RET);
+
+    int32_t net_after = static_cast<int32_t>(kPushes - pops_after);
+    add_unit(image, "__main__", UnitKind::MAIN, main_code, false, StackEffect{0, 0, 0});
+    add_unit(image, "A", UnitKind::PROTOCOL, a, true,
+             StackEffect{0, static_cast<int32_t>(kPushes), net_after});
+    add_unit(image, "B", UnitKind::PROTOCOL, b, true,
+             StackEffect{0, static_cast<int32_t>(kPushes), static_cast<int32_t>(kPushes)});
+    image.entry = 0;
+    return image;
+}
+
+void test_tailcall_effect_is_its_callees() {
+    // A claims the net of its fall-through path, which a real tail call
+    // never takes: it must not verify
+    std::string error;
+    std::shared_ptr<Program> program = Program::load(tailcall_image(50).serialize(), error);
+    check(program != nullptr, "tail call image loads: " + error);
+    if (!program) return;
+    const ProgramUnit* a = program->find_unit(6);
+    check(a && !a->stack_verified, "TAILCALL followed by pops does not verify");
+
+    // Runs checked, so the 50 values B leaves cannot overrun the stack
+    FrameRuntime runtime;
+    runtime.enable_self_healing(false);
+    runtime.load_program(program);
+    check(runtime.execute() == 0, "tail call image runs checked");
+}
+
+void test_tailcall_then_ret_verifies() {
+    // The compiler's shape (CALL; RET turned TAILCALL; RET) keeps verifying
+    std::string error;
+    std::shared_ptr<Program> program = Program::load(tailcall_image(0).serialize(), error);
+    check(program != nullptr, "tail call image loads: " + error);
+    if (!program) return;
+    const ProgramUnit* a = program->find_unit(6);
+    check(a && a->stack_verified, "TAILCALL followed by RET verifies");
+}
+
+// __main__ allocates a two-cell array and an empty Chain, then stops at
+// HELP Snapshot with both references on the stack
+std::vector<uint8_t> heap_snapshot(const std::string& path) {
+    BytecodeImage image;
+    std::vector<uint8_t> main_code;
+    emit(main_code, HEIPOpcode::ALLOC);
+    main_code.push_back(static_cast<uint8_t>(ObjectKind::ARRAY));
+    main_code.insert(main_code.end(), {0, 0, 0, 2});
+    emit(main_code, HEIPOpcode::ALLOC);
+    main_code.push_back(static_cast<uint8_t>(ObjectKind::CHAIN));
+    main_code.insert(main_code.end(), {0, 0, 0, 0});
+    emit(main_code, HEIPOpcode::HELP_SNAPSHOT);
+    emit(main_code, HEIPOpcode::POP);
+    emit(main_code, HEIPOpcode::POP);
+    emit(main_code, HEIPOpcode::RET);
+    add_unit(image, "__main__", UnitKind::MAIN, main_code, false, StackEffect{0, 2, 0});
+    image.entry = 0;
+
+    std::vector<uint8_t> bytes = image.serialize();
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()),
+                                                 bytes.size());
+    FrameRuntime runtime;
+    runtime.set_snapshot_stop(true);
+    if (!runtime.load_file(path) || runtime.execute() != 0 || !runtime.save_snapshot(path)) {
+        return {};
+    }
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+}
+
+// Offsets into a snapshot with one frame, following save_snapshot's layout
+struct SnapshotLayout {
+    size_t stack;        // First stack value
+    size_t checkpoint;   // The frame's checkpoint size
+    size_t heap;         // First heap word, after the word count
+};
+
+SnapshotLayout locate(const std::vector<uint8_t>& snap) {
+    SnapshotLayout layout;
+    size_t at = 12 + read_u32(&snap[8]) + 24;           // Header, image, pc .. last fault
+    layout.stack = at + 4;
+    at = layout.stack + 8 * read_u32(&snap[at]);
+    at += 4 + read_u32(&snap[at]);                        // Memory
+    at += 4;                                              // Frame count
+    at += 2 + ((snap[at] << 8) | snap[at + 1]) + 16;      // Name, id, timestamp
+    at += 4 + 8 * read_u32(&snap[at]) + 4 + 1;            // Slots, return pc, can_recover
+    layout.checkpoint = at;
+    at += 4 + read_u32(&snap[at]);
+    at += 1;                                              // No range on the root frame
+    at += 4 + 12 * read_u32(&snap[at]);                   // Inline marks
+    layout.heap = at + 4;
+    return layout;
+}
+
+// Heap word `index` of the nursery (no remembered set in these snapshots)
+size_t nursery_word(const SnapshotLayout& layout, uint32_t index) {
+    return layout.heap + 4 * (21 + index);
+}
+
+bool resumes(const std::vector<uint8_t>& snap, const std::string& path) {
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(snap.data()),
+                                                 snap.size());
+    FrameRuntime runtime;
+    runtime.enable_self_healing(false);
+    return runtime.load_snapshot(path) && runtime.execute() == 0;
+}
+
+void test_malformed_snapshots_rejected() {
+    const std::string path = "image_tests.snap";
+    std::vector<uint8_t> snap = heap_snapshot(path);
+    check(!snap.empty(), "heap snapshot written");
+    if (snap.empty()) return;
+    SnapshotLayout layout = locate(snap);
+    check(resumes(snap, path), "intact snapshot resumes");
+
+    // Nursery: array header at word 1, cells 5-6, tags in word 7; the
+    // Chain's root node at 8, its tail at 52 and its header cells at 60
+    const uint32_t kArray = 1, kArrayTags = 7, kChainShift = 63;
+    check(read_u32(&snap[layout.stack + 4]) == kArray, "array is the first stack value");
+
+    // A checkpoint that does not end on a whole entry
+    std::vector<uint8_t> bad = snap;
+    write_u32(&bad[layout.checkpoint], read_u32(&bad[layout.checkpoint]) + 4);
+    bad.insert(bad.begin() + layout.checkpoint + 4, {0, 0, 0, 0});
+    check(!resumes(bad, path), "checkpoint ending mid-entry rejected");
+
+    // A stack reference into the middle of an object
+    bad = snap;
+    write_u32(&bad[layout.stack + 4], kArray + 1);
+    check(!resumes(bad, path), "interior stack reference rejected");
+
+    // A tag byte outside the known tags
+    bad = snap;
+    size_t tags_at = nursery_word(layout, kArrayTags);
+    uint32_t word = read_u32(&bad[tags_at]);
+    uint8_t tag_bytes[4];
+    std::memcpy(tag_bytes, &word, 4);
+    tag_bytes[0] = 7;
+    std::memcpy(&word, tag_bytes, 4);
+    write_u32(&bad[tags_at], word);
+    check(!resumes(bad, path), "unknown cell tag rejected");
+
+    // A reference field pointing at a header word, on an object flagged
+    // as holding references
+    bad = snap;
+    tag_bytes[0] = kTagRef;
+    std::memcpy(&word, tag_bytes, 4);
+    write_u32(&bad[tags_at], word);
+    size_t header_at = nursery_word(layout, kArray);
+    write_u32(&bad[header_at], read_u32(&bad[header_at]) | 0x400);
+    write_u32(&bad[nursery_word(layout, kArray + 4)], kArray + 2);
+    check(!resumes(bad, path), "reference into an object header rejected");
+
+    // A Chain whose shift sends lookups below its leaves
+    bad = snap;
+    write_u32(&bad[nursery_word(layout, kChainShift)], 7);
+    check(!resumes(bad, path), "Chain with a bad shift rejected");
+
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+int main() {
+    test_tailcall_effect_is_its_callees();
+    test_tailcall_then_ret_verifies();
+    test_malformed_snapshots_rejected();
+    if (failures == 0) std::cout << "image tests passed\n";
+    return failures == 0 ? 0 : 1;
+}
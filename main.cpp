@@ -1,9 +1,19 @@
 #include "core/dodeca_compiler.h"
+#include "core/batch_compiler.h"
+#include "core/object_linker.h"
 #include "runtime/frame_runtime.h"
+#include "runtime/franchise_workers.h"
+#include "runtime/runtime_metrics.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <iterator>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <thread>
 
 void print_banner() {
     std::cout << R"(
@@ -23,13 +33,30 @@ void print_usage() {
     std::cout << "Usage: heip [command] [options]\n\n";
     std::cout << "Commands:\n";
     std::cout << "  compile <input.heip> <output>   - Compile H.E.I.P. source to native code\n";
+    std::cout << "  compile --batch <manifest>      - Compile every `<input> [output]` line in one process\n";
+    std::cout << "  link <output> <objects...>      - Link objects from compile --object\n";
     std::cout << "  run <bytecode>       - Execute H.E.I.P. bytecode\n";
+    std::cout << "  snapshot <image> <output.snap>  - Run to HELP Snapshot and save the runtime\n";
+    std::cout << "  top <metrics-file>              - Watch a run's live metrics (run --metrics=)\n";
     std::cout << "  info    - Display compiler information\n";
     std::cout << "  help          - Show this help message\n\n";
     std::cout << "Options:\n";
     std::cout << "  --no-help  - Disable HELP learning system\n";
     std::cout << "  --no-healing   - Disable self-healing runtime\n";
   std::cout << "  --stats          - Show detailed statistics\n";
+    std::cout << "  --overlays=<auto|inline|shared> - Overlay expansion strategy\n";
+    std::cout << "  -O0, -O1, -O2    - Optimization level (default -O2)\n";
+    std::cout << "  --profile-out=<file> - Record an execution profile (run; accumulates)\n";
+    std::cout << "  --profile-in=<file>  - Optimize with a recorded profile (compile)\n";
+    std::cout << "  --object             - Compile to an object for heip link (compile)\n";
+    std::cout << "  --jobs=<n>           - Batch worker threads (default: one per core)\n";
+    std::cout << "  --out-dir=<dir>      - Batch output directory for lines without one\n";
+    std::cout << "  --from-snapshot      - Resume a snapshot instead of starting an image (run)\n";
+    std::cout << "  --metrics=<file>     - Publish live metrics to a shared file (run)\n";
+    std::cout << "  --delegate=<a,b>     - Run calls into these franchises in worker processes (run)\n";
+    std::cout << "  --workers=<n>        - Franchise worker processes (default 1)\n";
+    std::cout << "  --memo=<n>           - Results kept for pure protocols (default 4096; 0 = off)\n";
+    std::cout << "  --once               - Print one Prometheus sample and exit (top)\n";
     std::cout << std::endl;
 }
 
@@ -45,7 +72,7 @@ void print_info() {
     std::cout << "Standards:      C++14 compatible\n\n";
   
     std::cout << "Key Features:\n";
-    std::cout << "  • Dodecagramic symbol compression (0-9, a-b, c-z)\n";
+    std::cout << "  • Dodecagramic symbol compression (0-9, a-z, then multi-character)\n";
     std::cout << "  • Overlay-based structural replacement\n";
     std::cout << "  • Exponential folding techniques\n";
     std::cout << "  • Direct opcode mapping from condensed forms\n";
@@ -61,7 +88,8 @@ void print_info() {
 }
 
 int main(int argc, char* argv[]) {
-    print_banner();
+    // top's output is scraped as Prometheus text
+    if (argc < 2 || std::string(argv[1]) != "top") print_banner();
     
     if (argc < 2) {
         print_usage();
@@ -83,6 +111,19 @@ return 0;
     bool help_enabled = true;
     bool healing_enabled = true;
     bool show_stats = false;
+    heip::OverlayStrategy overlay_strategy = heip::OverlayStrategy::AUTO;
+    int optimization_level = 2;
+    std::string profile_out;
+    std::string profile_in;
+    unsigned jobs = 0;
+    bool object_output = false;
+    std::string out_dir;
+    bool from_snapshot = false;
+    std::string metrics_file;
+    bool top_once = false;
+    std::vector<std::string> delegated_franchises;
+    size_t worker_count = 1;
+    size_t memo_capacity = heip::MemoTable::kDefaultCapacity;
     
     // Parse options
     for (int i = 2; i < argc; i++) {
@@ -93,9 +134,91 @@ return 0;
       healing_enabled = false;
         } else if (arg == "--stats") {
    show_stats = true;
+        } else if (arg == "--overlays=inline") {
+            overlay_strategy = heip::OverlayStrategy::INLINE;
+        } else if (arg == "--overlays=shared") {
+            overlay_strategy = heip::OverlayStrategy::SHARED;
+        } else if (arg == "--overlays=auto") {
+            overlay_strategy = heip::OverlayStrategy::AUTO;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            optimization_level = arg[2] - '0';
+        } else if (arg.compare(0, 14, "--profile-out=") == 0) {
+            profile_out = arg.substr(14);
+        } else if (arg.compare(0, 13, "--profile-in=") == 0) {
+            profile_in = arg.substr(13);
+        } else if (arg == "--object") {
+            object_output = true;
+        } else if (arg.compare(0, 7, "--jobs=") == 0) {
+            jobs = static_cast<unsigned>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else if (arg.compare(0, 10, "--out-dir=") == 0) {
+            out_dir = arg.substr(10);
+        } else if (arg == "--from-snapshot") {
+            from_snapshot = true;
+        } else if (arg.compare(0, 10, "--metrics=") == 0) {
+            metrics_file = arg.substr(10);
+        } else if (arg == "--once") {
+            top_once = true;
+        } else if (arg.compare(0, 11, "--delegate=") == 0) {
+            size_t start = 11;
+            while (start <= arg.size()) {
+                size_t comma = std::min(arg.find(',', start), arg.size());
+                if (comma > start) delegated_franchises.push_back(arg.substr(start, comma - start));
+                start = comma + 1;
+            }
+        } else if (arg.compare(0, 10, "--workers=") == 0) {
+            worker_count = std::strtoul(arg.c_str() + 10, nullptr, 10);
+        } else if (arg.compare(0, 7, "--memo=") == 0) {
+            memo_capacity = std::strtoul(arg.c_str() + 7, nullptr, 10);
         }
     }
     
+    if (command == "compile" && argc >= 4 && std::string(argv[2]) == "--batch") {
+        std::vector<heip::BatchJob> batch;
+        std::string error;
+        const char* extension = object_output ? ".hobj" : ".hbc";
+        if (!heip::BatchCompiler::read_manifest(argv[3], out_dir, extension, batch, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        
+        // One profile, read once and shared by every worker
+        std::shared_ptr<heip::ExecutionProfile> profile;
+        if (!profile_in.empty()) {
+            profile = std::make_shared<heip::ExecutionProfile>();
+            if (!profile->load(profile_in)) {
+                std::cerr << "Warning: could not read profile " << profile_in
+                          << ", compiling without it\n";
+                profile.reset();
+            }
+        }
+        
+        heip::BatchOptions options{help_enabled, overlay_strategy, optimization_level,
+                                   profile, jobs, object_output};
+        heip::BatchCompiler compiler(options);
+        std::cout << "Batch compiling " << batch.size() << " sources...\n\n";
+        heip::BatchStats stats = compiler.run(batch);
+        
+        for (size_t i = 0; i < batch.size(); i++) {
+            const auto& result = compiler.results()[i];
+            if (!result.succeeded) {
+                std::cerr << "✗ " << batch[i].input << ": " << result.error << "\n";
+            }
+        }
+        
+        double seconds = stats.elapsed_us / 1e6;
+        std::cout << "\n" << (stats.failed == 0 ? "✓" : "✗") << " Batch compiled "
+                  << stats.succeeded << "/" << stats.files << " sources\n\n";
+        std::cout << "Threads:            " << stats.threads << "\n";
+        std::cout << "Wall time:          " << stats.elapsed_us << " µs\n";
+        std::cout << "Source bytes:       " << stats.source_bytes << "\n";
+        std::cout << "Image bytes:        " << stats.image_bytes << "\n";
+        if (seconds > 0) {
+            std::cout << "Throughput:         " << stats.files / seconds << " files/s, "
+                      << stats.source_bytes / seconds / 1e6 << " MB/s\n";
+        }
+        return stats.failed == 0 ? 0 : 1;
+    }
+    
     if (command == "compile") {
   if (argc < 4) {
             std::cerr << "Error: compile requires input and output files\n";
@@ -111,6 +234,13 @@ return 0;
         
         heip::DodecaCompiler compiler;
         compiler.enable_learning(help_enabled);
+        compiler.set_overlay_strategy(overlay_strategy);
+        compiler.set_optimization_level(optimization_level);
+        compiler.set_object_output(object_output);
+        if (!profile_in.empty() && !compiler.load_profile(profile_in)) {
+            std::cerr << "Warning: could not read profile " << profile_in
+                      << ", compiling without it\n";
+        }
         
         if (compiler.compile(input_file, output_file)) {
      std::cout << "\n✓ Compilation successful!\n\n";
@@ -123,12 +253,32 @@ return 0;
     std::cout << "Compression ratio:  " << compiler.get_compression_ratio() << "x\n";
        std::cout << "Code reduction:     " << 
  (1.0f - 1.0f / compiler.get_compression_ratio()) * 100.0f << "%\n";
+                std::cout << "Overlays inlined:   " << compiler.get_overlays_inlined() << "\n";
+                std::cout << "Overlays shared:    " << compiler.get_overlays_shared() << "\n";
+                std::cout << "Protocols inlined:  " << compiler.get_protocols_inlined() << "\n";
+                
+                const auto& opt = compiler.get_optimizer_stats();
+                std::cout << "\nOptimizer Statistics (-O" << optimization_level << "):\n";
+                std::cout << "Constants folded:   " << opt.constants_folded << "\n";
+                std::cout << "Copies propagated:  " << opt.copies_propagated << "\n";
+                std::cout << "Expressions reused: " << opt.expressions_reused << "\n";
+                std::cout << "Instructions removed: " << opt.instructions_removed << "\n";
+                if (!profile_in.empty()) {
+                    std::cout << "Hot calls inlined:  " << opt.hot_calls_inlined << "\n";
+                    std::cout << "Cold blocks moved:  " << opt.cold_blocks_moved << "\n";
+                    std::cout << "Superinstructions:  " << opt.superinstructions << "\n";
+                }
+                std::cout << "Cold units:         " << opt.cold_units << "\n";
+                std::cout << "Tail calls:         " << opt.tail_calls << "\n";
+                std::cout << "Operands compacted: " << opt.operands_compacted << "\n";
+                std::cout << "Pure units:         " << opt.pure_units << "\n";
            
             auto& help_ctx = compiler.get_help_context();
                 std::cout << "\nHELP Statistics:\n";
               std::cout << "Compilations:       " << help_ctx.compilation_count << "\n";
                 std::cout << "Learning rate:   " << help_ctx.learning_rate << "\n";
        std::cout << "Adaptations:        " << help_ctx.adaptation_history.size() << "\n";
+                std::cout << "Stage retries:      " << compiler.get_stage_retries() << "\n";
             }
    
          return 0;
@@ -137,6 +287,78 @@ return 0;
           return 1;
  }
     }
+    else if (command == "link") {
+        if (argc < 4) {
+            std::cerr << "Error: link requires an output and at least one object\n";
+            std::cerr << "Usage: heip link <output> <main.hobj> [more.hobj...]\n";
+            return 1;
+        }
+        
+        std::string output_file = argv[2];
+        try {
+            heip::ObjectLinker linker;
+            for (int i = 3; i < argc; i++) {
+                if (argv[i][0] == '-') continue;
+                std::ifstream file(argv[i], std::ios::binary);
+                if (!file.is_open()) {
+                    std::cerr << "Error: Could not open object " << argv[i] << "\n";
+                    return 1;
+                }
+                std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                          std::istreambuf_iterator<char>());
+                linker.add(data, argv[i]);
+            }
+            
+            std::vector<uint8_t> image = linker.link();
+            std::ofstream output(output_file, std::ios::binary);
+            if (!output.is_open()) {
+                std::cerr << "Error: Could not open output file " << output_file << "\n";
+                return 1;
+            }
+            output.write(reinterpret_cast<const char*>(image.data()), image.size());
+            std::cout << "✓ Linked " << linker.object_count() << " objects → " << output_file
+                      << " (" << image.size() << " bytes)\n";
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Link error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+    else if (command == "snapshot") {
+        if (argc < 4) {
+            std::cerr << "Error: snapshot requires an image and an output file\n";
+            std::cerr << "Usage: heip snapshot <image> <output.snap>\n";
+            return 1;
+        }
+        
+        std::string image_file = argv[2];
+        std::string output_file = argv[3];
+        
+        heip::FrameRuntime runtime;
+        runtime.enable_self_healing(healing_enabled);
+        runtime.set_snapshot_stop(true);
+        if (!runtime.load_file(image_file)) {
+            std::cerr << "Error: Failed to load image " << image_file << "\n";
+            return 1;
+        }
+        
+        int result = runtime.execute();
+        if (result != 0) {
+            std::cerr << "\n✗ Execution failed with code: " << result << "\n";
+            return result;
+        }
+        if (!runtime.snapshot_reached()) {
+            std::cerr << "Error: " << image_file << " finished without reaching HELP Snapshot\n";
+            return 1;
+        }
+        if (!runtime.save_snapshot(output_file)) {
+            std::cerr << "Error: Could not write snapshot " << output_file << "\n";
+            return 1;
+        }
+        std::cout << "✓ Snapshot after " << runtime.get_instruction_count() << " instructions → "
+                  << output_file << "\n";
+        return 0;
+    }
     else if (command == "run") {
         if (argc < 3) {
             std::cerr << "Error: run requires bytecode file\n";
@@ -149,22 +371,60 @@ return 0;
         std::cout << "Loading bytecode: " << bytecode_file << "\n";
         std::cout << "Frame Interpreter Runtime initializing...\n\n";
     
-     // Read bytecode file
+        heip::FrameRuntime runtime;
+        runtime.enable_self_healing(healing_enabled);
+        runtime.enable_profiling(!profile_out.empty());
+        runtime.set_memo_capacity(memo_capacity);
+        if (!metrics_file.empty()) {
+            std::string error;
+            if (!runtime.export_metrics(metrics_file, error)) {
+                std::cerr << "Warning: " << error << "; metrics not exported\n";
+            }
+        }
+        
+        // Images load lazily, a unit at a time; raw bytecode is read whole
         std::ifstream file(bytecode_file, std::ios::binary);
         if (!file.is_open()) {
     std::cerr << "Error: Could not open bytecode file\n";
  return 1;
       }
-      
-        std::vector<uint8_t> bytecode(
-            (std::istreambuf_iterator<char>(file)),
-     std::istreambuf_iterator<char>()
-        );
- 
-        heip::FrameRuntime runtime;
-        runtime.enable_self_healing(healing_enabled);
+        std::vector<uint8_t> magic(4);
+        bool is_image = file.read(reinterpret_cast<char*>(magic.data()), 4) &&
+                        heip::BytecodeImage::is_image(magic);
+        bool loaded;
+        if (from_snapshot) {
+            file.close();
+            loaded = runtime.load_snapshot(bytecode_file);
+        } else if (is_image && !delegated_franchises.empty()) {
+            // Workers are forked from a fully loaded program
+            file.close();
+            std::string error;
+            std::shared_ptr<const heip::Program> program =
+                heip::Program::load_file(bytecode_file, error);
+            loaded = program != nullptr;
+            if (loaded) {
+                runtime.load_program(program);
+                auto workers = heip::FranchiseWorkers::start(program, delegated_franchises,
+                                                             worker_count, error);
+                if (!workers) std::cerr << "Warning: " << error << "; franchises run in process\n";
+                runtime.set_franchise_workers(workers);
+            } else {
+                std::cerr << "Error: " << error << "\n";
+            }
+        } else if (is_image) {
+            file.close();
+            loaded = runtime.load_file(bytecode_file);
+        } else {
+            file.clear();
+            file.seekg(0);
+            std::vector<uint8_t> bytecode(
+                (std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>()
+            );
+            loaded = runtime.load_bytecode(bytecode);
+        }
         
-        if (!runtime.load_bytecode(bytecode)) {
+        if (!loaded) {
     std::cerr << "Error: Failed to load bytecode\n";
   return 1;
   }
@@ -173,6 +433,16 @@ return 0;
    
         int result = runtime.execute();
         
+        // Runs accumulate into an existing profile
+        if (!profile_out.empty()) {
+            heip::ExecutionProfile profile;
+            profile.load(profile_out);
+            runtime.collect_profile(profile);
+            if (!profile.save(profile_out)) {
+                std::cerr << "Warning: could not write profile " << profile_out << "\n";
+            }
+        }
+        
       if (result == 0) {
   std::cout << "\n✓ Execution completed successfully\n\n";
             
@@ -182,6 +452,49 @@ return 0;
   std::cout << "Instructions executed: " << runtime.get_instruction_count() << "\n";
   std::cout << "Execution time:        " << runtime.get_execution_time_us() << " µs\n";
         std::cout << "Uptime:      " << runtime.get_uptime_percentage() << "%\n";
+                std::cout << "Code resident:         " << runtime.get_resident_code_bytes()
+                          << " of " << runtime.get_code_bytes() << " bytes ("
+                          << runtime.get_resident_units() << "/" << runtime.get_unit_count()
+                          << " units)\n";
+                std::cout << "Stack-verified units:  " << runtime.get_verified_units() << " of "
+                          << runtime.get_resident_units() << " resident\n";
+                if (const heip::FranchiseWorkers* workers = runtime.get_franchise_workers()) {
+                    std::cout << "Delegated calls:       " << workers->calls() << " to "
+                              << workers->size() << " worker(s), "
+                              << workers->delegated_units() << " units ("
+                              << workers->crashes() << " worker crashes, "
+                              << (workers->shared_memory() ? "shared memory" : "socket")
+                              << ")\n";
+                }
+                const heip::MemoTable& memo = runtime.get_memo();
+                uint64_t memo_calls = memo.hits() + memo.misses();
+                std::cout << "Memo hits:             " << memo.hits() << " of " << memo_calls
+                          << " pure calls ("
+                          << (memo_calls ? memo.hits() * 100 / memo_calls : 0) << "%)\n";
+                std::cout << "Memo entries:          " << memo.size() << " of " << memo.capacity()
+                          << " (" << memo.bytes() << " bytes, " << memo.evictions()
+                          << " evicted)\n";
+
+                const auto& gc = runtime.get_gc_stats();
+                std::cout << "\nGC Statistics:\n";
+                std::cout << "Minor collections:     " << gc.minor_collections << "\n";
+                std::cout << "Major collections:     " << gc.major_collections << "\n";
+                std::cout << "Total GC pause:        " << gc.total_pause_us << " µs\n";
+                std::cout << "Max GC pause:          " << gc.max_pause_us << " µs\n";
+                std::cout << "Bytes allocated:       " << gc.bytes_allocated << "\n";
+                std::cout << "Bytes promoted:        " << gc.bytes_promoted << "\n";
+                std::cout << "Bytes reclaimed:       " << gc.bytes_reclaimed << "\n";
+                std::cout << "Heap in use:           " << runtime.get_heap_used_bytes() << " bytes\n";
+                std::cout << "Vector kernels:        " << runtime.get_vector_isa() << "\n";
+                
+                const auto& ic = runtime.get_resolver_stats();
+                std::cout << "\nResolution Caches:\n";
+                std::cout << "Monomorphic hits:      " << ic.monomorphic_hits << "\n";
+                std::cout << "Polymorphic hits:      " << ic.polymorphic_hits << "\n";
+                std::cout << "Misses:                " << ic.misses << "\n";
+                std::cout << "Megamorphic lookups:   " << ic.megamorphic_lookups << "\n";
+                std::cout << "Invalidations:         " << ic.invalidations << "\n";
+                std::cout << "Superlative rankings:  " << ic.rankings << "\n";
             }
         } else {
             std::cerr << "\n✗ Execution failed with code: " << result << "\n";
@@ -189,6 +502,47 @@ return 0;
         
       return result;
     }
+    else if (command == "top") {
+        if (argc < 3) {
+            std::cerr << "Error: top requires a metrics file\n";
+            std::cerr << "Usage: heip top <metrics-file> [--once]\n";
+            return 1;
+        }
+        
+        heip::MetricsSegment segment;
+        std::string error;
+        if (!segment.open(argv[2], error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        const heip::RuntimeMetrics& metrics = *segment.get();
+        auto instructions = [&metrics]() {
+            return metrics.instructions.load(std::memory_order_relaxed);
+        };
+        
+        // One sample rates the whole run so far; refreshes rate the interval
+        uint64_t started = metrics.started_us.load(std::memory_order_relaxed);
+        uint64_t updated = metrics.updated_us.load(std::memory_order_relaxed);
+        double rate = updated > started ? instructions() * 1e6 / (updated - started) : 0.0;
+        if (top_once) {
+            std::cout << heip::format_prometheus(metrics, rate);
+            return 0;
+        }
+        
+        // Until the runtime finishes a run
+        for (;;) {
+            std::cout << "\033[H\033[2J" << heip::format_prometheus(metrics, rate) << std::flush;
+            if (metrics.runs.load(std::memory_order_relaxed) > 0 &&
+                !metrics.running.load(std::memory_order_relaxed)) {
+                return 0;
+            }
+            uint64_t last_instructions = instructions();
+            uint64_t last_us = heip::wall_clock_us();
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            uint64_t elapsed = heip::wall_clock_us() - last_us;
+            rate = elapsed ? (instructions() - last_instructions) * 1e6 / elapsed : 0.0;
+        }
+    }
     else {
         std::cerr << "Unknown command: " << command << "\n";
   print_usage();
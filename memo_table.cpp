@@ -0,0 +1,81 @@
+#include "memo_table.h"
+
+namespace heip {
+
+size_t MemoTable::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = key.entry * 0x9E3779B97F4A7C15ULL;
+    for (uint64_t arg : key.args) {
+        hash ^= arg + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+MemoTable::MemoTable(size_t capacity)
+    : capacity_(capacity)
+    , probe_{0, {}}
+    , bytes_(0)
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0) {
+}
+
+const std::vector<Value>* MemoTable::find(uint32_t entry, const Value* args, size_t arg_count) {
+    probe_.entry = entry;
+    probe_.args.clear();
+    for (size_t i = 0; i < arg_count; i++) probe_.args.push_back(args[i].bits());
+
+    auto found = entries_.find(probe_);
+    if (found == entries_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    recent_.splice(recent_.begin(), recent_, found->second.recent);
+    return &found->second.results;
+}
+
+void MemoTable::insert(uint32_t entry, const Value* args, size_t arg_count,
+                       const Value* results, size_t result_count) {
+    if (capacity_ == 0) return;
+    Key key{entry, std::vector<uint64_t>(arg_count)};
+    for (size_t i = 0; i < arg_count; i++) key.args[i] = args[i].bits();
+
+    // A recursive call with the same arguments may have finished first
+    auto placed = entries_.emplace(std::move(key), Entry());
+    if (!placed.second) return;
+    Entry& added = placed.first->second;
+    added.results.assign(results, results + result_count);
+    recent_.push_front(&placed.first->first);   // Element addresses survive rehashing
+    added.recent = recent_.begin();
+    bytes_ += entry_bytes(placed.first->first, added);
+
+    while (entries_.size() > capacity_) evict_oldest();
+}
+
+void MemoTable::set_capacity(size_t capacity) {
+    capacity_ = capacity;
+    while (entries_.size() > capacity_) evict_oldest();
+}
+
+void MemoTable::clear() {
+    entries_.clear();
+    recent_.clear();
+    bytes_ = 0;
+}
+
+size_t MemoTable::entry_bytes(const Key& key, const Entry& entry) {
+    // Hash node (key, entry, next pointer, cached hash), list node, arrays
+    return sizeof(Key) + sizeof(Entry) + 2 * sizeof(void*) +
+           sizeof(const Key*) + 2 * sizeof(void*) +
+           key.args.capacity() * sizeof(uint64_t) + entry.results.capacity() * sizeof(Value);
+}
+
+void MemoTable::evict_oldest() {
+    auto oldest = entries_.find(*recent_.back());
+    bytes_ -= entry_bytes(oldest->first, oldest->second);
+    recent_.pop_back();
+    entries_.erase(oldest);
+    evictions_++;
+}
+
+} // namespace heip
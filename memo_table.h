@@ -0,0 +1,67 @@
+#pragma once
+#include "../core/heip_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace heip {
+
+// Results of pure units (Program::verify_unit) by unit entry and argument
+// bits. Bounded: past the capacity the least recently used entry goes. One
+// table per runtime. Entries hold no heap references, so they stay valid
+// across collections and across the runs of a reused runtime.
+class MemoTable {
+public:
+    static const size_t kDefaultCapacity = 4096;
+
+    explicit MemoTable(size_t capacity = kDefaultCapacity);
+
+    // The results recorded for this call, or nullptr. A hit becomes the
+    // most recently used entry.
+    const std::vector<Value>* find(uint32_t entry, const Value* args, size_t arg_count);
+    void insert(uint32_t entry, const Value* args, size_t arg_count,
+                const Value* results, size_t result_count);
+
+    // 0 turns memoization off; shrinking evicts down to the new bound
+    void set_capacity(size_t capacity);
+    void clear();
+
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }      // Estimate, node overhead included
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t evictions() const { return evictions_; }
+
+private:
+    struct Key {
+        uint32_t entry;
+        std::vector<uint64_t> args;
+        bool operator==(const Key& other) const {
+            return entry == other.entry && args == other.args;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    struct Entry {
+        std::vector<Value> results;
+        std::list<const Key*>::iterator recent;   // Its place in recent_
+    };
+
+    size_t capacity_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    std::list<const Key*> recent_;                // Most recently used first
+    Key probe_;                                   // Lookup key, reused
+    size_t bytes_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+
+    static size_t entry_bytes(const Key& key, const Entry& entry);
+    void evict_oldest();
+};
+
+} // namespace heip
@@ -0,0 +1,239 @@
+#include "object_linker.h"
+#include "opcode_table.h"
+#include "purity_analysis.h"
+#include "stack_verifier.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace heip {
+
+namespace {
+
+// Import waiting for every object's exports
+struct PendingImport {
+    uint32_t offset;           // CALL operand in the linked code
+    std::string unit;          // Calling unit's qualified name
+    std::string name;
+    const std::string* object;
+};
+
+// Looks a Guide target up the way the compiler does: the caller's
+// franchise outward to the top level, then a unique unqualified name
+bool resolve_import(const std::unordered_map<std::string, uint32_t>& exports,
+                    const PendingImport& import, uint32_t& offset) {
+    size_t dot = import.unit.rfind('.');
+    std::string prefix = dot == std::string::npos ? std::string() : import.unit.substr(0, dot);
+    while (true) {
+        auto found = exports.find(prefix.empty() ? import.name : prefix + "." + import.name);
+        if (found != exports.end()) {
+            offset = found->second;
+            return true;
+        }
+        if (prefix.empty()) break;
+        dot = prefix.rfind('.');
+        prefix = dot == std::string::npos ? std::string() : prefix.substr(0, dot);
+    }
+
+    std::string suffix = "." + import.name;
+    bool resolved = false;
+    for (const auto& entry : exports) {
+        const std::string& qualified = entry.first;
+        if (qualified.size() > suffix.size() &&
+            qualified.compare(qualified.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            if (resolved) {
+                throw std::runtime_error(*import.object + ": ambiguous protocol " + import.name);
+            }
+            offset = entry.second;
+            resolved = true;
+        }
+    }
+    return resolved;
+}
+
+} // namespace
+
+void ObjectLinker::add(const std::vector<uint8_t>& data, const std::string& name) {
+    Object object;
+    object.name = name;
+    if (!BytecodeImage::deserialize(data, object.image)) {
+        throw std::runtime_error(name + ": not a valid image");
+    }
+    if (!(object.image.flags & BytecodeImage::kObjectFlag)) {
+        throw std::runtime_error(name + ": not an object; compile it with --object");
+    }
+    objects_.push_back(std::move(object));
+}
+
+std::vector<uint8_t> ObjectLinker::link() const {
+    if (objects_.empty()) throw std::runtime_error("No objects to link");
+
+    BytecodeImage out;
+    std::unordered_map<std::string, uint32_t> exports;   // Qualified name -> offset
+    std::unordered_map<std::string, uint32_t> sources;
+    std::unordered_map<std::string, uint32_t> strings;
+    std::vector<PendingImport> imports;
+    bool have_entry = false;
+    uint32_t symbol_base = 0;
+    uint32_t site_base = 0;
+
+    for (size_t k = 0; k < objects_.size(); k++) {
+        const std::string& object_name = objects_[k].name;
+        const BytecodeImage& image = objects_[k].image;
+
+        // Units keep their order; only the first object's entry survives
+        std::vector<int64_t> unit_index;
+        std::vector<uint32_t> deltas;
+        std::unordered_map<uint32_t, uint32_t> unit_offsets;   // Old -> new
+        uint32_t symbol_span = 0;
+        uint32_t site_span = 0;
+        for (const auto& unit : image.units) {
+            if (unit.kind == UnitKind::MAIN && k > 0) {
+                unit_index.push_back(-1);
+                deltas.push_back(0);
+                continue;
+            }
+            uint32_t base = static_cast<uint32_t>(out.code.size());
+            unit_index.push_back(static_cast<int64_t>(out.units.size()));
+            deltas.push_back(base - unit.offset);
+            unit_offsets[unit.offset] = base;
+
+            ImageUnit placed = unit;
+            placed.offset = base;
+            if (unit.symbol != kInvalidSymbol) {
+                placed.symbol = unit.symbol + symbol_base;
+                symbol_span = std::max(symbol_span, unit.symbol + 1);
+            }
+            if (unit.kind == UnitKind::MAIN) {
+                out.entry = base;
+                have_entry = true;
+            } else if (unit.kind == UnitKind::PROTOCOL &&
+                       !exports.insert(std::make_pair(unit.name, base)).second) {
+                throw std::runtime_error(object_name + ": duplicate protocol " + unit.name);
+            }
+            out.units.push_back(placed);
+            out.code.insert(out.code.end(), image.code.begin() + unit.offset,
+                            image.code.begin() + unit.offset + unit.size);
+        }
+
+        // String constants are shared by content across objects
+        std::vector<uint32_t> string_ids;
+        for (const auto& string : image.strings) {
+            auto entry = strings.insert(std::make_pair(
+                string, static_cast<uint32_t>(out.strings.size())));
+            if (entry.second) out.strings.push_back(string);
+            string_ids.push_back(entry.first->second);
+        }
+
+        // Superlatives choose between this object's own protocols
+        uint32_t superlative_base = static_cast<uint32_t>(out.superlatives.size());
+        for (const auto& superlative : image.superlatives) {
+            ImageSuperlative placed{superlative.name, {}};
+            for (uint32_t unit : superlative.candidates) {
+                placed.candidates.push_back(static_cast<uint32_t>(unit_index[unit]));
+            }
+            out.superlatives.push_back(placed);
+        }
+
+        // Rebase branches, redirect calls within the object and give
+        // overlay sites, symbols and Superlatives this object's range
+        std::unordered_set<uint32_t> import_operands;
+        for (const auto& import : image.imports) import_operands.insert(import.offset);
+        for (size_t u = 0; u < image.units.size(); u++) {
+            if (unit_index[u] < 0) continue;
+            const ImageUnit& unit = out.units[static_cast<size_t>(unit_index[u])];
+            size_t end = unit.offset + unit.size;
+            DecodedInstruction inst;
+            for (size_t pc = unit.offset; pc < end; pc += inst.length) {
+                if (!decode_instruction(out.code.data(), end, pc, inst)) {
+                    throw std::runtime_error(object_name + ": malformed code in " + unit.name);
+                }
+                if (is_branch(inst.opcode)) {
+                    write_u32(&out.code[pc + 1], inst.operands[0] + deltas[u]);
+                } else if (is_call(inst.opcode) &&
+                           !import_operands.count(static_cast<uint32_t>(pc + 1 - deltas[u]))) {
+                    auto callee = unit_offsets.find(inst.operands[0]);
+                    if (callee == unit_offsets.end()) {
+                        throw std::runtime_error(object_name + ": call into a dropped unit from " +
+                                                 unit.name);
+                    }
+                    write_u32(&out.code[pc + 1], callee->second);
+                } else if (inst.opcode == HEIPOpcode::OVERLAY_EXPAND) {
+                    write_u32(&out.code[pc + 1], inst.operands[0] + site_base);
+                    write_u32(&out.code[pc + 5], inst.operands[1] + symbol_base);
+                    site_span = std::max(site_span, inst.operands[0] + 1);
+                    symbol_span = std::max(symbol_span, inst.operands[1] + 1);
+                } else if (inst.opcode == HEIPOpcode::SUPERLATIVE) {
+                    if (inst.operands[1] >= image.superlatives.size()) {
+                        throw std::runtime_error(object_name + ": bad Superlative in " + unit.name);
+                    }
+                    write_u32(&out.code[pc + 1], inst.operands[0] + site_base);
+                    write_u32(&out.code[pc + 5], inst.operands[1] + superlative_base);
+                    site_span = std::max(site_span, inst.operands[0] + 1);
+                } else if (inst.opcode == HEIPOpcode::LOAD_STR) {
+                    if (inst.operands[0] >= string_ids.size()) {
+                        throw std::runtime_error(object_name + ": bad string constant in " +
+                                                 unit.name);
+                    }
+                    write_u32(&out.code[pc + 1], string_ids[inst.operands[0]]);
+                }
+            }
+        }
+
+        // Sites and imports move with their unit
+        auto unit_at = [&image](uint32_t offset) {
+            size_t u = 0;
+            while (u < image.units.size() &&
+                   (offset < image.units[u].offset ||
+                    offset >= image.units[u].offset + image.units[u].size)) {
+                u++;
+            }
+            return u;
+        };
+        for (const auto& site : image.sites) {
+            size_t u = unit_at(site.offset);
+            if (u == image.units.size() || unit_index[u] < 0) continue;
+            const std::string& source = image.sources[site.source];
+            auto entry = sources.insert(std::make_pair(
+                source, static_cast<uint32_t>(out.sources.size())));
+            if (entry.second) out.sources.push_back(source);
+            out.sites.push_back(ImageSite{site.kind, site.offset + deltas[u],
+                                          entry.first->second, site.line});
+        }
+        for (const auto& import : image.imports) {
+            size_t u = import.unit;
+            if (unit_index[u] < 0) continue;
+            imports.push_back(PendingImport{import.offset + deltas[u], image.units[u].name,
+                                            import.name, &object_name});
+        }
+
+        for (const auto& alias : image.aliases) {
+            if (unit_index[alias.unit] < 0) continue;
+            out.aliases.push_back(ImageAlias{alias.symbol + symbol_base,
+                                             static_cast<uint32_t>(unit_index[alias.unit])});
+            symbol_span = std::max(symbol_span, alias.symbol + 1);
+        }
+
+        symbol_base += symbol_span;
+        site_base += site_span;
+    }
+
+    if (!have_entry) throw std::runtime_error(objects_[0].name + ": no entry unit");
+
+    for (const auto& import : imports) {
+        uint32_t offset;
+        if (!resolve_import(exports, import, offset)) {
+            throw std::runtime_error(*import.object + ": unresolved protocol " + import.name);
+        }
+        write_u32(&out.code[import.offset], offset);
+    }
+
+    // Objects' site ranges skip the sites of dropped entry units
+    out.cache_sites = number_cache_sites(out.code);
+    compute_stack_effects(out);
+    compute_purity(out);
+    return out.serialize();
+}
+
+} // namespace heip
@@ -0,0 +1,39 @@
+#pragma once
+#include "bytecode_image.h"
+#include <string>
+#include <vector>
+
+namespace heip {
+
+// `heip link`: combines objects written by `heip compile --object` into
+// one executable image. Every object's protocols are exported under their
+// qualified names ("Franchise.protocol"); each import is resolved like a
+// Guide target, from the calling unit's franchise outward and then by a
+// unique unqualified name, and its CALL operand receives the callee's
+// offset. The first object supplies the entry unit; the top-level code of
+// the others is dropped. Overlays stay private to their object, so symbols
+// and OVERLAY_EXPAND sites are renumbered per object, as are Superlatives,
+// which choose between their own object's protocols. String constants are
+// merged by content and LOAD_STR operands renumbered to match.
+class ObjectLinker {
+public:
+    // `name` labels the object in errors. Throws std::runtime_error for
+    // anything that is not an object image.
+    void add(const std::vector<uint8_t>& data, const std::string& name);
+
+    // Throws std::runtime_error on unresolved, ambiguous or duplicate
+    // protocols
+    std::vector<uint8_t> link() const;
+
+    size_t object_count() const { return objects_.size(); }
+
+private:
+    struct Object {
+        std::string name;
+        BytecodeImage image;
+    };
+
+    std::vector<Object> objects_;
+};
+
+} // namespace heip
@@ -0,0 +1,265 @@
+#include "opcode_table.h"
+#include <unordered_map>
+
+namespace heip {
+
+namespace {
+
+struct OpcodeTable {
+    OpcodeInfo entries[256];
+    bool valid[256];
+
+    void set(HEIPOpcode opcode, const char* name, OperandLayout layout,
+             int8_t pops, int8_t pushes) {
+        uint8_t index = static_cast<uint8_t>(opcode);
+        entries[index] = OpcodeInfo{name, layout, pops, pushes};
+        valid[index] = true;
+    }
+
+    OpcodeTable() : entries(), valid() {
+        set(HEIPOpcode::NOP, "NOP", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::LOAD, "LOAD", OperandLayout::U32, 0, 1);
+        set(HEIPOpcode::LOAD_F64, "LOAD_F64", OperandLayout::U32_U32, 0, 1);
+        set(HEIPOpcode::LOAD_STR, "LOAD_STR", OperandLayout::U32, 0, 1);
+        set(HEIPOpcode::STORE, "STORE", OperandLayout::U32, 1, 0);
+        set(HEIPOpcode::ADD, "ADD", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::SUB, "SUB", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::MUL, "MUL", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::DIV, "DIV", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CALL, "CALL", OperandLayout::U32, -1, -1);
+        set(HEIPOpcode::RET, "RET", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::JMP, "JMP", OperandLayout::U32, 0, 0);
+        set(HEIPOpcode::JZ, "JZ", OperandLayout::U32, 1, 0);
+        set(HEIPOpcode::JNZ, "JNZ", OperandLayout::U32, 1, 0);
+        set(HEIPOpcode::CMP, "CMP", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::PUSH, "PUSH", OperandLayout::NONE, 1, 1);
+        set(HEIPOpcode::POP, "POP", OperandLayout::NONE, 1, 0);
+        set(HEIPOpcode::ALLOC, "ALLOC", OperandLayout::U8_U32, 0, 1);
+        set(HEIPOpcode::FREE, "FREE", OperandLayout::NONE, 1, 0);
+        set(HEIPOpcode::CMP_EQ, "CMP_EQ", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CMP_NE, "CMP_NE", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CMP_LT, "CMP_LT", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CMP_LE, "CMP_LE", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CMP_GT, "CMP_GT", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CMP_GE, "CMP_GE", OperandLayout::NONE, 2, 1);
+
+        set(HEIPOpcode::HELP_LEARN, "HELP_LEARN", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::HELP_ADAPT, "HELP_ADAPT", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::HELP_HEAL, "HELP_HEAL", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::HELP_RECOMMEND, "HELP_RECOMMEND", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::HELP_SNAPSHOT, "HELP_SNAPSHOT", OperandLayout::NONE, 0, 0);
+
+        set(HEIPOpcode::FRAME_CREATE, "FRAME_CREATE", OperandLayout::U32, 0, 0);
+        set(HEIPOpcode::FRAME_ENTER, "FRAME_ENTER", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::FRAME_EXIT, "FRAME_EXIT", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::STATE_SAVE, "STATE_SAVE", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::STATE_RESTORE, "STATE_RESTORE", OperandLayout::NONE, -1, -1);
+        set(HEIPOpcode::SLOT_LOAD, "SLOT_LOAD", OperandLayout::U32, 0, 1);
+        set(HEIPOpcode::SLOT_STORE, "SLOT_STORE", OperandLayout::U32, 1, 0);
+        set(HEIPOpcode::INLINE_ENTER, "INLINE_ENTER", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::INLINE_EXIT, "INLINE_EXIT", OperandLayout::NONE, 0, 0);
+        set(HEIPOpcode::TAILCALL, "TAILCALL", OperandLayout::U32, -1, -1);
+
+        set(HEIPOpcode::OVERLAY_EXPAND, "OVERLAY_EXPAND", OperandLayout::U32_U32, -1, -1);
+        set(HEIPOpcode::SYMBOL_RESOLVE, "SYMBOL_RESOLVE", OperandLayout::U32, 1, 1);
+        set(HEIPOpcode::SUPERLATIVE, "SUPERLATIVE", OperandLayout::U32_U32, -1, -1);
+
+        set(HEIPOpcode::ELEM_LOAD, "ELEM_LOAD", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::ELEM_STORE, "ELEM_STORE", OperandLayout::NONE, 3, 0);
+        set(HEIPOpcode::ELEM_COUNT, "ELEM_COUNT", OperandLayout::NONE, 1, 1);
+        set(HEIPOpcode::BUBBLE_PUSH, "BUBBLE_PUSH", OperandLayout::NONE, 2, 0);
+        set(HEIPOpcode::CHAIN_NEW, "CHAIN_NEW", OperandLayout::U32, -1, 1);
+        set(HEIPOpcode::CHAIN_APPEND, "CHAIN_APPEND", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::CHAIN_SET, "CHAIN_SET", OperandLayout::NONE, 3, 1);
+        set(HEIPOpcode::CHAIN_SLICE, "CHAIN_SLICE", OperandLayout::NONE, 3, 1);
+
+        set(HEIPOpcode::VADD, "VADD", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::VSUB, "VSUB", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::VMUL, "VMUL", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::VSUM, "VSUM", OperandLayout::NONE, 1, 1);
+        set(HEIPOpcode::VMIN, "VMIN", OperandLayout::NONE, 1, 1);
+        set(HEIPOpcode::VMAX, "VMAX", OperandLayout::NONE, 1, 1);
+        set(HEIPOpcode::VCMPEQ, "VCMPEQ", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::VCMPLT, "VCMPLT", OperandLayout::NONE, 2, 1);
+        set(HEIPOpcode::VCMPGT, "VCMPGT", OperandLayout::NONE, 2, 1);
+
+        set(HEIPOpcode::ADD_IMM, "ADD_IMM", OperandLayout::U32, 1, 1);
+        set(HEIPOpcode::SUB_IMM, "SUB_IMM", OperandLayout::U32, 1, 1);
+        set(HEIPOpcode::SLOT_LOAD2, "SLOT_LOAD2", OperandLayout::U32_U32, 0, 2);
+        set(HEIPOpcode::SLOT_TEE, "SLOT_TEE", OperandLayout::U32, 1, 1);
+        set(HEIPOpcode::JEQ, "JEQ", OperandLayout::U32, 2, 0);
+        set(HEIPOpcode::JNE, "JNE", OperandLayout::U32, 2, 0);
+        set(HEIPOpcode::JLT, "JLT", OperandLayout::U32, 2, 0);
+        set(HEIPOpcode::JLE, "JLE", OperandLayout::U32, 2, 0);
+        set(HEIPOpcode::JGT, "JGT", OperandLayout::U32, 2, 0);
+        set(HEIPOpcode::JGE, "JGE", OperandLayout::U32, 2, 0);
+
+        set(HEIPOpcode::LOAD_I8, "LOAD_I8", OperandLayout::I8, 0, 1);
+        set(HEIPOpcode::SLOT_LOAD_U8, "SLOT_LOAD_U8", OperandLayout::U8, 0, 1);
+        set(HEIPOpcode::SLOT_STORE_U8, "SLOT_STORE_U8", OperandLayout::U8, 1, 0);
+        set(HEIPOpcode::SLOT_TEE_U8, "SLOT_TEE_U8", OperandLayout::U8, 1, 1);
+        set(HEIPOpcode::SLOT_LOAD2_U8, "SLOT_LOAD2_U8", OperandLayout::U8_U8, 0, 2);
+        set(HEIPOpcode::ADD_I8, "ADD_I8", OperandLayout::I8, 1, 1);
+        set(HEIPOpcode::SUB_I8, "SUB_I8", OperandLayout::I8, 1, 1);
+    }
+};
+
+const OpcodeTable& table() {
+    static const OpcodeTable instance;
+    return instance;
+}
+
+} // namespace
+
+const OpcodeInfo* opcode_info(uint8_t opcode) {
+    const OpcodeTable& t = table();
+    return t.valid[opcode] ? &t.entries[opcode] : nullptr;
+}
+
+void shift_branch_targets(std::vector<uint8_t>& code, size_t begin, size_t end, uint32_t delta) {
+    DecodedInstruction inst;
+    for (size_t pc = begin; pc < end; pc += inst.length) {
+        if (!decode_instruction(code.data(), end, pc, inst)) return;
+        if (is_branch(inst.opcode)) write_u32(&code[pc + 1], inst.operands[0] + delta);
+    }
+}
+
+uint32_t number_cache_sites(std::vector<uint8_t>& code) {
+    std::unordered_map<uint32_t, uint32_t> dense;
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code.size(); pc += inst.length) {
+        if (!decode_instruction(code.data(), code.size(), pc, inst)) break;
+        if (!uses_cache_site(inst.opcode)) continue;
+        auto site = dense.insert(std::make_pair(inst.operands[0],
+                                                static_cast<uint32_t>(dense.size())));
+        write_u32(&code[pc + 1], site.first->second);
+    }
+    return static_cast<uint32_t>(dense.size());
+}
+
+// 4-byte forms and their compact counterparts
+const struct {
+    HEIPOpcode wide;
+    HEIPOpcode compact;
+} kCompactForms[] = {
+    {HEIPOpcode::LOAD, HEIPOpcode::LOAD_I8},
+    {HEIPOpcode::SLOT_LOAD, HEIPOpcode::SLOT_LOAD_U8},
+    {HEIPOpcode::SLOT_STORE, HEIPOpcode::SLOT_STORE_U8},
+    {HEIPOpcode::SLOT_TEE, HEIPOpcode::SLOT_TEE_U8},
+    {HEIPOpcode::SLOT_LOAD2, HEIPOpcode::SLOT_LOAD2_U8},
+    {HEIPOpcode::ADD_IMM, HEIPOpcode::ADD_I8},
+    {HEIPOpcode::SUB_IMM, HEIPOpcode::SUB_I8},
+};
+
+bool compact_form(HEIPOpcode opcode, HEIPOpcode& compact) {
+    for (const auto& form : kCompactForms) {
+        if (form.wide == opcode) {
+            compact = form.compact;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool compact_fits(HEIPOpcode compact, const DecodedInstruction& inst) {
+    bool immediate = opcode_info(static_cast<uint8_t>(compact))->layout == OperandLayout::I8;
+    for (uint8_t i = 0; i < inst.operand_count; i++) {
+        int32_t value = static_cast<int32_t>(inst.operands[i]);
+        if (immediate ? value < -128 || value > 127 : inst.operands[i] > 0xFF) return false;
+    }
+    return true;
+}
+
+HEIPOpcode wide_form(HEIPOpcode opcode) {
+    for (const auto& form : kCompactForms) {
+        if (form.compact == opcode) return form.wide;
+    }
+    return opcode;
+}
+
+bool split_superinstruction(HEIPOpcode opcode, HEIPOpcode& first, HEIPOpcode& second) {
+    switch (opcode) {
+        case HEIPOpcode::ADD_IMM: first = HEIPOpcode::LOAD; second = HEIPOpcode::ADD; return true;
+        case HEIPOpcode::SUB_IMM: first = HEIPOpcode::LOAD; second = HEIPOpcode::SUB; return true;
+        case HEIPOpcode::SLOT_LOAD2: first = second = HEIPOpcode::SLOT_LOAD; return true;
+        case HEIPOpcode::SLOT_TEE:
+            first = HEIPOpcode::SLOT_STORE;
+            second = HEIPOpcode::SLOT_LOAD;
+            return true;
+        default:
+            break;
+    }
+    if (!is_compare_branch(opcode)) return false;
+    // JEQ..JGE and CMP_EQ..CMP_GE are in the same order
+    first = static_cast<HEIPOpcode>(static_cast<uint8_t>(HEIPOpcode::CMP_EQ) +
+                                    static_cast<uint8_t>(opcode) -
+                                    static_cast<uint8_t>(HEIPOpcode::JEQ));
+    second = HEIPOpcode::JNZ;
+    return true;
+}
+
+uint32_t operand_offset(OperandLayout layout, uint8_t index) {
+    switch (layout) {
+        case OperandLayout::U8_U32: return index == 0 ? 1 : 2;
+        case OperandLayout::U32_U32: return 1 + 4 * index;
+        case OperandLayout::U8_U8: return 1 + index;
+        default: return 1;
+    }
+}
+
+bool decode_instruction(const uint8_t* code, size_t size, size_t pc, DecodedInstruction& out) {
+    if (pc >= size) return false;
+    const OpcodeInfo* info = opcode_info(code[pc]);
+    if (!info) return false;
+
+    out.opcode = static_cast<HEIPOpcode>(code[pc]);
+    out.operand_count = 0;
+
+    switch (info->layout) {
+        case OperandLayout::NONE:
+            out.length = 1;
+            break;
+        case OperandLayout::U32:
+            if (pc + 5 > size) return false;
+            out.operands[0] = read_u32(code + pc + 1);
+            out.operand_count = 1;
+            out.length = 5;
+            break;
+        case OperandLayout::U8_U32:
+            if (pc + 6 > size) return false;
+            out.operands[0] = code[pc + 1];
+            out.operands[1] = read_u32(code + pc + 2);
+            out.operand_count = 2;
+            out.length = 6;
+            break;
+        case OperandLayout::U32_U32:
+            if (pc + 9 > size) return false;
+            out.operands[0] = read_u32(code + pc + 1);
+            out.operands[1] = read_u32(code + pc + 5);
+            out.operand_count = 2;
+            out.length = 9;
+            break;
+        case OperandLayout::I8:
+            if (pc + 2 > size) return false;
+            out.operands[0] = static_cast<uint32_t>(static_cast<int8_t>(code[pc + 1]));
+            out.operand_count = 1;
+            out.length = 2;
+            break;
+        case OperandLayout::U8:
+            if (pc + 2 > size) return false;
+            out.operands[0] = code[pc + 1];
+            out.operand_count = 1;
+            out.length = 2;
+            break;
+        case OperandLayout::U8_U8:
+            if (pc + 3 > size) return false;
+            out.operands[0] = code[pc + 1];
+            out.operands[1] = code[pc + 2];
+            out.operand_count = 2;
+            out.length = 3;
+            break;
+    }
+    return true;
+}
+
+} // namespace heip
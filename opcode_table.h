@@ -0,0 +1,108 @@
+#pragma once
+#include "heip_types.h"
+#include <vector>
+#include <cstddef>
+
+namespace heip {
+
+// Operand encodings following the opcode byte
+enum class OperandLayout : uint8_t {
+    NONE,       // No operands
+    U32,        // One 4-byte operand
+    U8_U32,     // 1-byte kind + 4-byte operand (ALLOC)
+    U32_U32,    // Two 4-byte operands
+    I8,         // One byte, sign-extended (compact immediates)
+    U8,         // One byte (compact slots)
+    U8_U8       // Two bytes (SLOT_LOAD2_U8)
+};
+
+// Static opcode metadata shared by the compiler, loader and verifier.
+// Stack effects of -1 mean "depends on operands or callee".
+struct OpcodeInfo {
+    const char* name;
+    OperandLayout layout;
+    int8_t pops;
+    int8_t pushes;
+};
+
+// Returns nullptr for bytes that are not opcodes
+const OpcodeInfo* opcode_info(uint8_t opcode);
+
+// One decoded instruction
+struct DecodedInstruction {
+    HEIPOpcode opcode;
+    uint32_t operands[2];
+    uint8_t operand_count;
+    uint32_t length;          // Total bytes including the opcode
+};
+
+// Decode the instruction at `pc`; false if truncated or not an opcode
+bool decode_instruction(const uint8_t* code, size_t size, size_t pc, DecodedInstruction& out);
+
+// Compare-and-branch superinstructions (JEQ..JGE)
+inline bool is_compare_branch(HEIPOpcode opcode) {
+    return opcode >= HEIPOpcode::JEQ && opcode <= HEIPOpcode::JGE;
+}
+
+// Calls carry the callee's entry offset as their only operand
+inline bool is_call(HEIPOpcode opcode) {
+    return opcode == HEIPOpcode::CALL || opcode == HEIPOpcode::TAILCALL;
+}
+
+// Calls through an inline cache: site, then overlay symbol or Superlative
+inline bool is_resolved_call(HEIPOpcode opcode) {
+    return opcode == HEIPOpcode::OVERLAY_EXPAND || opcode == HEIPOpcode::SUPERLATIVE;
+}
+
+// Inline-cached lookups carry their cache site as the first operand
+inline bool uses_cache_site(HEIPOpcode opcode) {
+    return is_resolved_call(opcode) || opcode == HEIPOpcode::SYMBOL_RESOLVE;
+}
+
+// Slot writes grow the frame to reach their operand
+inline bool stores_slot(HEIPOpcode opcode) {
+    return opcode == HEIPOpcode::SLOT_STORE || opcode == HEIPOpcode::SLOT_STORE_U8 ||
+           opcode == HEIPOpcode::SLOT_TEE || opcode == HEIPOpcode::SLOT_TEE_U8;
+}
+
+// Branches carry a code offset as their only operand
+inline bool is_branch(HEIPOpcode opcode) {
+    return opcode == HEIPOpcode::JMP || opcode == HEIPOpcode::JZ || opcode == HEIPOpcode::JNZ ||
+           is_compare_branch(opcode);
+}
+
+// The instruction pair a superinstruction stands for (compare-branches
+// as CMP_<rel>; JNZ); false for other opcodes
+bool split_superinstruction(HEIPOpcode opcode, HEIPOpcode& first, HEIPOpcode& second);
+
+// Compact operand forms. compact_form gives the 1-byte-operand opcode for
+// a 4-byte one and compact_fits whether an instruction's operands fit it;
+// wide_form maps a compact opcode back (any other opcode to itself).
+bool compact_form(HEIPOpcode opcode, HEIPOpcode& compact);
+bool compact_fits(HEIPOpcode compact, const DecodedInstruction& inst);
+HEIPOpcode wide_form(HEIPOpcode opcode);
+
+// Add `delta` to every branch target in code[begin, end)
+void shift_branch_targets(std::vector<uint8_t>& code, size_t begin, size_t end, uint32_t delta);
+
+// Renumber the cache sites in `code` 0..n-1 in code order and return n.
+// Copies of one site (an inlined body) keep sharing a cache.
+uint32_t number_cache_sites(std::vector<uint8_t>& code);
+
+// Offset of operand `index` within an instruction (for in-place patching)
+uint32_t operand_offset(OperandLayout layout, uint8_t index);
+
+// Big-endian 4-byte operand access
+inline uint32_t read_u32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void write_u32(uint8_t* p, uint32_t value) {
+    p[0] = (value >> 24) & 0xFF;
+    p[1] = (value >> 16) & 0xFF;
+    p[2] = (value >> 8) & 0xFF;
+    p[3] = value & 0xFF;
+}
+
+} // namespace heip
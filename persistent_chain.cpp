@@ -0,0 +1,251 @@
+#include "persistent_chain.h"
+
+namespace heip {
+
+HeapRef PersistentChain::make_header(uint32_t count, uint32_t start, uint32_t trie_count,
+                                     uint32_t shift, HeapRef root, HeapRef tail) {
+    HeapRef chain = heap_.allocate(ObjectKind::CHAIN, kHeaderCells);
+    heap_.set_cell(chain, kCount, count, kTagValue);
+    heap_.set_cell(chain, kStart, start, kTagValue);
+    heap_.set_cell(chain, kTrieCount, trie_count, kTagValue);
+    heap_.set_cell(chain, kShift, shift, kTagValue);
+    heap_.set_cell(chain, kRoot, root, kTagRef);
+    heap_.set_cell(chain, kTail, tail, kTagRef);
+    return chain;
+}
+
+HeapRef PersistentChain::copy_node(HeapRef node, uint32_t capacity) {
+    HeapRef copy = heap_.allocate(ObjectKind::CHAIN_NODE, capacity);
+    uint32_t n = heap_.count(node);
+    if (n > capacity) n = capacity;
+
+    for (uint32_t i = 0; i < n; i++) {
+        heap_.set_cell(copy, i, heap_.get_cell(node, i), heap_.get_tag(node, i));
+    }
+    heap_.set_count(copy, n);
+    return copy;
+}
+
+HeapRef PersistentChain::create() {
+    HeapRef root = heap_.allocate(ObjectKind::CHAIN_NODE, kWidth);
+    heap_.set_count(root, 0);
+    HeapRef tail = heap_.allocate(ObjectKind::CHAIN_NODE, 0);
+    return make_header(0, 0, 0, kBits, root, tail);
+}
+
+HeapRef PersistentChain::from_values(const uint32_t* values, const uint8_t* tags, uint32_t n) {
+    HeapRef chain = create();
+    for (uint32_t i = 0; i < n; i++) {
+        chain = trie_append(chain, values[i], tags[i]);
+    }
+    return chain;
+}
+
+uint32_t PersistentChain::count(HeapRef chain) const {
+    return heap_.get_cell(chain, kCount);
+}
+
+HeapRef PersistentChain::leaf_for(HeapRef chain, uint32_t trie_index) const {
+    if (trie_index >= tail_offset(heap_.get_cell(chain, kTrieCount))) {
+        return heap_.get_cell(chain, kTail);
+    }
+
+    HeapRef node = heap_.get_cell(chain, kRoot);
+    for (uint32_t level = heap_.get_cell(chain, kShift); level > 0; level -= kBits) {
+        node = heap_.get_cell(node, (trie_index >> level) & kMask);
+    }
+    return node;
+}
+
+bool PersistentChain::get(HeapRef chain, uint32_t index, uint32_t& value, uint8_t& tag) const {
+    if (index >= count(chain)) return false;
+
+    uint32_t trie_index = heap_.get_cell(chain, kStart) + index;
+    HeapRef leaf = leaf_for(chain, trie_index);
+    value = heap_.get_cell(leaf, trie_index & kMask);
+    tag = heap_.get_tag(leaf, trie_index & kMask);
+    return true;
+}
+
+HeapRef PersistentChain::append(HeapRef chain, uint32_t value, uint8_t tag) {
+    uint32_t n = count(chain);
+    uint32_t end = heap_.get_cell(chain, kStart) + n;
+
+    if (end == heap_.get_cell(chain, kTrieCount)) {
+        return trie_append(chain, value, tag);
+    }
+
+    // Slice view: the slot past the view is invisible, so overwrite it
+    HeapRef updated = trie_update(chain, end, value, tag);
+    heap_.set_cell(updated, kCount, n + 1, kTagValue);
+    return updated;
+}
+
+HeapRef PersistentChain::update(HeapRef chain, uint32_t index, uint32_t value, uint8_t tag) {
+    if (index >= count(chain)) return kNullRef;
+    return trie_update(chain, heap_.get_cell(chain, kStart) + index, value, tag);
+}
+
+HeapRef PersistentChain::slice(HeapRef chain, uint32_t start, uint32_t end) {
+    uint32_t n = count(chain);
+    if (end > n) end = n;
+    if (start > end) start = end;
+
+    return make_header(end - start,
+                       heap_.get_cell(chain, kStart) + start,
+                       heap_.get_cell(chain, kTrieCount),
+                       heap_.get_cell(chain, kShift),
+                       heap_.get_cell(chain, kRoot),
+                       heap_.get_cell(chain, kTail));
+}
+
+HeapRef PersistentChain::trie_append(HeapRef chain, uint32_t value, uint8_t tag) {
+    uint32_t trie_count = heap_.get_cell(chain, kTrieCount);
+    uint32_t shift = heap_.get_cell(chain, kShift);
+    HeapRef root = heap_.get_cell(chain, kRoot);
+    HeapRef tail = heap_.get_cell(chain, kTail);
+    uint32_t visible = heap_.get_cell(chain, kCount) + 1;
+    uint32_t start = heap_.get_cell(chain, kStart);
+
+    // Room in the tail - copy it one element larger
+    uint32_t tail_size = trie_count - tail_offset(trie_count);
+    if (tail_size < kWidth) {
+        HeapRef new_tail = copy_node(tail, tail_size + 1);
+        heap_.set_cell(new_tail, tail_size, value, tag);
+        heap_.set_count(new_tail, tail_size + 1);
+        return make_header(visible, start, trie_count + 1, shift, root, new_tail);
+    }
+
+    // Full tail - push it into the trie, growing a level on root overflow
+    HeapRef new_root;
+    if ((trie_count >> kBits) > (1u << shift)) {
+        new_root = heap_.allocate(ObjectKind::CHAIN_NODE, kWidth);
+        heap_.set_cell(new_root, 0, root, kTagRef);
+        heap_.set_cell(new_root, 1, new_path(shift, tail), kTagRef);
+        heap_.set_count(new_root, 2);
+        shift += kBits;
+    } else {
+        new_root = push_tail(shift, root, tail, trie_count);
+    }
+
+    HeapRef new_tail = heap_.allocate(ObjectKind::CHAIN_NODE, 1);
+    heap_.set_cell(new_tail, 0, value, tag);
+    return make_header(visible, start, trie_count + 1, shift, new_root, new_tail);
+}
+
+bool PersistentChain::valid(HeapRef chain, CheckedNodes& checked) const {
+    if (heap_.capacity(chain) < kHeaderCells) return false;
+    for (uint32_t i = kCount; i <= kShift; i++) {
+        if (heap_.get_tag(chain, i) != kTagValue) return false;
+    }
+    for (uint32_t i = kRoot; i <= kTail; i++) {
+        HeapRef node = heap_.get_cell(chain, i);
+        if (heap_.get_tag(chain, i) != kTagRef || node == kNullRef ||
+            heap_.kind(node) != ObjectKind::CHAIN_NODE) {
+            return false;
+        }
+    }
+
+    uint32_t trie_count = heap_.get_cell(chain, kTrieCount);
+    uint32_t shift = heap_.get_cell(chain, kShift);
+    uint64_t elements;
+    if (static_cast<uint64_t>(heap_.get_cell(chain, kStart)) + count(chain) > trie_count ||
+        shift < kBits || shift > 30 || shift % kBits != 0 ||
+        trie_count - tail_offset(trie_count) > heap_.capacity(heap_.get_cell(chain, kTail)) ||
+        !valid_node(heap_.get_cell(chain, kRoot), shift, elements, checked)) {
+        return false;
+    }
+    return elements == tail_offset(trie_count);
+}
+
+bool PersistentChain::valid_node(HeapRef node, uint32_t level, uint64_t& elements,
+                                 CheckedNodes& checked) const {
+    auto seen = checked.find(node);
+    if (seen != checked.end()) {
+        elements = seen->second.second;
+        return seen->second.first == level;
+    }
+
+    // Every child but the last is full, so an index below the element
+    // count always finds its path
+    uint32_t n = heap_.count(node);
+    if (heap_.kind(node) != ObjectKind::CHAIN_NODE || n > kWidth) return false;
+    elements = n;
+    if (level > 0) {
+        elements = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            HeapRef child = heap_.get_cell(node, i);
+            uint64_t below;
+            if (heap_.get_tag(node, i) != kTagRef || child == kNullRef ||
+                !valid_node(child, level - kBits, below, checked) ||
+                (i + 1 < n && below != (1ull << level))) {
+                return false;
+            }
+            elements += below;
+        }
+    }
+    checked[node] = std::make_pair(level, elements);
+    return true;
+}
+
+HeapRef PersistentChain::trie_update(HeapRef chain, uint32_t trie_index,
+                                     uint32_t value, uint8_t tag) {
+    uint32_t trie_count = heap_.get_cell(chain, kTrieCount);
+    uint32_t shift = heap_.get_cell(chain, kShift);
+    HeapRef root = heap_.get_cell(chain, kRoot);
+    HeapRef tail = heap_.get_cell(chain, kTail);
+
+    if (trie_index >= tail_offset(trie_count)) {
+        HeapRef new_tail = copy_node(tail, heap_.capacity(tail));
+        heap_.set_cell(new_tail, trie_index & kMask, value, tag);
+        tail = new_tail;
+    } else {
+        root = assoc(shift, root, trie_index, value, tag);
+    }
+
+    return make_header(heap_.get_cell(chain, kCount), heap_.get_cell(chain, kStart),
+                       trie_count, shift, root, tail);
+}
+
+HeapRef PersistentChain::push_tail(uint32_t level, HeapRef parent, HeapRef tail,
+                                   uint32_t trie_count) {
+    uint32_t sub = ((trie_count - 1) >> level) & kMask;
+    HeapRef copy = copy_node(parent, kWidth);
+
+    HeapRef inserted;
+    if (level == kBits) {
+        inserted = tail;
+    } else if (sub < heap_.count(parent)) {
+        inserted = push_tail(level - kBits, heap_.get_cell(parent, sub), tail, trie_count);
+    } else {
+        inserted = new_path(level - kBits, tail);
+    }
+
+    heap_.set_cell(copy, sub, inserted, kTagRef);
+    if (sub + 1 > heap_.count(copy)) heap_.set_count(copy, sub + 1);
+    return copy;
+}
+
+HeapRef PersistentChain::new_path(uint32_t level, HeapRef node) {
+    if (level == 0) return node;
+
+    HeapRef path = heap_.allocate(ObjectKind::CHAIN_NODE, kWidth);
+    heap_.set_cell(path, 0, new_path(level - kBits, node), kTagRef);
+    heap_.set_count(path, 1);
+    return path;
+}
+
+HeapRef PersistentChain::assoc(uint32_t level, HeapRef node, uint32_t trie_index,
+                               uint32_t value, uint8_t tag) {
+    HeapRef copy = copy_node(node, kWidth);
+    if (level == 0) {
+        heap_.set_cell(copy, trie_index & kMask, value, tag);
+    } else {
+        uint32_t sub = (trie_index >> level) & kMask;
+        HeapRef child = assoc(level - kBits, heap_.get_cell(node, sub), trie_index, value, tag);
+        heap_.set_cell(copy, sub, child, kTagRef);
+    }
+    return copy;
+}
+
+} // namespace heip
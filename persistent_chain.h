@@ -0,0 +1,71 @@
+#pragma once
+#include "gc_heap.h"
+#include <unordered_map>
+#include <utility>
+
+namespace heip {
+
+// Persistent vector backing immutable Chain values
+// A 32-way trie with a detached tail (HAMT-style indexing). Append and
+// update copy only the path to the touched leaf, so every version shares
+// structure with its predecessor and passing a Chain between protocols is
+// a single reference copy. Slices are O(1) views over the same trie.
+class PersistentChain {
+public:
+    static const uint32_t kBits = 5;
+    static const uint32_t kWidth = 1u << kBits;
+    static const uint32_t kMask = kWidth - 1;
+
+    explicit PersistentChain(GCHeap& heap) : heap_(heap) {}
+
+    // Construction
+    HeapRef create();
+    HeapRef from_values(const uint32_t* values, const uint8_t* tags, uint32_t n);
+
+    // Queries
+    uint32_t count(HeapRef chain) const;
+    bool get(HeapRef chain, uint32_t index, uint32_t& value, uint8_t& tag) const;
+
+    // New versions - the source chain is never modified
+    HeapRef append(HeapRef chain, uint32_t value, uint8_t tag);
+    HeapRef update(HeapRef chain, uint32_t index, uint32_t value, uint8_t tag);
+    HeapRef slice(HeapRef chain, uint32_t start, uint32_t end);
+
+    // Snapshot loading: true if `chain` has the trie shape the operations
+    // above index without checks. Nodes already seen are kept in
+    // `checked` (level, element count), so shared structure is walked once.
+    using CheckedNodes = std::unordered_map<HeapRef, std::pair<uint32_t, uint64_t>>;
+    bool valid(HeapRef chain, CheckedNodes& checked) const;
+
+private:
+    // Chain header cells
+    static const uint32_t kCount = 0;       // Visible elements
+    static const uint32_t kStart = 1;       // First visible trie index
+    static const uint32_t kTrieCount = 2;   // Elements stored in the trie + tail
+    static const uint32_t kShift = 3;
+    static const uint32_t kRoot = 4;
+    static const uint32_t kTail = 5;
+    static const uint32_t kHeaderCells = 6;
+
+    GCHeap& heap_;
+
+    static uint32_t tail_offset(uint32_t trie_count) {
+        return trie_count < kWidth ? 0 : ((trie_count - 1) >> kBits) << kBits;
+    }
+
+    HeapRef make_header(uint32_t count, uint32_t start, uint32_t trie_count,
+                        uint32_t shift, HeapRef root, HeapRef tail);
+    HeapRef copy_node(HeapRef node, uint32_t capacity);
+    HeapRef leaf_for(HeapRef chain, uint32_t trie_index) const;
+    bool valid_node(HeapRef node, uint32_t level, uint64_t& elements,
+                    CheckedNodes& checked) const;
+
+    HeapRef trie_append(HeapRef chain, uint32_t value, uint8_t tag);
+    HeapRef trie_update(HeapRef chain, uint32_t trie_index, uint32_t value, uint8_t tag);
+    HeapRef push_tail(uint32_t level, HeapRef parent, HeapRef tail, uint32_t trie_count);
+    HeapRef new_path(uint32_t level, HeapRef node);
+    HeapRef assoc(uint32_t level, HeapRef node, uint32_t trie_index,
+                  uint32_t value, uint8_t tag);
+};
+
+} // namespace heip
@@ -0,0 +1,207 @@
+#include "program.h"
+#include "gc_heap.h"
+#include "../core/opcode_table.h"
+#include "../core/purity_analysis.h"
+#include "../core/stack_verifier.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace heip {
+
+std::shared_ptr<Program> Program::load(const std::vector<uint8_t>& data, std::string& error) {
+    auto program = std::make_shared<Program>();
+    if (!BytecodeImage::is_image(data)) {
+        // Raw bytecode: a single body starting at offset 0
+        program->code.assign(data.begin(), data.end());
+        program->resident_bytes = program->code.size();
+        return program;
+    }
+
+    BytecodeImage image;
+    if (!BytecodeImage::deserialize(data, image)) {
+        error = "Malformed image rejected";
+        return nullptr;
+    }
+    program->code.assign(image.code.begin(), image.code.end());
+    if (!program->install(image, true, error)) return nullptr;
+    return program;
+}
+
+std::shared_ptr<Program> Program::load_file(const std::string& path, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "Could not open " + path;
+        return nullptr;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    return load(data, error);
+}
+
+std::shared_ptr<Program> Program::from_tables(BytecodeImage& image, uint32_t code_size,
+                                              std::string& error) {
+    // Sized but not filled: units are read in as they are first called
+    auto program = std::make_shared<Program>();
+    program->code.resize(code_size);
+    if (!program->install(image, false, error)) return nullptr;
+    return program;
+}
+
+bool Program::install(BytecodeImage& image, bool resident, std::string& error) {
+    if (image.flags & BytecodeImage::kObjectFlag) {
+        error = "Object image rejected; run `heip link` first";
+        return false;
+    }
+    entry = image.entry;
+    cache_sites = image.cache_sites;
+
+    for (const auto& unit : image.units) {
+        units.push_back(ProgramUnit{unit.offset, unit.size, unit.slot_count, resident,
+                                    unit.has_stack_effect, unit.stack_effect, false,
+                                    unit.pure, false});
+    }
+    std::sort(units.begin(), units.end(),
+              [](const ProgramUnit& a, const ProgramUnit& b) { return a.offset < b.offset; });
+    if (!find_unit(entry)) {
+        error = "Image entry rejected: not the start of a unit";
+        return false;
+    }
+    resident_bytes = resident ? code.size() : 0;
+    resident_units = resident ? units.size() : 0;
+
+    // Overlay symbols first so explicit bindings override them
+    auto bind = [this](DodecaSymbol symbol, const std::string& name, uint32_t offset,
+                       bool overlay) {
+        bindings.push_back(ProgramBinding{symbol, name, offset, overlay});
+        if (symbol >= symbol_entries.size()) symbol_entries.resize(symbol + 1, UINT32_MAX);
+        symbol_entries[symbol] = offset;
+    };
+    for (const auto& unit : image.units) {
+        unit_names[unit.offset] = unit.name;
+        if (unit.symbol != kInvalidSymbol) bind(unit.symbol, unit.name, unit.offset, true);
+    }
+    for (const auto& alias : image.aliases) {
+        const ImageUnit& unit = image.units[alias.unit];
+        bind(alias.symbol, unit.name, unit.offset, unit.kind == UnitKind::OVERLAY);
+    }
+
+    for (const auto& superlative : image.superlatives) {
+        superlatives.push_back(ProgramSuperlative{superlative.name, {}});
+        for (uint32_t unit : superlative.candidates) {
+            superlatives.back().entries.push_back(image.units[unit].offset);
+        }
+    }
+
+    strings.swap(image.strings);
+    sources.swap(image.sources);
+    sites.swap(image.sites);
+
+    // A fully loaded image is validated and verified up front, every unit
+    // before any is verified since verification trusts its callees'
+    // claims; a lazy one goes unit by unit (make_resident)
+    if (resident) {
+        for (const auto& unit : units) {
+            if (!validate_unit(unit)) {
+                error = "Malformed unit rejected: " + unit_names[unit.offset];
+                return false;
+            }
+        }
+        for (auto& unit : units) verify_unit(unit);
+    }
+    return true;
+}
+
+const ProgramUnit* Program::find_unit(uint32_t entry) const {
+    auto unit = std::lower_bound(units.begin(), units.end(), entry,
+                                 [](const ProgramUnit& u, uint32_t offset) {
+                                     return u.offset < offset;
+                                 });
+    return unit != units.end() && unit->offset == entry ? &*unit : nullptr;
+}
+
+ProgramUnit* Program::find_unit(uint32_t entry) {
+    return const_cast<ProgramUnit*>(static_cast<const Program*>(this)->find_unit(entry));
+}
+
+bool Program::make_resident(ProgramUnit& unit) {
+    if (!validate_unit(unit)) return false;
+    unit.resident = true;
+    verify_unit(unit);
+    resident_bytes += unit.size;
+    resident_units++;
+    return true;
+}
+
+bool Program::validate_unit(const ProgramUnit& unit) const {
+    // Branches stay inside the unit, calls enter units, and the last
+    // instruction never falls through into code that may not be loaded
+    size_t end = static_cast<size_t>(unit.offset) + unit.size;
+    HEIPOpcode last = HEIPOpcode::NOP;
+    DecodedInstruction inst;
+    for (size_t pc = unit.offset; pc < end; pc += inst.length) {
+        if (!decode_instruction(code.data(), end, pc, inst)) return false;
+        if (is_branch(inst.opcode) &&
+            (inst.operands[0] < unit.offset || inst.operands[0] >= end)) {
+            return false;
+        }
+        if (is_call(inst.opcode) && !find_unit(inst.operands[0])) return false;
+        if (inst.opcode == HEIPOpcode::LOAD_STR && inst.operands[0] >= strings.size()) return false;
+        if (inst.opcode == HEIPOpcode::ALLOC && inst.operands[1] > GCHeap::kMaxCapacity) return false;
+        if (uses_cache_site(inst.opcode) && inst.operands[0] >= cache_sites) return false;
+        if (inst.opcode == HEIPOpcode::SUPERLATIVE && inst.operands[1] >= superlatives.size()) {
+            return false;
+        }
+        if (inst.opcode == HEIPOpcode::FRAME_CREATE && inst.operands[0] > unit.slot_count) {
+            return false;
+        }
+        if (stores_slot(inst.opcode) && inst.operands[0] >= unit.slot_count) return false;
+        last = inst.opcode;
+    }
+    return last == HEIPOpcode::FRAME_EXIT || last == HEIPOpcode::RET ||
+           last == HEIPOpcode::JMP;
+}
+
+void Program::verify_unit(ProgramUnit& unit) {
+    // Callees are taken at the image's word, which is only relied on once
+    // the callee has been verified itself (FrameRuntime::call_unit). A
+    // Superlative's candidates must all claim the same effect.
+    auto callee = [this](HEIPOpcode opcode, uint32_t operand, StackEffect& effect) {
+        if (opcode == HEIPOpcode::SUPERLATIVE) {
+            if (operand >= superlatives.size()) return false;
+            const std::vector<uint32_t>& entries = superlatives[operand].entries;
+            for (size_t i = 0; i < entries.size(); i++) {
+                const ProgramUnit* target = find_unit(entries[i]);
+                if (!target || !target->stack_claimed || (i > 0 && !(target->stack == effect))) {
+                    return false;
+                }
+                effect = target->stack;
+            }
+            return !entries.empty();
+        }
+        if (opcode == HEIPOpcode::OVERLAY_EXPAND) {
+            if (operand >= symbol_entries.size()) return false;
+            operand = symbol_entries[operand];
+        }
+        const ProgramUnit* target = find_unit(operand);
+        if (!target || !target->stack_claimed) return false;
+        effect = target->stack;
+        return true;
+    };
+    StackEffect effect;
+    unit.stack_verified = unit.stack_claimed &&
+                          verify_stack_effect(code.data(), unit.offset, unit.size,
+                                              callee, effect) &&
+                          effect == unit.stack;
+    
+    // Callees' purity is taken at the image's word too; the runtime stops
+    // memoizing a call that reaches a unit that did not verify pure
+    auto pure_callee = [this](uint32_t entry) {
+        const ProgramUnit* target = find_unit(entry);
+        return target && target->pure_claimed;
+    };
+    unit.pure_verified = unit.pure_claimed && unit.stack_verified &&
+                         verify_purity(code.data(), unit.offset, unit.size, pure_callee);
+}
+
+} // namespace heip
@@ -0,0 +1,102 @@
+#pragma once
+#include "../core/heip_types.h"
+#include "../core/bytecode_image.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace heip {
+
+// Leaves bytes uninitialized on resize, so pages of a lazily loaded code
+// section that no unit was read into are never touched
+template <typename T>
+struct UninitializedAllocator : std::allocator<T> {
+    template <typename U> struct rebind { typedef UninitializedAllocator<U> other; };
+    UninitializedAllocator() = default;
+    template <typename U> UninitializedAllocator(const UninitializedAllocator<U>&) {}
+    template <typename U> void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args> void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+// A unit of a loaded program, by code offset
+struct ProgramUnit {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t slot_count;       // Bounds FRAME_CREATE and slot stores
+    bool resident;             // Its code is in Program::code
+    bool stack_claimed;        // The image records a stack effect...
+    StackEffect stack;
+    bool stack_verified;       // ...and the resident code was proven to match it
+    bool pure_claimed;         // Likewise for purity; pure_verified also
+    bool pure_verified;        // needs stack_verified
+};
+
+// Symbol binding, registered with each runtime's resolver in this order
+struct ProgramBinding {
+    DodecaSymbol symbol;
+    std::string name;
+    uint32_t entry;
+    bool overlay;              // Else a franchise protocol
+};
+
+// Superlative, registered with each runtime's resolver under its index
+struct ProgramSuperlative {
+    std::string name;
+    std::vector<uint32_t> entries;       // Candidate protocols
+};
+
+// The loaded, execution-independent part of an image: code, unit table,
+// names, bindings and constants. A Program made by load() has every unit
+// resident, validated and stack-verified (an image with any unit that
+// fails validation is rejected), and is not modified again, so
+// one `shared_ptr<const Program>` can back any number of FrameRuntimes on
+// any number of threads (FrameRuntime::load_program). A runtime that opens
+// an image lazily keeps a private Program and makes units resident as
+// they are called.
+struct Program {
+    std::vector<uint8_t, UninitializedAllocator<uint8_t>> code;
+    uint32_t entry;
+    std::vector<ProgramUnit> units;                      // Sorted by offset
+    std::unordered_map<uint32_t, std::string> unit_names;  // Entry -> name
+    std::vector<ProgramBinding> bindings;
+    std::vector<uint32_t> symbol_entries;                // Symbol -> entry at load
+    std::vector<std::string> strings;                    // LOAD_STR constants
+    std::vector<std::string> sources;                    // Profile site names
+    std::vector<ImageSite> sites;
+    uint32_t cache_sites;                                // Bound of cache site operands
+    std::vector<ProgramSuperlative> superlatives;        // By SUPERLATIVE operand
+    size_t resident_bytes;
+    size_t resident_units;
+
+    Program() : entry(0), cache_sites(0), resident_bytes(0), resident_units(0) {}
+
+    // Raw bytecode (one body at offset 0) or a whole executable image in
+    // memory. nullptr with `error` set for malformed images and objects.
+    static std::shared_ptr<Program> load(const std::vector<uint8_t>& data, std::string& error);
+    static std::shared_ptr<Program> load_file(const std::string& path, std::string& error);
+
+    // From an image's tables alone: the code section is sized to
+    // `code_size` but left empty for make_resident to fill unit by unit
+    static std::shared_ptr<Program> from_tables(BytecodeImage& image, uint32_t code_size,
+                                                std::string& error);
+
+    const ProgramUnit* find_unit(uint32_t entry) const;
+    ProgramUnit* find_unit(uint32_t entry);
+    bool complete() const { return resident_units == units.size(); }
+
+    // Once a unit's bytes are in `code`: validates it (branches stay
+    // inside, calls enter units, slots fit the frame, nothing falls off
+    // the end) and verifies
+    // its stack effect and purity. False leaves it non-resident.
+    bool make_resident(ProgramUnit& unit);
+
+private:
+    bool install(BytecodeImage& image, bool resident, std::string& error);
+    bool validate_unit(const ProgramUnit& unit) const;
+    void verify_unit(ProgramUnit& unit);
+};
+
+} // namespace heip
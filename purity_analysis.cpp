@@ -0,0 +1,77 @@
+#include "purity_analysis.h"
+#include "opcode_table.h"
+#include <unordered_map>
+#include <vector>
+
+namespace heip {
+
+namespace {
+
+// Opcodes that read and write only the operand stack and the frame
+bool pure_opcode(HEIPOpcode opcode) {
+    switch (opcode) {
+        case HEIPOpcode::NOP: case HEIPOpcode::LOAD: case HEIPOpcode::LOAD_I8:
+        case HEIPOpcode::LOAD_F64: case HEIPOpcode::LOAD_STR:
+        case HEIPOpcode::ADD: case HEIPOpcode::SUB: case HEIPOpcode::MUL: case HEIPOpcode::DIV:
+        case HEIPOpcode::ADD_IMM: case HEIPOpcode::SUB_IMM:
+        case HEIPOpcode::ADD_I8: case HEIPOpcode::SUB_I8:
+        case HEIPOpcode::CMP: case HEIPOpcode::CMP_EQ: case HEIPOpcode::CMP_NE:
+        case HEIPOpcode::CMP_LT: case HEIPOpcode::CMP_LE:
+        case HEIPOpcode::CMP_GT: case HEIPOpcode::CMP_GE:
+        case HEIPOpcode::JMP: case HEIPOpcode::JZ: case HEIPOpcode::JNZ:
+        case HEIPOpcode::PUSH: case HEIPOpcode::POP:
+        case HEIPOpcode::SLOT_LOAD: case HEIPOpcode::SLOT_STORE:
+        case HEIPOpcode::SLOT_LOAD2: case HEIPOpcode::SLOT_TEE:
+        case HEIPOpcode::SLOT_LOAD_U8: case HEIPOpcode::SLOT_STORE_U8:
+        case HEIPOpcode::SLOT_LOAD2_U8: case HEIPOpcode::SLOT_TEE_U8:
+        case HEIPOpcode::FRAME_CREATE: case HEIPOpcode::FRAME_EXIT: case HEIPOpcode::RET:
+        case HEIPOpcode::INLINE_ENTER: case HEIPOpcode::INLINE_EXIT:
+            return true;
+        default:
+            return is_compare_branch(opcode);
+    }
+}
+
+} // namespace
+
+bool verify_purity(const uint8_t* code, size_t offset, size_t size, const CalleePurity& callee) {
+    size_t end = offset + size;
+    DecodedInstruction inst;
+    for (size_t pc = offset; pc < end; pc += inst.length) {
+        if (!decode_instruction(code, end, pc, inst)) return false;
+        if (is_call(inst.opcode) ? !callee(inst.operands[0]) : !pure_opcode(inst.opcode)) {
+            return false;
+        }
+    }
+    return size > 0;
+}
+
+void compute_purity(BytecodeImage& image) {
+    std::unordered_map<uint32_t, size_t> by_offset;
+    for (size_t u = 0; u < image.units.size(); u++) {
+        image.units[u].pure = false;
+        by_offset[image.units[u].offset] = u;
+    }
+
+    // Recursive units have no stack effect, so cycles never qualify
+    enum State : uint8_t { PENDING, VISITING, DONE };
+    std::vector<State> state(image.units.size(), PENDING);
+    std::function<bool(size_t)> resolve = [&](size_t u) {
+        if (state[u] == VISITING) return false;
+        if (state[u] == DONE) return image.units[u].pure;
+        state[u] = VISITING;
+
+        auto callee = [&](uint32_t entry) {
+            auto found = by_offset.find(entry);
+            return found != by_offset.end() && resolve(found->second);
+        };
+        ImageUnit& unit = image.units[u];
+        unit.pure = unit.kind != UnitKind::MAIN && unit.has_stack_effect &&
+                    verify_purity(image.code.data(), unit.offset, unit.size, callee);
+        state[u] = DONE;
+        return unit.pure;
+    };
+    for (size_t u = 0; u < image.units.size(); u++) resolve(u);
+}
+
+} // namespace heip
@@ -0,0 +1,24 @@
+#pragma once
+#include "bytecode_image.h"
+#include <functional>
+#include <cstdint>
+
+namespace heip {
+
+// Whether the unit entered at a CALL/TAILCALL operand is pure; false when
+// it is not known
+typedef std::function<bool(uint32_t entry)> CalleePurity;
+
+// A unit is pure when its results depend only on the values it pops: it
+// touches nothing but its own frame slots and the operand stack (no
+// memory, heap, containers, overlay resolution or HELP events), and every
+// unit it calls is pure. It may still fault; a call that faults has no
+// result to reuse. Checks code[offset, offset + size).
+bool verify_purity(const uint8_t* code, size_t offset, size_t size, const CalleePurity& callee);
+
+// Marks the pure units of a linked image. Only units with a stack effect
+// qualify, since a result is keyed by the arguments that effect counts,
+// and the entry unit never does. Run after compute_stack_effects.
+void compute_purity(BytecodeImage& image);
+
+} // namespace heip
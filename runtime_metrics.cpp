@@ -0,0 +1,202 @@
+#include "runtime_metrics.h"
+#include <chrono>
+#include <new>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace heip {
+
+// Readers in other processes need the counters to be plain words
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "metrics need lock-free 64-bit atomics");
+
+namespace {
+
+uint64_t current_pid() {
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint64_t>(getpid());
+#endif
+}
+
+} // namespace
+
+uint64_t wall_clock_us() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+RuntimeMetrics::RuntimeMetrics()
+    : magic(kMagic)
+    , version(kVersion)
+    , pid(current_pid())
+    , started_us(wall_clock_us())
+    , updated_us(started_us.load(std::memory_order_relaxed))
+    , running(0)
+    , runs(0)
+    , instructions(0)
+    , frames_created(0)
+    , checkpoints(0)
+    , recoveries(0)
+    , faults(0)
+    , ledger_entries(0)
+    , memory_bytes(0)
+    , heap_bytes(0)
+    , gc_collections(0) {
+}
+
+MetricsSegment::MetricsSegment()
+    : metrics_(nullptr)
+    , mapping_(nullptr) {
+}
+
+MetricsSegment::~MetricsSegment() {
+    unmap();
+}
+
+bool MetricsSegment::create(const std::string& path, std::string& error) {
+    if (!map(path, true, error)) return false;
+    new (metrics_) RuntimeMetrics();
+    return true;
+}
+
+bool MetricsSegment::open(const std::string& path, std::string& error) {
+    if (!map(path, false, error)) return false;
+    if (metrics_->magic != RuntimeMetrics::kMagic ||
+        metrics_->version != RuntimeMetrics::kVersion) {
+        unmap();
+        error = path + " is not a metrics file";
+        return false;
+    }
+    return true;
+}
+
+#ifdef _WIN32
+
+bool MetricsSegment::map(const std::string& path, bool create, std::string& error) {
+    unmap();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              create ? CREATE_ALWAYS : OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Could not open " + path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!create && (!GetFileSizeEx(file, &size) ||
+                    size.QuadPart < static_cast<LONGLONG>(sizeof(RuntimeMetrics)))) {
+        CloseHandle(file);
+        error = path + " is not a metrics file";
+        return false;
+    }
+    // The mapping keeps the file open; sizing it extends a created file
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0,
+                                        static_cast<DWORD>(sizeof(RuntimeMetrics)), nullptr);
+    CloseHandle(file);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+                                         sizeof(RuntimeMetrics)) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        error = "Could not map " + path;
+        return false;
+    }
+    mapping_ = mapping;
+    metrics_ = static_cast<RuntimeMetrics*>(view);
+    return true;
+}
+
+void MetricsSegment::unmap() {
+    if (metrics_) UnmapViewOfFile(metrics_);
+    if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+    metrics_ = nullptr;
+    mapping_ = nullptr;
+}
+
+#else
+
+bool MetricsSegment::map(const std::string& path, bool create, std::string& error) {
+    unmap();
+    // Readers map read-write too: a 64-bit atomic load may not be a plain
+    // load on every target
+    int fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+    if (fd < 0) {
+        error = "Could not open " + path;
+        return false;
+    }
+    struct stat info;
+    bool sized = create ? ftruncate(fd, sizeof(RuntimeMetrics)) == 0 :
+                          fstat(fd, &info) == 0 &&
+                          info.st_size >= static_cast<off_t>(sizeof(RuntimeMetrics));
+    void* view = sized ? mmap(nullptr, sizeof(RuntimeMetrics), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        error = sized ? "Could not map " + path : path + " is not a metrics file";
+        return false;
+    }
+    metrics_ = static_cast<RuntimeMetrics*>(view);
+    return true;
+}
+
+void MetricsSegment::unmap() {
+    if (metrics_) munmap(metrics_, sizeof(RuntimeMetrics));
+    metrics_ = nullptr;
+}
+
+#endif
+
+std::string format_prometheus(const RuntimeMetrics& metrics, double instructions_per_second) {
+    auto value = [](const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    };
+    std::string label = "{pid=\"" + std::to_string(value(metrics.pid)) + "\"}";
+    std::ostringstream out;
+    auto emit = [&](const char* name, const char* type, const char* help, auto sample) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << type << "\n"
+            << name << label << " " << sample << "\n";
+    };
+
+    uint64_t started = value(metrics.started_us);
+    uint64_t updated = value(metrics.updated_us);
+    emit("heip_uptime_seconds", "gauge", "Seconds from runtime start to the last update.",
+         updated > started ? (updated - started) / 1e6 : 0.0);
+    emit("heip_running", "gauge", "1 while the runtime is executing.", value(metrics.running));
+    emit("heip_runs_total", "counter", "Executions started.", value(metrics.runs));
+    emit("heip_instructions_total", "counter", "Instructions executed.",
+         value(metrics.instructions));
+    emit("heip_instructions_per_second", "gauge", "Instruction rate.", instructions_per_second);
+    emit("heip_frames_created_total", "counter", "Frames created.",
+         value(metrics.frames_created));
+    emit("heip_checkpoints_total", "counter", "Frame checkpoints taken.",
+         value(metrics.checkpoints));
+    emit("heip_recoveries_total", "counter", "Successful self-healing recoveries.",
+         value(metrics.recoveries));
+    emit("heip_faults_total", "counter", "Faulting instructions and runtime exceptions.",
+         value(metrics.faults));
+    emit("heip_ledger_entries", "gauge", "Forensic ledger entries.",
+         value(metrics.ledger_entries));
+    emit("heip_memory_bytes", "gauge", "Byte-addressed memory in use.",
+         value(metrics.memory_bytes));
+    emit("heip_heap_bytes", "gauge", "Managed heap in use.", value(metrics.heap_bytes));
+    emit("heip_gc_collections_total", "counter", "Minor and major collections.",
+         value(metrics.gc_collections));
+    return out.str();
+}
+
+} // namespace heip
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace heip {
+
+// Live counters of one runtime, laid out to be mapped from a file so
+// another process (`heip top`) can read them while the program runs.
+// Only the runtime's own thread writes, with relaxed stores; a reader
+// sees every counter untorn but not a consistent snapshot of all of them.
+struct RuntimeMetrics {
+    static const uint32_t kMagic = 0x4D504948;   // "HIPM"
+    static const uint32_t kVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint64_t> pid;
+    std::atomic<uint64_t> started_us;        // Wall clock, µs since the epoch
+    std::atomic<uint64_t> updated_us;        // Last publish
+    std::atomic<uint64_t> running;           // 1 inside execute()
+    std::atomic<uint64_t> runs;
+    std::atomic<uint64_t> instructions;      // Across runs, including resets
+    std::atomic<uint64_t> frames_created;
+    std::atomic<uint64_t> checkpoints;
+    std::atomic<uint64_t> recoveries;
+    std::atomic<uint64_t> faults;
+    std::atomic<uint64_t> ledger_entries;
+    std::atomic<uint64_t> memory_bytes;      // Byte-addressed memory
+    std::atomic<uint64_t> heap_bytes;
+    std::atomic<uint64_t> gc_collections;
+
+    RuntimeMetrics();
+
+    // Single writer: a plain load and store, no locked read-modify-write
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    static void set(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(value, std::memory_order_relaxed);
+    }
+};
+
+// A metrics file mapped shared. create() truncates the file and starts a
+// fresh block in it for a runtime to publish into; open() maps an
+// existing one for reading. The file outlives the mapping, so the last
+// values stay readable after the program exits.
+class MetricsSegment {
+public:
+    MetricsSegment();
+    ~MetricsSegment();
+    MetricsSegment(const MetricsSegment&) = delete;
+    MetricsSegment& operator=(const MetricsSegment&) = delete;
+
+    bool create(const std::string& path, std::string& error);
+    bool open(const std::string& path, std::string& error);
+    RuntimeMetrics* get() const { return metrics_; }
+
+private:
+    RuntimeMetrics* metrics_;
+    void* mapping_;                          // Windows file mapping handle
+    bool map(const std::string& path, bool create, std::string& error);
+    void unmap();
+};
+
+// Prometheus text exposition of one sample; the rate is the caller's,
+// from two samples or over the run so far
+std::string format_prometheus(const RuntimeMetrics& metrics, double instructions_per_second);
+
+uint64_t wall_clock_us();
+
+} // namespace heip
@@ -0,0 +1,312 @@
+#include "frame_runtime.h"
+#include "../core/opcode_table.h"
+#include <fstream>
+#include <iterator>
+
+namespace heip {
+
+namespace {
+
+// Snapshot file: header, the image exactly as it was opened, then the
+// interpreter state. Keeping the image intact lets a resumed run read its
+// units from the snapshot the same way load_file reads them from an image.
+const uint32_t kSnapshotMagic = 0x48534E50;   // "HSNP"
+const uint16_t kSnapshotVersion = 3;
+const size_t kSnapshotHeaderSize = 12;
+const uint32_t kNoFault = 0xFFFFFFFF;
+
+void put_u8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+void put_u16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back(value & 0xFF);
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[4];
+    write_u32(bytes, value);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+    put_u32(out, static_cast<uint32_t>(value));
+}
+
+void put_string(std::vector<uint8_t>& out, const std::string& value) {
+    put_u16(out, static_cast<uint16_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+// Bounds-checked sequential reader
+struct Reader {
+    const std::vector<uint8_t>& data;
+    size_t pos;
+
+    bool u8(uint8_t& value) {
+        if (pos + 1 > data.size()) return false;
+        value = data[pos++];
+        return true;
+    }
+
+    bool u16(uint16_t& value) {
+        if (pos + 2 > data.size()) return false;
+        value = static_cast<uint16_t>((data[pos] << 8) | data[pos + 1]);
+        pos += 2;
+        return true;
+    }
+
+    bool u32(uint32_t& value) {
+        if (pos + 4 > data.size()) return false;
+        value = read_u32(data.data() + pos);
+        pos += 4;
+        return true;
+    }
+
+    bool u64(uint64_t& value) {
+        uint32_t high, low;
+        if (!u32(high) || !u32(low)) return false;
+        value = (static_cast<uint64_t>(high) << 32) | low;
+        return true;
+    }
+
+    bool string(std::string& value) {
+        uint16_t length;
+        if (!u16(length) || pos + length > data.size()) return false;
+        value.assign(data.begin() + pos, data.begin() + pos + length);
+        pos += length;
+        return true;
+    }
+
+    // Counts are checked against what is left so a corrupt one cannot
+    // drive a huge allocation
+    bool count(uint32_t& value, size_t min_entry_bytes) {
+        return u32(value) && value <= (data.size() - pos) / min_entry_bytes;
+    }
+};
+
+} // namespace
+
+bool FrameRuntime::save_snapshot(const std::string& path) {
+    if (!lazy_ || !image_file_.is_open()) {
+        log_execution_event("Snapshot needs an image opened from a file");
+        return false;
+    }
+
+    std::vector<uint8_t> out;
+    put_u32(out, kSnapshotMagic);
+    put_u16(out, kSnapshotVersion);
+    put_u16(out, 0);
+    put_u32(out, static_cast<uint32_t>(image_size_));
+
+    // The image is copied from the file so units never loaded stay intact
+    size_t image_start = out.size();
+    out.resize(image_start + static_cast<size_t>(image_size_));
+    image_file_.clear();
+    image_file_.seekg(image_base_);
+    if (!image_file_.read(reinterpret_cast<char*>(&out[image_start]), image_size_)) {
+        log_execution_event("Snapshot image read failed");
+        return false;
+    }
+
+    put_u32(out, static_cast<uint32_t>(program_counter_));
+    put_u64(out, instruction_count_);
+    put_u64(out, next_frame_id_);
+    put_u32(out, last_fault_pc_ == static_cast<size_t>(-1) ?
+                 kNoFault : static_cast<uint32_t>(last_fault_pc_));
+
+    put_u32(out, static_cast<uint32_t>(stack_.size()));
+    for (const Value& value : stack_) put_u64(out, value.bits());
+
+    put_u32(out, static_cast<uint32_t>(memory_.size()));
+    out.insert(out.end(), memory_.begin(), memory_.end());
+
+    put_u32(out, static_cast<uint32_t>(frame_stack_.size()));
+    for (const auto& frame : frame_stack_) {
+        put_string(out, frame->name);
+        put_u64(out, frame->frame_id);
+        put_u64(out, frame->timestamp);
+        put_u32(out, static_cast<uint32_t>(frame->slots.size()));
+        for (const Value& value : frame->slots) put_u64(out, value.bits());
+        put_u32(out, frame->return_pc);
+        put_u8(out, frame->can_recover ? 1 : 0);
+        put_u32(out, static_cast<uint32_t>(frame->checkpoint_state.size()));
+        out.insert(out.end(), frame->checkpoint_state.begin(), frame->checkpoint_state.end());
+        put_u8(out, frame->execution_range ? 1 : 0);
+        if (frame->execution_range) {
+            put_u32(out, frame->execution_range->start);
+            put_u32(out, frame->execution_range->end);
+        }
+    }
+
+    put_u32(out, static_cast<uint32_t>(inline_marks_.size()));
+    for (const auto& mark : inline_marks_) {
+        put_u32(out, static_cast<uint32_t>(mark.restart_pc));
+        put_u32(out, static_cast<uint32_t>(mark.stack_depth));
+        put_u32(out, static_cast<uint32_t>(mark.frame_depth));
+    }
+
+    std::vector<uint32_t> heap_words;
+    heap_.save_words(heap_words);
+    put_u32(out, static_cast<uint32_t>(heap_words.size()));
+    for (uint32_t word : heap_words) put_u32(out, word);
+
+    // Units the run has touched are read in again on resume
+    std::vector<uint32_t> resident;
+    for (const auto& unit : program_->units) {
+        if (unit.resident) resident.push_back(unit.offset);
+    }
+    put_u32(out, static_cast<uint32_t>(resident.size()));
+    for (uint32_t offset : resident) put_u32(out, offset);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open() ||
+        !file.write(reinterpret_cast<const char*>(out.data()), out.size())) {
+        return false;
+    }
+    log_execution_event("Snapshot written: " + std::to_string(out.size()) + " bytes");
+    return true;
+}
+
+bool FrameRuntime::load_snapshot(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::vector<uint8_t> header(kSnapshotHeaderSize);
+    if (!file.read(reinterpret_cast<char*>(header.data()), header.size()) ||
+        read_u32(header.data()) != kSnapshotMagic ||
+        ((header[4] << 8) | header[5]) != kSnapshotVersion) {
+        log_execution_event("Malformed snapshot rejected");
+        return false;
+    }
+    uint32_t image_size = read_u32(header.data() + 8);
+    file.seekg(static_cast<std::streamoff>(kSnapshotHeaderSize) + image_size);
+    std::vector<uint8_t> state((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+    file.close();
+
+    if (!open_image(path, static_cast<std::streamoff>(kSnapshotHeaderSize), image_size)) {
+        return false;
+    }
+
+    auto reject = [this]() {
+        log_execution_event("Malformed snapshot rejected");
+        return false;
+    };
+
+    Reader reader{state, 0};
+    uint32_t pc, last_fault, count;
+    uint64_t instructions, next_frame_id;
+    if (!reader.u32(pc) || !reader.u64(instructions) || !reader.u64(next_frame_id) ||
+        !reader.u32(last_fault) || pc > code_size_) {
+        return reject();
+    }
+
+    stack_.clear();
+    if (!reader.count(count, 8)) return reject();
+    stack_.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t bits;
+        if (!reader.u64(bits)) return reject();
+        push(Value::from_bits(bits));
+    }
+
+    if (!reader.count(count, 1) || count > kMemoryBytes) return reject();
+    memory_.assign(state.begin() + reader.pos, state.begin() + reader.pos + count);
+    reader.pos += count;
+
+    frame_stack_.clear();
+    if (!reader.count(count, 32) || count == 0) return reject();
+    for (uint32_t i = 0; i < count; i++) {
+        auto frame = std::make_shared<Frame>();
+        uint32_t slots, checkpoint_size;
+        uint8_t can_recover, has_range;
+        if (!reader.string(frame->name) || !reader.u64(frame->frame_id) ||
+            !reader.u64(frame->timestamp) || !reader.count(slots, 8)) {
+            return reject();
+        }
+        for (uint32_t s = 0; s < slots; s++) {
+            uint64_t bits;
+            if (!reader.u64(bits)) return reject();
+            frame->slots.push_back(Value::from_bits(bits));
+        }
+        if (!reader.u32(frame->return_pc) || !reader.u8(can_recover) ||
+            !reader.count(checkpoint_size, 1)) {
+            return reject();
+        }
+        frame->can_recover = can_recover != 0;
+        frame->stack_verified = false;   // Resumed frames finish checked
+        frame->checkpoint_state.assign(state.begin() + reader.pos,
+                                       state.begin() + reader.pos + checkpoint_size);
+        reader.pos += checkpoint_size;
+        if (!valid_checkpoint(frame->checkpoint_state) || !reader.u8(has_range)) return reject();
+        if (has_range) {
+            frame->execution_range = std::make_shared<Range>();
+            if (!reader.u32(frame->execution_range->start) ||
+                !reader.u32(frame->execution_range->end)) {
+                return reject();
+            }
+        }
+        frame_stack_.push_back(frame);
+    }
+    current_frame_ = frame_stack_.back();
+
+    inline_marks_.clear();
+    memo_pending_.clear();
+    cost_pending_.clear();
+    if (!reader.count(count, 12)) return reject();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t restart_pc, stack_depth, frame_depth;
+        if (!reader.u32(restart_pc) || !reader.u32(stack_depth) || !reader.u32(frame_depth)) {
+            return reject();
+        }
+        inline_marks_.push_back(InlineMark{restart_pc, stack_depth, frame_depth});
+    }
+
+    // The stack, slots and checkpoints read above are the roots the heap
+    // checks its references against
+    std::vector<uint32_t> heap_words;
+    if (!reader.count(count, 4)) return reject();
+    heap_words.resize(count);
+    for (uint32_t i = 0; i < count; i++) reader.u32(heap_words[i]);
+    PersistentChain::CheckedNodes checked;
+    auto check_chain = [this, &checked](HeapRef ref) {
+        return heap_.kind(ref) != ObjectKind::CHAIN || chains_.valid(ref, checked);
+    };
+    if (!heap_.load_words(heap_words, check_chain)) return reject();
+
+    if (!reader.count(count, 4)) return reject();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t offset;
+        if (!reader.u32(offset) || !ensure_resident(offset)) return reject();
+    }
+    if (reader.pos != state.size()) return reject();
+
+    // Execution must resume, and frames return, into code that is loaded
+    auto resident_at = [this](size_t offset) {
+        if (offset == code_size_) return true;
+        for (const auto& unit : program_->units) {
+            if (offset >= unit.offset && offset < unit.offset + unit.size) return unit.resident;
+        }
+        return false;
+    };
+    if (!resident_at(pc)) return reject();
+    for (size_t i = 0; i < frame_stack_.size(); i++) {
+        const auto& checkpoint = frame_stack_[i]->checkpoint_state;
+        if ((i > 0 && !resident_at(frame_stack_[i]->return_pc)) ||
+            (!checkpoint.empty() && !resident_at(read_u32(&checkpoint[0])))) {
+            return reject();
+        }
+    }
+
+    program_counter_ = pc;
+    instruction_count_ = instructions;
+    next_frame_id_ = next_frame_id;
+    last_fault_pc_ = last_fault == kNoFault ? static_cast<size_t>(-1) : last_fault;
+    log_execution_event("Snapshot restored: " + std::to_string(frame_stack_.size()) +
+                        " frames, " + std::to_string(program_->resident_units) + " units resident");
+    return true;
+}
+
+} // namespace heip
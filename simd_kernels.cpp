@@ -0,0 +1,327 @@
+#include "simd_kernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HEIP_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Per-function ISA targeting so the rest of the build needs no -mavx2
+#if defined(__GNUC__) || defined(__clang__)
+#define HEIP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define HEIP_TARGET(isa)
+#endif
+
+namespace heip {
+
+namespace {
+
+// Scalar fallback
+
+void add_scalar(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] + b[i];
+}
+
+void sub_scalar(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] - b[i];
+}
+
+void mul_scalar(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] * b[i];
+}
+
+uint32_t sum_scalar(const uint32_t* a, size_t n) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < n; i++) total += a[i];
+    return total;
+}
+
+uint32_t min_scalar(const uint32_t* a, size_t n) {
+    int32_t best = static_cast<int32_t>(a[0]);
+    for (size_t i = 1; i < n; i++) best = std::min(best, static_cast<int32_t>(a[i]));
+    return static_cast<uint32_t>(best);
+}
+
+uint32_t max_scalar(const uint32_t* a, size_t n) {
+    int32_t best = static_cast<int32_t>(a[0]);
+    for (size_t i = 1; i < n; i++) best = std::max(best, static_cast<int32_t>(a[i]));
+    return static_cast<uint32_t>(best);
+}
+
+void cmp_eq_scalar(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] == b[i] ? 0xFFFFFFFFu : 0u;
+}
+
+void cmp_lt_scalar(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<int32_t>(a[i]) < static_cast<int32_t>(b[i]) ? 0xFFFFFFFFu : 0u;
+    }
+}
+
+void cmp_gt_scalar(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<int32_t>(a[i]) > static_cast<int32_t>(b[i]) ? 0xFFFFFFFFu : 0u;
+    }
+}
+
+const SimdKernels kScalarKernels = {
+    "scalar",
+    add_scalar, sub_scalar, mul_scalar,
+    sum_scalar, min_scalar, max_scalar,
+    cmp_eq_scalar, cmp_lt_scalar, cmp_gt_scalar
+};
+
+#ifdef HEIP_SIMD_X86
+
+// SSE2 kernels (4 lanes)
+
+#define HEIP_SSE2_BINARY(name, op)                                              \
+HEIP_TARGET("sse2")                                                             \
+void name(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {      \
+    size_t i = 0;                                                               \
+    for (; i + 4 <= n; i += 4) {                                                \
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));  \
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));  \
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), op(va, vb));      \
+    }                                                                           \
+    name##_tail(a + i, b + i, out + i, n - i);                                  \
+}
+
+HEIP_TARGET("sse2")
+inline __m128i mullo_sse2(__m128i a, __m128i b) {
+    // SSE2 has no 32-bit low multiply; combine the even and odd products
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+HEIP_TARGET("sse2")
+inline __m128i min_sse2(__m128i a, __m128i b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+HEIP_TARGET("sse2")
+inline __m128i max_sse2(__m128i a, __m128i b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+#define add_sse2_tail add_scalar
+#define sub_sse2_tail sub_scalar
+#define mul_sse2_tail mul_scalar
+#define cmp_eq_sse2_tail cmp_eq_scalar
+#define cmp_lt_sse2_tail cmp_lt_scalar
+#define cmp_gt_sse2_tail cmp_gt_scalar
+
+HEIP_SSE2_BINARY(add_sse2, _mm_add_epi32)
+HEIP_SSE2_BINARY(sub_sse2, _mm_sub_epi32)
+HEIP_SSE2_BINARY(mul_sse2, mullo_sse2)
+HEIP_SSE2_BINARY(cmp_eq_sse2, _mm_cmpeq_epi32)
+HEIP_SSE2_BINARY(cmp_lt_sse2, _mm_cmplt_epi32)
+HEIP_SSE2_BINARY(cmp_gt_sse2, _mm_cmpgt_epi32)
+
+HEIP_TARGET("sse2")
+uint32_t sum_sse2(const uint32_t* a, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm_add_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar(a + i, n - i);
+}
+
+HEIP_TARGET("sse2")
+uint32_t min_sse2_reduce(const uint32_t* a, size_t n) {
+    if (n < 4) return min_scalar(a, n);
+    __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        acc = min_sse2(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    uint32_t best = min_scalar(lanes, 4);
+    if (i < n) {
+        uint32_t rest = min_scalar(a + i, n - i);
+        best = static_cast<int32_t>(rest) < static_cast<int32_t>(best) ? rest : best;
+    }
+    return best;
+}
+
+HEIP_TARGET("sse2")
+uint32_t max_sse2_reduce(const uint32_t* a, size_t n) {
+    if (n < 4) return max_scalar(a, n);
+    __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        acc = max_sse2(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    uint32_t best = max_scalar(lanes, 4);
+    if (i < n) {
+        uint32_t rest = max_scalar(a + i, n - i);
+        best = static_cast<int32_t>(rest) > static_cast<int32_t>(best) ? rest : best;
+    }
+    return best;
+}
+
+const SimdKernels kSse2Kernels = {
+    "sse2",
+    add_sse2, sub_sse2, mul_sse2,
+    sum_sse2, min_sse2_reduce, max_sse2_reduce,
+    cmp_eq_sse2, cmp_lt_sse2, cmp_gt_sse2
+};
+
+// AVX2 kernels (8 lanes)
+
+#define HEIP_AVX2_BINARY(name, op)                                                  \
+HEIP_TARGET("avx2")                                                                 \
+void name(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) {          \
+    size_t i = 0;                                                                   \
+    for (; i + 8 <= n; i += 8) {                                                    \
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));   \
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));   \
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), op(va, vb));       \
+    }                                                                               \
+    name##_tail(a + i, b + i, out + i, n - i);                                      \
+}
+
+HEIP_TARGET("avx2")
+inline __m256i cmplt_avx2(__m256i a, __m256i b) {
+    return _mm256_cmpgt_epi32(b, a);
+}
+
+#define add_avx2_tail add_sse2
+#define sub_avx2_tail sub_sse2
+#define mul_avx2_tail mul_sse2
+#define cmp_eq_avx2_tail cmp_eq_sse2
+#define cmp_lt_avx2_tail cmp_lt_sse2
+#define cmp_gt_avx2_tail cmp_gt_sse2
+
+HEIP_AVX2_BINARY(add_avx2, _mm256_add_epi32)
+HEIP_AVX2_BINARY(sub_avx2, _mm256_sub_epi32)
+HEIP_AVX2_BINARY(mul_avx2, _mm256_mullo_epi32)
+HEIP_AVX2_BINARY(cmp_eq_avx2, _mm256_cmpeq_epi32)
+HEIP_AVX2_BINARY(cmp_lt_avx2, cmplt_avx2)
+HEIP_AVX2_BINARY(cmp_gt_avx2, _mm256_cmpgt_epi32)
+
+HEIP_TARGET("avx2")
+uint32_t sum_avx2(const uint32_t* a, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), half);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_sse2(a + i, n - i);
+}
+
+HEIP_TARGET("avx2")
+uint32_t min_avx2(const uint32_t* a, size_t n) {
+    if (n < 8) return min_sse2_reduce(a, n);
+    __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_min_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+    }
+    uint32_t lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    uint32_t best = min_scalar(lanes, 8);
+    if (i < n) {
+        uint32_t rest = min_scalar(a + i, n - i);
+        best = static_cast<int32_t>(rest) < static_cast<int32_t>(best) ? rest : best;
+    }
+    return best;
+}
+
+HEIP_TARGET("avx2")
+uint32_t max_avx2(const uint32_t* a, size_t n) {
+    if (n < 8) return max_sse2_reduce(a, n);
+    __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+    }
+    uint32_t lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    uint32_t best = max_scalar(lanes, 8);
+    if (i < n) {
+        uint32_t rest = max_scalar(a + i, n - i);
+        best = static_cast<int32_t>(rest) > static_cast<int32_t>(best) ? rest : best;
+    }
+    return best;
+}
+
+const SimdKernels kAvx2Kernels = {
+    "avx2",
+    add_avx2, sub_avx2, mul_avx2,
+    sum_avx2, min_avx2, max_avx2,
+    cmp_eq_avx2, cmp_lt_avx2, cmp_gt_avx2
+};
+
+bool cpu_has_sse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;  // Baseline on x86-64
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX2 also needs the OS to save YMM state (OSXSAVE + XCR0 bits 1-2)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // HEIP_SIMD_X86
+
+const SimdKernels& detect_simd_kernels() {
+#ifdef HEIP_SIMD_X86
+    if (cpu_has_avx2()) return kAvx2Kernels;
+    if (cpu_has_sse2()) return kSse2Kernels;
+#endif
+    return kScalarKernels;
+}
+
+} // namespace
+
+const SimdKernels& select_simd_kernels() {
+    static const SimdKernels& kernels = detect_simd_kernels();
+    return kernels;
+}
+
+const SimdKernels& scalar_simd_kernels() {
+    return kScalarKernels;
+}
+
+} // namespace heip
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace heip {
+
+// Bulk kernels over contiguous 32-bit numeric cells
+// Arithmetic wraps like ADD/SUB/MUL; min/max and comparisons are signed.
+// Comparison kernels write an all-ones mask for true lanes, zero otherwise.
+struct SimdKernels {
+    const char* isa;
+
+    void (*add)(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n);
+    void (*sub)(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n);
+    void (*mul)(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n);
+
+    uint32_t (*sum)(const uint32_t* a, size_t n);
+    uint32_t (*min)(const uint32_t* a, size_t n);   // n > 0
+    uint32_t (*max)(const uint32_t* a, size_t n);   // n > 0
+
+    void (*cmp_eq)(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n);
+    void (*cmp_lt)(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n);
+    void (*cmp_gt)(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n);
+};
+
+// Best kernel set for the running CPU (AVX2, SSE2 or scalar),
+// detected once on first use
+const SimdKernels& select_simd_kernels();
+
+// Portable reference implementation
+const SimdKernels& scalar_simd_kernels();
+
+} // namespace heip
@@ -0,0 +1,801 @@
+#include "ssa_optimizer.h"
+#include "opcode_table.h"
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace heip {
+
+namespace {
+
+const uint32_t kNone = 0xFFFFFFFF;
+const int kMaxRounds = 4;
+
+enum class ValueKind : uint8_t { CONST, OP, PHI, OPAQUE };
+
+struct Value {
+    ValueKind kind;
+    HEIPOpcode op;                       // OP
+    uint32_t constant;                   // CONST
+    uint32_t operands[2];                // OP
+    std::vector<uint32_t> phi_operands;  // PHI
+    std::vector<uint32_t> phi_users;     // Phis that take this value as an operand
+    uint32_t forward;                    // Replacement once a phi proved trivial
+    uint32_t home;                       // First slot the value was stored to
+};
+
+struct Block {
+    uint32_t first;                      // Instruction index range [first, end)
+    uint32_t end;
+    std::vector<uint32_t> succs;
+    std::vector<uint32_t> preds;         // Reachable predecessors only
+    bool exits;                          // Leaves the body (RET, or to its end)
+    bool reachable;
+    bool sealed;
+    bool filled;
+    std::unordered_map<uint32_t, uint32_t> defs;            // Slot -> value
+    std::vector<std::pair<uint32_t, uint32_t>> incomplete;  // (slot, phi)
+};
+
+struct Node {
+    uint32_t pc;
+    DecodedInstruction inst;
+    uint32_t block;
+    std::vector<int32_t> producers;   // Instruction that pushed each popped operand, -1 unknown
+    uint32_t result;                  // SSA value pushed, kNone if none
+    int32_t consumer;                 // Instruction that pops the result, -1 if not seen
+    uint32_t holder_slot;             // Slot that may hold `result` here...
+    uint32_t holder_value;            // ...if its current value resolves to `result`
+};
+
+enum class Edit : uint8_t { KEEP, DROP, REPLACE };
+
+bool is_pure_op(HEIPOpcode op) {
+    switch (op) {
+        case HEIPOpcode::ADD: case HEIPOpcode::SUB: case HEIPOpcode::MUL:
+        case HEIPOpcode::CMP:
+        case HEIPOpcode::CMP_EQ: case HEIPOpcode::CMP_NE:
+        case HEIPOpcode::CMP_LT: case HEIPOpcode::CMP_LE:
+        case HEIPOpcode::CMP_GT: case HEIPOpcode::CMP_GE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Opcodes after which slot contents can't be predicted (checkpoints may be
+// restored by the self-healing runtime)
+bool clobbers_slots(HEIPOpcode op) {
+    return op == HEIPOpcode::HELP_HEAL || op == HEIPOpcode::STATE_SAVE ||
+           op == HEIPOpcode::STATE_RESTORE || op == HEIPOpcode::FRAME_CREATE ||
+           op == HEIPOpcode::FRAME_ENTER;
+}
+
+// Evaluate like the runtime does; false for a DIV that would fault
+bool fold(HEIPOpcode op, uint32_t a, uint32_t b, uint32_t& out) {
+    int32_t sa = static_cast<int32_t>(a);
+    int32_t sb = static_cast<int32_t>(b);
+    switch (op) {
+        case HEIPOpcode::ADD: out = a + b; return true;
+        case HEIPOpcode::SUB: out = a - b; return true;
+        case HEIPOpcode::MUL: out = a * b; return true;
+        case HEIPOpcode::DIV:
+            if (sb == 0 || (sa == INT32_MIN && sb == -1)) return false;
+            out = static_cast<uint32_t>(sa / sb);
+            return true;
+        case HEIPOpcode::CMP: out = static_cast<uint32_t>((sa > sb) - (sa < sb)); return true;
+        case HEIPOpcode::CMP_EQ: out = sa == sb; return true;
+        case HEIPOpcode::CMP_NE: out = sa != sb; return true;
+        case HEIPOpcode::CMP_LT: out = sa < sb; return true;
+        case HEIPOpcode::CMP_LE: out = sa <= sb; return true;
+        case HEIPOpcode::CMP_GT: out = sa > sb; return true;
+        case HEIPOpcode::CMP_GE: out = sa >= sb; return true;
+        default: return false;
+    }
+}
+
+class SsaBody {
+public:
+    SsaBody(const std::vector<uint8_t>& code, uint32_t slot_count, bool slots_live_at_exit)
+        : code_(code), slot_count_(slot_count), slots_live_at_exit_(slots_live_at_exit) {}
+
+    bool lower();
+    bool plan(int level, OptimizerStats& stats);
+    uint32_t apply(std::vector<uint8_t>& code, std::vector<Relocation>& relocations);
+
+private:
+    // SSA construction
+    void fill(uint32_t b);
+    void try_seal(uint32_t b);
+    void seal(uint32_t b);
+    void clobber(uint32_t b);
+    uint32_t new_value(ValueKind kind);
+    uint32_t constant(uint32_t value);
+    uint32_t make_op(HEIPOpcode op, uint32_t a, uint32_t b);
+    uint32_t find(uint32_t v);
+    void write(uint32_t slot, uint32_t b, uint32_t v);
+    uint32_t read(uint32_t slot, uint32_t b);
+    uint32_t read_recursive(uint32_t slot, uint32_t b);
+    uint32_t add_phi_operands(uint32_t slot, uint32_t phi, uint32_t b);
+    uint32_t try_remove_trivial_phi(uint32_t phi);
+
+    // Analysis and rewriting
+    bool const_of(uint32_t v, uint32_t& out);
+    bool removable(int32_t i);
+    void rewrite_tree(int32_t i, int level, OptimizerStats& stats, bool& changed);
+    void eliminate_dead_stores(bool& changed);
+    void drop_tree(int32_t i);
+    void drop_operands(int32_t i);
+    void replace(int32_t i, HEIPOpcode op, uint32_t operand);
+    HEIPOpcode effective_opcode(size_t i) const;
+    uint32_t effective_operand(size_t i) const;
+    size_t destination(size_t i) const;
+
+    const std::vector<uint8_t>& code_;
+    uint32_t slot_count_;
+    bool slots_live_at_exit_;
+    std::vector<Node> nodes_;
+    std::vector<int32_t> index_at_;       // Code offset -> instruction index, -1 mid-instruction
+    std::vector<Block> blocks_;
+    std::vector<Value> values_;
+    std::unordered_map<uint32_t, uint32_t> constants_;
+    std::map<std::tuple<uint8_t, uint32_t, uint32_t>, uint32_t> expressions_;
+
+    std::vector<int8_t> const_state_;     // 0 unknown, 1 visiting, 2 constant, 3 not
+    std::vector<uint32_t> const_value_;
+    std::vector<int8_t> removable_;       // -1 unknown
+    std::vector<Edit> edits_;
+    std::vector<HEIPOpcode> replace_op_;
+    std::vector<uint32_t> replace_operand_;
+};
+
+bool SsaBody::lower() {
+    index_at_.assign(code_.size() + 1, -1);
+    DecodedInstruction inst;
+    for (size_t pc = 0; pc < code_.size(); pc += inst.length) {
+        if (!decode_instruction(code_.data(), code_.size(), pc, inst)) return false;
+        index_at_[pc] = static_cast<int32_t>(nodes_.size());
+        Node node;
+        node.pc = static_cast<uint32_t>(pc);
+        node.inst = inst;
+        node.block = 0;
+        node.result = kNone;
+        node.consumer = -1;
+        node.holder_slot = kNone;
+        node.holder_value = kNone;
+        nodes_.push_back(node);
+        if ((inst.opcode == HEIPOpcode::SLOT_LOAD || inst.opcode == HEIPOpcode::SLOT_STORE) &&
+            inst.operands[0] >= slot_count_) {
+            slot_count_ = inst.operands[0] + 1;
+        }
+    }
+    size_t count = nodes_.size();
+    if (count == 0) return false;
+    index_at_[code_.size()] = static_cast<int32_t>(count);
+
+    // Basic blocks start at branch targets and after control transfers
+    std::vector<bool> leader(count + 1, false);
+    leader[0] = true;
+    for (size_t i = 0; i < count; i++) {
+        HEIPOpcode op = nodes_[i].inst.opcode;
+        if (is_branch(op)) {
+            uint32_t target = nodes_[i].inst.operands[0];
+            if (target > code_.size() || index_at_[target] < 0) return false;
+            leader[index_at_[target]] = true;
+            leader[i + 1] = true;
+        } else if (op == HEIPOpcode::RET || op == HEIPOpcode::FRAME_EXIT) {
+            leader[i + 1] = true;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (leader[i]) {
+            if (!blocks_.empty()) blocks_.back().end = static_cast<uint32_t>(i);
+            Block block;
+            block.first = static_cast<uint32_t>(i);
+            block.exits = false;
+            block.reachable = false;
+            block.sealed = false;
+            block.filled = false;
+            blocks_.push_back(block);
+        }
+        nodes_[i].block = static_cast<uint32_t>(blocks_.size() - 1);
+    }
+    blocks_.back().end = static_cast<uint32_t>(count);
+
+    for (auto& block : blocks_) {
+        const Node& last = nodes_[block.end - 1];
+        HEIPOpcode op = last.inst.opcode;
+        if (is_branch(op)) {
+            uint32_t target = static_cast<uint32_t>(index_at_[last.inst.operands[0]]);
+            if (target < count) block.succs.push_back(nodes_[target].block);
+            else block.exits = true;
+        }
+        bool falls_through = op != HEIPOpcode::JMP && op != HEIPOpcode::RET &&
+                             op != HEIPOpcode::FRAME_EXIT;
+        if (falls_through && block.end < count) block.succs.push_back(nodes_[block.end].block);
+        else if (op != HEIPOpcode::JMP) block.exits = true;
+    }
+
+    std::vector<uint32_t> worklist(1, 0);
+    blocks_[0].reachable = true;
+    while (!worklist.empty()) {
+        uint32_t b = worklist.back();
+        worklist.pop_back();
+        for (uint32_t succ : blocks_[b].succs) {
+            blocks_[succ].preds.push_back(b);
+            if (!blocks_[succ].reachable) {
+                blocks_[succ].reachable = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+
+    // Braun et al.: blocks are sealed once every predecessor is filled
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        if (!blocks_[b].reachable) continue;
+        try_seal(b);
+        fill(b);
+        blocks_[b].filled = true;
+        for (uint32_t succ : blocks_[b].succs) try_seal(succ);
+    }
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        if (blocks_[b].reachable && !blocks_[b].sealed) seal(b);
+    }
+    return true;
+}
+
+void SsaBody::fill(uint32_t b) {
+    // Symbolic operand stack: (value, producing instruction)
+    std::vector<std::pair<uint32_t, int32_t>> stack;
+
+    for (uint32_t i = blocks_[b].first; i < blocks_[b].end; i++) {
+        Node& node = nodes_[i];
+        HEIPOpcode op = node.inst.opcode;
+        const OpcodeInfo* info = opcode_info(static_cast<uint8_t>(op));
+
+        if (info->pops < 0 || info->pushes < 0) {
+            // Calls, expansions and restores see the whole operand stack
+            stack.clear();
+            if (clobbers_slots(op)) clobber(b);
+            continue;
+        }
+
+        std::vector<uint32_t> inputs(info->pops);
+        node.producers.assign(info->pops, -1);
+        for (int k = info->pops - 1; k >= 0; k--) {
+            if (stack.empty()) {
+                inputs[k] = new_value(ValueKind::OPAQUE);
+                continue;
+            }
+            inputs[k] = stack.back().first;
+            node.producers[k] = stack.back().second;
+            nodes_[stack.back().second].consumer = static_cast<int32_t>(i);
+            stack.pop_back();
+        }
+
+        uint32_t result = kNone;
+        switch (op) {
+            case HEIPOpcode::LOAD:
+                result = constant(node.inst.operands[0]);
+                break;
+            case HEIPOpcode::SLOT_LOAD:
+                result = read(node.inst.operands[0], b);
+                break;
+            case HEIPOpcode::SLOT_STORE:
+                write(node.inst.operands[0], b, inputs[0]);
+                break;
+            default:
+                if (is_pure_op(op) || op == HEIPOpcode::DIV) {
+                    result = make_op(op, inputs[0], inputs[1]);
+                } else if (clobbers_slots(op)) {
+                    clobber(b);
+                }
+                break;
+        }
+
+        if (result != kNone) {
+            uint32_t home = values_[find(result)].home;
+            if (home != kNone) {
+                node.holder_slot = home;
+                node.holder_value = read(home, b);
+            }
+        }
+        for (int k = 0; k < info->pushes; k++) {
+            uint32_t pushed = k == 0 && result != kNone ? result : new_value(ValueKind::OPAQUE);
+            if (k == 0) node.result = pushed;
+            stack.push_back(std::make_pair(pushed, static_cast<int32_t>(i)));
+        }
+    }
+}
+
+void SsaBody::try_seal(uint32_t b) {
+    if (blocks_[b].sealed) return;
+    for (uint32_t pred : blocks_[b].preds) {
+        if (!blocks_[pred].filled) return;
+    }
+    seal(b);
+}
+
+void SsaBody::seal(uint32_t b) {
+    std::vector<std::pair<uint32_t, uint32_t>> incomplete;
+    incomplete.swap(blocks_[b].incomplete);
+    for (const auto& entry : incomplete) {
+        add_phi_operands(entry.first, entry.second, b);
+    }
+    blocks_[b].sealed = true;
+}
+
+void SsaBody::clobber(uint32_t b) {
+    for (uint32_t slot = 0; slot < slot_count_; slot++) {
+        write(slot, b, new_value(ValueKind::OPAQUE));
+    }
+}
+
+uint32_t SsaBody::new_value(ValueKind kind) {
+    Value value;
+    value.kind = kind;
+    value.op = HEIPOpcode::NOP;
+    value.constant = 0;
+    value.operands[0] = value.operands[1] = kNone;
+    value.forward = static_cast<uint32_t>(values_.size());
+    value.home = kNone;
+    values_.push_back(value);
+    return value.forward;
+}
+
+uint32_t SsaBody::constant(uint32_t value) {
+    auto it = constants_.find(value);
+    if (it != constants_.end()) return it->second;
+    uint32_t v = new_value(ValueKind::CONST);
+    values_[v].constant = value;
+    constants_[value] = v;
+    return v;
+}
+
+uint32_t SsaBody::make_op(HEIPOpcode op, uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    bool a_const = values_[a].kind == ValueKind::CONST;
+    bool b_const = values_[b].kind == ValueKind::CONST;
+    uint32_t folded;
+    if (a_const && b_const && fold(op, values_[a].constant, values_[b].constant, folded)) {
+        return constant(folded);
+    }
+
+    // x + 0, x - 0, x * 1
+    if (b_const && values_[b].constant == 0 && (op == HEIPOpcode::ADD || op == HEIPOpcode::SUB)) {
+        return a;
+    }
+    if (a_const && values_[a].constant == 0 && op == HEIPOpcode::ADD) return b;
+    if (op == HEIPOpcode::MUL) {
+        if (b_const && values_[b].constant == 1) return a;
+        if (a_const && values_[a].constant == 1) return b;
+    }
+
+    auto key = std::make_tuple(static_cast<uint8_t>(op), a, b);
+    auto it = expressions_.find(key);
+    if (it != expressions_.end()) return find(it->second);
+    uint32_t v = new_value(ValueKind::OP);
+    values_[v].op = op;
+    values_[v].operands[0] = a;
+    values_[v].operands[1] = b;
+    expressions_[key] = v;
+    return v;
+}
+
+uint32_t SsaBody::find(uint32_t v) {
+    uint32_t root = v;
+    while (values_[root].forward != root) root = values_[root].forward;
+    while (values_[v].forward != root) {
+        uint32_t next = values_[v].forward;
+        values_[v].forward = root;
+        v = next;
+    }
+    return root;
+}
+
+void SsaBody::write(uint32_t slot, uint32_t b, uint32_t v) {
+    v = find(v);
+    if (values_[v].home == kNone && values_[v].kind != ValueKind::CONST) {
+        values_[v].home = slot;
+    }
+    blocks_[b].defs[slot] = v;
+}
+
+uint32_t SsaBody::read(uint32_t slot, uint32_t b) {
+    auto it = blocks_[b].defs.find(slot);
+    if (it != blocks_[b].defs.end()) return find(it->second);
+    return read_recursive(slot, b);
+}
+
+uint32_t SsaBody::read_recursive(uint32_t slot, uint32_t b) {
+    // The entry block has an extra, implicit predecessor: FRAME_CREATE
+    size_t incoming = blocks_[b].preds.size() + (b == 0 ? 1 : 0);
+    uint32_t v;
+    if (!blocks_[b].sealed) {
+        v = new_value(ValueKind::PHI);
+        values_[v].home = slot;
+        blocks_[b].incomplete.push_back(std::make_pair(slot, v));
+    } else if (incoming == 0) {
+        v = new_value(ValueKind::OPAQUE);
+    } else if (incoming == 1) {
+        v = b == 0 ? constant(0) : read(slot, blocks_[b].preds[0]);
+    } else {
+        v = new_value(ValueKind::PHI);
+        values_[v].home = slot;
+        write(slot, b, v);
+        v = add_phi_operands(slot, v, b);
+    }
+    write(slot, b, v);
+    return v;
+}
+
+uint32_t SsaBody::add_phi_operands(uint32_t slot, uint32_t phi, uint32_t b) {
+    if (b == 0) values_[phi].phi_operands.push_back(constant(0));
+    for (size_t p = 0; p < blocks_[b].preds.size(); p++) {
+        uint32_t operand = read(slot, blocks_[b].preds[p]);
+        values_[phi].phi_operands.push_back(operand);
+        if (values_[operand].kind == ValueKind::PHI) values_[operand].phi_users.push_back(phi);
+    }
+    return try_remove_trivial_phi(phi);
+}
+
+uint32_t SsaBody::try_remove_trivial_phi(uint32_t phi) {
+    uint32_t same = kNone;
+    for (size_t k = 0; k < values_[phi].phi_operands.size(); k++) {
+        uint32_t operand = find(values_[phi].phi_operands[k]);
+        if (operand == same || operand == phi) continue;
+        if (same != kNone) return phi;
+        same = operand;
+    }
+    if (same == kNone) same = new_value(ValueKind::OPAQUE);
+
+    values_[phi].forward = same;
+    std::vector<uint32_t> users;
+    users.swap(values_[phi].phi_users);
+    if (values_[same].kind == ValueKind::PHI) {
+        values_[same].phi_users.insert(values_[same].phi_users.end(), users.begin(), users.end());
+    }
+    for (uint32_t user : users) {
+        if (user != phi && find(user) == user) try_remove_trivial_phi(user);
+    }
+    return find(same);
+}
+
+bool SsaBody::const_of(uint32_t v, uint32_t& out) {
+    v = find(v);
+    if (const_state_.size() < values_.size()) {
+        const_state_.resize(values_.size(), 0);
+        const_value_.resize(values_.size(), 0);
+    }
+    if (const_state_[v] == 1 || const_state_[v] == 3) return false;
+    if (const_state_[v] == 2) {
+        out = const_value_[v];
+        return true;
+    }
+
+    const_state_[v] = 1;
+    bool known = false;
+    uint32_t value = 0;
+    const Value& val = values_[v];
+    if (val.kind == ValueKind::CONST) {
+        known = true;
+        value = val.constant;
+    } else if (val.kind == ValueKind::OP) {
+        uint32_t a, b;
+        known = const_of(val.operands[0], a) && const_of(val.operands[1], b) &&
+                fold(val.op, a, b, value);
+    } else if (val.kind == ValueKind::PHI) {
+        // Every incoming value is the same constant
+        for (size_t k = 0; k < val.phi_operands.size(); k++) {
+            uint32_t operand = find(val.phi_operands[k]);
+            uint32_t incoming;
+            if (operand == v) continue;
+            if (!const_of(operand, incoming) || (known && incoming != value)) {
+                known = false;
+                break;
+            }
+            known = true;
+            value = incoming;
+        }
+    }
+
+    const_state_[v] = known ? 2 : 3;
+    const_value_[v] = value;
+    out = value;
+    return known;
+}
+
+// A pure expression tree whose every operand was pushed inside this block.
+// Such a tree can be deleted or replaced by one push of the same value
+// without disturbing anything else on the stack.
+bool SsaBody::removable(int32_t i) {
+    if (removable_[i] >= 0) return removable_[i] == 1;
+    const Node& node = nodes_[i];
+    HEIPOpcode op = node.inst.opcode;
+    bool result = false;
+    if (op == HEIPOpcode::LOAD || op == HEIPOpcode::SLOT_LOAD) {
+        result = true;
+    } else if (is_pure_op(op) || op == HEIPOpcode::DIV) {
+        uint32_t value;
+        result = op != HEIPOpcode::DIV || const_of(node.result, value);
+        for (int32_t producer : node.producers) {
+            result = result && producer >= 0 && removable(producer);
+        }
+    }
+    removable_[i] = result ? 1 : 0;
+    return result;
+}
+
+void SsaBody::rewrite_tree(int32_t i, int level, OptimizerStats& stats, bool& changed) {
+    const Node& node = nodes_[i];
+    HEIPOpcode op = node.inst.opcode;
+    uint32_t v = find(node.result);
+    uint32_t value;
+
+    if (const_of(v, value)) {
+        if (op == HEIPOpcode::LOAD && node.inst.operands[0] == value) return;
+        drop_operands(i);
+        replace(i, HEIPOpcode::LOAD, value);
+        stats.constants_folded++;
+        changed = true;
+        return;
+    }
+
+    if (node.holder_slot != kNone && find(node.holder_value) == v) {
+        if (op == HEIPOpcode::SLOT_LOAD) {
+            if (node.inst.operands[0] != node.holder_slot) {
+                replace(i, HEIPOpcode::SLOT_LOAD, node.holder_slot);
+                stats.copies_propagated++;
+                changed = true;
+            }
+            return;
+        }
+        if (level >= 2) {
+            drop_operands(i);
+            replace(i, HEIPOpcode::SLOT_LOAD, node.holder_slot);
+            stats.expressions_reused++;
+            changed = true;
+            return;
+        }
+    }
+
+    for (int32_t producer : node.producers) {
+        rewrite_tree(producer, level, stats, changed);
+    }
+}
+
+void SsaBody::eliminate_dead_stores(bool& changed) {
+    // Backward slot liveness over the rewritten code. Nothing is live at the
+    // end of a body, since the frame is discarded and inlined overlay slots
+    // are private to the expansion, except in the main unit: its frame is
+    // what hosts read back after the run.
+    auto transfer = [&](size_t i, std::vector<bool>& live) {
+        if (edits_[i] == Edit::DROP) return;
+        HEIPOpcode op = effective_opcode(i);
+        if (op == HEIPOpcode::SLOT_STORE) {
+            live[effective_operand(i)] = false;
+        } else if (op == HEIPOpcode::SLOT_LOAD) {
+            live[effective_operand(i)] = true;
+        } else if (clobbers_slots(op)) {
+            live.assign(slot_count_, true);
+        }
+    };
+    auto live_out = [&](const Block& block, const std::vector<std::vector<bool>>& live_in) {
+        std::vector<bool> live(slot_count_, block.exits && slots_live_at_exit_);
+        for (uint32_t succ : block.succs) {
+            for (uint32_t slot = 0; slot < slot_count_; slot++) {
+                if (live_in[succ][slot]) live[slot] = true;
+            }
+        }
+        return live;
+    };
+
+    std::vector<std::vector<bool>> live_in(blocks_.size(), std::vector<bool>(slot_count_, false));
+    bool again = true;
+    while (again) {
+        again = false;
+        for (size_t b = blocks_.size(); b-- > 0;) {
+            if (!blocks_[b].reachable) continue;
+            std::vector<bool> live = live_out(blocks_[b], live_in);
+            for (size_t i = blocks_[b].end; i-- > blocks_[b].first;) transfer(i, live);
+            if (live != live_in[b]) {
+                live_in[b].swap(live);
+                again = true;
+            }
+        }
+    }
+
+    for (const auto& block : blocks_) {
+        if (!block.reachable) continue;
+        std::vector<bool> live = live_out(block, live_in);
+        for (size_t i = block.end; i-- > block.first;) {
+            if (edits_[i] != Edit::DROP && effective_opcode(i) == HEIPOpcode::SLOT_STORE &&
+                !live[effective_operand(i)]) {
+                int32_t producer = nodes_[i].producers[0];
+                if (producer >= 0 && removable(producer)) {
+                    drop_tree(producer);
+                    edits_[i] = Edit::DROP;
+                } else {
+                    replace(static_cast<int32_t>(i), HEIPOpcode::POP, 0);
+                }
+                changed = true;
+                continue;
+            }
+            transfer(i, live);
+        }
+    }
+}
+
+void SsaBody::drop_tree(int32_t i) {
+    edits_[i] = Edit::DROP;
+    drop_operands(i);
+}
+
+void SsaBody::drop_operands(int32_t i) {
+    for (int32_t producer : nodes_[i].producers) drop_tree(producer);
+}
+
+void SsaBody::replace(int32_t i, HEIPOpcode op, uint32_t operand) {
+    edits_[i] = Edit::REPLACE;
+    replace_op_[i] = op;
+    replace_operand_[i] = operand;
+}
+
+HEIPOpcode SsaBody::effective_opcode(size_t i) const {
+    return edits_[i] == Edit::REPLACE ? replace_op_[i] : nodes_[i].inst.opcode;
+}
+
+uint32_t SsaBody::effective_operand(size_t i) const {
+    return edits_[i] == Edit::REPLACE ? replace_operand_[i] : nodes_[i].inst.operands[0];
+}
+
+// Instruction reached from `i` once a few unconditional jumps are followed
+size_t SsaBody::destination(size_t i) const {
+    for (int hops = 0; hops < 8 && i < nodes_.size() && edits_[i] == Edit::KEEP &&
+                       nodes_[i].inst.opcode == HEIPOpcode::JMP; hops++) {
+        i = static_cast<size_t>(index_at_[nodes_[i].inst.operands[0]]);
+    }
+    return i;
+}
+
+bool SsaBody::plan(int level, OptimizerStats& stats) {
+    size_t count = nodes_.size();
+    edits_.assign(count, Edit::KEEP);
+    replace_op_.assign(count, HEIPOpcode::NOP);
+    replace_operand_.assign(count, 0);
+    removable_.assign(count, -1);
+    bool changed = false;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!blocks_[nodes_[i].block].reachable) {
+            edits_[i] = Edit::DROP;
+            changed = true;
+        }
+    }
+
+    // Branches on a known condition, and values computed only to be popped
+    for (size_t i = 0; i < count; i++) {
+        if (edits_[i] != Edit::KEEP || nodes_[i].producers.empty()) continue;
+        HEIPOpcode op = nodes_[i].inst.opcode;
+        int32_t producer = nodes_[i].producers[0];
+        if (producer < 0 || !removable(producer)) continue;
+
+        uint32_t condition;
+        if ((op == HEIPOpcode::JZ || op == HEIPOpcode::JNZ) &&
+            const_of(nodes_[producer].result, condition)) {
+            drop_tree(producer);
+            if ((condition == 0) == (op == HEIPOpcode::JZ)) {
+                replace(static_cast<int32_t>(i), HEIPOpcode::JMP, nodes_[i].inst.operands[0]);
+            } else {
+                edits_[i] = Edit::DROP;
+            }
+            stats.constants_folded++;
+            changed = true;
+        } else if ((op == HEIPOpcode::JZ || op == HEIPOpcode::JNZ) &&
+                   destination(index_at_[nodes_[i].inst.operands[0]]) == destination(i + 1)) {
+            // Both ways lead to the same place (e.g. an arm left empty)
+            drop_tree(producer);
+            edits_[i] = Edit::DROP;
+            changed = true;
+        } else if (level >= 2 && op == HEIPOpcode::POP) {
+            drop_tree(producer);
+            edits_[i] = Edit::DROP;
+            changed = true;
+        }
+    }
+
+    // Value rewrites, from each outermost removable tree inwards
+    for (size_t i = 0; i < count; i++) {
+        if (edits_[i] != Edit::KEEP || nodes_[i].result == kNone) continue;
+        int32_t index = static_cast<int32_t>(i);
+        if (!removable(index)) continue;
+        int32_t consumer = nodes_[i].consumer;
+        if (consumer >= 0 && removable(consumer)) continue;
+        rewrite_tree(index, level, stats, changed);
+    }
+
+    if (level >= 2) eliminate_dead_stores(changed);
+    return changed;
+}
+
+uint32_t SsaBody::apply(std::vector<uint8_t>& code, std::vector<Relocation>& relocations) {
+    size_t count = nodes_.size();
+    std::vector<uint8_t> out;
+    std::vector<uint32_t> new_pc(count + 1, 0);
+    uint32_t removed = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        new_pc[i] = static_cast<uint32_t>(out.size());
+        const Node& node = nodes_[i];
+        if (edits_[i] == Edit::DROP) {
+            removed++;
+        } else if (edits_[i] == Edit::REPLACE) {
+            out.push_back(static_cast<uint8_t>(replace_op_[i]));
+            if (opcode_info(static_cast<uint8_t>(replace_op_[i]))->layout == OperandLayout::U32) {
+                out.resize(out.size() + 4);
+                write_u32(&out[out.size() - 4], replace_operand_[i]);
+            }
+        } else {
+            out.insert(out.end(), code_.begin() + node.pc,
+                       code_.begin() + node.pc + node.inst.length);
+        }
+    }
+    new_pc[count] = static_cast<uint32_t>(out.size());
+
+    // Branch targets follow their instructions; a target that was dropped
+    // moves to the next surviving instruction
+    std::vector<bool> targeted(count + 1, false);
+    for (size_t i = 0; i < count; i++) {
+        if (edits_[i] == Edit::DROP || !is_branch(effective_opcode(i))) continue;
+        uint32_t target = static_cast<uint32_t>(index_at_[effective_operand(i)]);
+        write_u32(&out[new_pc[i] + 1], new_pc[target]);
+        size_t landing = target;
+        while (landing < count && edits_[landing] == Edit::DROP) landing++;
+        targeted[landing] = true;
+    }
+
+    std::vector<Relocation> kept;
+    for (const auto& relocation : relocations) {
+        size_t start = relocation.offset;
+        while (start > 0 && index_at_[start] < 0) start--;
+        size_t i = static_cast<size_t>(index_at_[start]);
+        if (i < count && edits_[i] == Edit::KEEP) {
+            kept.push_back(relocation);
+            kept.back().offset = new_pc[i] + (relocation.offset - nodes_[i].pc);
+        } else if (relocation.kind == RelocationKind::INLINE_SITE) {
+            // An inline site moves to whatever runs in its place, unless
+            // that is a join or loop head running more often than the body
+            size_t landing = i;
+            while (landing < count && edits_[landing] == Edit::DROP) landing++;
+            if (landing > i && targeted[landing]) continue;
+            kept.push_back(relocation);
+            kept.back().offset = new_pc[i];
+        }
+    }
+
+    relocations.swap(kept);
+    code.swap(out);
+    return removed;
+}
+
+} // namespace
+
+bool optimize_ssa(std::vector<uint8_t>& code, std::vector<Relocation>& relocations,
+                  uint32_t slot_count, bool slots_live_at_exit, int level,
+                  OptimizerStats& stats) {
+    if (level <= 0) return true;
+
+    // Each round re-lowers the rewritten code, so folding exposes dead
+    // stores and dead stores expose more folding
+    for (int round = 0; round < kMaxRounds; round++) {
+        std::vector<uint8_t> current = code;
+        SsaBody body(current, slot_count, slots_live_at_exit);
+        if (!body.lower()) return round > 0;
+        if (!body.plan(level, stats)) break;
+        stats.instructions_removed += body.apply(code, relocations);
+    }
+    return true;
+}
+
+} // namespace heip
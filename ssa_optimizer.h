@@ -0,0 +1,44 @@
+#pragma once
+#include "heip_types.h"
+#include <vector>
+#include <cstdint>
+
+namespace heip {
+
+// Counters reported by `heip compile --stats`
+struct OptimizerStats {
+    uint32_t constants_folded;      // Expressions and branches with a known value
+    uint32_t copies_propagated;     // Slot loads redirected to the original slot
+    uint32_t expressions_reused;    // Recomputations replaced by a slot load
+    uint32_t instructions_removed;
+    
+    // Profile-guided (--profile-in)
+    uint32_t hot_calls_inlined;     // Inlined on a budget raised by call counts
+    uint32_t cold_blocks_moved;     // Rarely taken If/Else arms laid out last
+    uint32_t superinstructions;     // Hot opcode pairs fused
+    
+    // Image layout
+    uint32_t cold_units;            // Units placed after the hot ones
+    uint32_t tail_calls;            // Calls that reuse the caller's frame
+    uint32_t operands_compacted;    // Instructions rewritten with 1-byte operands
+    uint32_t pure_units;            // Units whose results the runtime may memoize
+};
+
+// SSA mid-end for one body (unit code without its frame prologue, branch
+// targets body-relative). Frame slots are renamed into SSA values with
+// Braun et al.'s on-the-fly construction and the operand stack is tracked
+// symbolically inside each basic block; the results drive rewrites of the
+// original bytecode:
+//   -O1  constant folding/propagation, constant branches, unreachable
+//        blocks, copy propagation
+//   -O2  also common subexpression elimination and dead store/code
+//        elimination
+// Slots start at zero (FRAME_CREATE); HELP_HEAL and checkpoint opcodes
+// clobber them. With slots_live_at_exit (the main unit, whose frame is the
+// program's result) stores reaching the end are kept. Returns false and
+// leaves the code untouched if the body can't be lowered.
+bool optimize_ssa(std::vector<uint8_t>& code, std::vector<Relocation>& relocations,
+                  uint32_t slot_count, bool slots_live_at_exit, int level,
+                  OptimizerStats& stats);
+
+} // namespace heip
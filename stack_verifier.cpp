@@ -0,0 +1,150 @@
+#include "stack_verifier.h"
+#include "opcode_table.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace heip {
+
+namespace {
+
+// Depths beyond this are rejected, so claims from an image cannot overflow
+// the arithmetic below
+const int64_t kDepthLimit = 1 << 20;
+const int32_t kUnreached = INT32_MIN;
+
+} // namespace
+
+bool verify_stack_effect(const uint8_t* code, size_t offset, size_t size,
+                         const CalleeEffect& callee, StackEffect& effect) {
+    size_t end = offset + size;
+    std::vector<int32_t> depth(size, kUnreached);   // Depth before each instruction
+    std::vector<size_t> worklist;
+    bool exits = false;
+    effect = StackEffect{0, 0, 0};
+
+    // Records the depth a path reaches `target` with; paths must agree
+    auto reach = [&](size_t target, int64_t at) {
+        if (target < offset || target >= end || at < -kDepthLimit || at > kDepthLimit) {
+            return false;
+        }
+        int32_t& known = depth[target - offset];
+        if (known == kUnreached) {
+            known = static_cast<int32_t>(at);
+            worklist.push_back(target);
+            return true;
+        }
+        return known == at;
+    };
+    if (size == 0 || !reach(offset, 0)) return false;
+
+    while (!worklist.empty()) {
+        size_t pc = worklist.back();
+        worklist.pop_back();
+        int64_t at = depth[pc - offset];
+        DecodedInstruction inst;
+        if (!decode_instruction(code, end, pc, inst)) return false;
+        const OpcodeInfo* info = opcode_info(static_cast<uint8_t>(inst.opcode));
+
+        int64_t lowest, highest, next;
+        if (is_call(inst.opcode) || is_resolved_call(inst.opcode)) {
+            StackEffect called;
+            uint32_t operand = is_call(inst.opcode) ? inst.operands[0] : inst.operands[1];
+            if (!callee(inst.opcode, operand, called)) return false;
+            lowest = at + called.lowest;
+            highest = at + called.highest;
+            next = at + called.net;
+        } else {
+            int64_t pops = info->pops;
+            if (inst.opcode == HEIPOpcode::CHAIN_NEW) pops = inst.operands[0];
+            if (pops < 0 || info->pushes < 0) return false;
+            lowest = at - pops;
+            next = lowest + info->pushes;
+            highest = std::max(at, next);
+        }
+        if (lowest < -kDepthLimit || highest > kDepthLimit) return false;
+        effect.lowest = static_cast<int32_t>(std::min<int64_t>(effect.lowest, lowest));
+        effect.highest = static_cast<int32_t>(std::max<int64_t>(effect.highest, highest));
+
+        if (inst.opcode == HEIPOpcode::RET || inst.opcode == HEIPOpcode::FRAME_EXIT) {
+            if (exits && effect.net != at) return false;
+            effect.net = static_cast<int32_t>(at);
+            exits = true;
+            continue;
+        }
+        if (inst.opcode == HEIPOpcode::TAILCALL) {
+            // The callee returns for the unit, so this is an exit at the
+            // depth it leaves. The runtime runs it as a plain call from the
+            // root frame or a heal point, so the code after it must exit
+            // at that same depth too.
+            if (exits && effect.net != next) return false;
+            effect.net = static_cast<int32_t>(next);
+            exits = true;
+        }
+        if (is_branch(inst.opcode)) {
+            if (!reach(inst.operands[0], next)) return false;
+            if (inst.opcode == HEIPOpcode::JMP) continue;
+        }
+        // Falling off the end of the unit fails here too
+        if (!reach(pc + inst.length, next)) return false;
+    }
+    return exits;
+}
+
+void compute_stack_effects(BytecodeImage& image) {
+    // Units by entry and by symbol, bound the way the runtime binds them
+    std::unordered_map<uint32_t, size_t> by_offset;
+    std::unordered_map<DodecaSymbol, size_t> by_symbol;
+    for (size_t u = 0; u < image.units.size(); u++) {
+        image.units[u].has_stack_effect = false;
+        by_offset[image.units[u].offset] = u;
+        if (image.units[u].symbol != kInvalidSymbol) by_symbol[image.units[u].symbol] = u;
+    }
+    for (const auto& alias : image.aliases) by_symbol[alias.symbol] = alias.unit;
+
+    enum State : uint8_t { PENDING, VISITING, DONE };
+    std::vector<State> state(image.units.size(), PENDING);
+    std::function<bool(size_t)> resolve = [&](size_t u) {
+        if (state[u] == VISITING) return false;   // Recursive: no finite effect
+        if (state[u] == DONE) return image.units[u].has_stack_effect;
+        state[u] = VISITING;
+
+        auto callee = [&](HEIPOpcode opcode, uint32_t operand, StackEffect& effect) {
+            // A Superlative's candidates must agree, since any may run
+            if (opcode == HEIPOpcode::SUPERLATIVE) {
+                if (operand >= image.superlatives.size()) return false;
+                const std::vector<uint32_t>& candidates = image.superlatives[operand].candidates;
+                for (size_t i = 0; i < candidates.size(); i++) {
+                    if (!resolve(candidates[i]) ||
+                        (i > 0 && !(image.units[candidates[i]].stack_effect == effect))) {
+                        return false;
+                    }
+                    effect = image.units[candidates[i]].stack_effect;
+                }
+                return !candidates.empty();
+            }
+            size_t target;
+            if (is_call(opcode)) {
+                auto found = by_offset.find(operand);
+                if (found == by_offset.end()) return false;
+                target = found->second;
+            } else {
+                auto found = by_symbol.find(operand);
+                if (found == by_symbol.end()) return false;
+                target = found->second;
+            }
+            if (!resolve(target)) return false;
+            effect = image.units[target].stack_effect;
+            return true;
+        };
+        ImageUnit& unit = image.units[u];
+        StackEffect effect;
+        unit.has_stack_effect = verify_stack_effect(image.code.data(), unit.offset, unit.size,
+                                                    callee, effect);
+        unit.stack_effect = unit.has_stack_effect ? effect : StackEffect{0, 0, 0};
+        state[u] = DONE;
+        return unit.has_stack_effect;
+    };
+    for (size_t u = 0; u < image.units.size(); u++) resolve(u);
+}
+
+} // namespace heip
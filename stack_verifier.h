@@ -0,0 +1,30 @@
+#pragma once
+#include "bytecode_image.h"
+#include <functional>
+#include <cstdint>
+
+namespace heip {
+
+// Stack effect of a CALL target (operand), OVERLAY_EXPAND symbol or
+// SUPERLATIVE (operand); false when it is not known
+typedef std::function<bool(HEIPOpcode opcode, uint32_t operand, StackEffect& effect)>
+    CalleeEffect;
+
+// Abstract interpretation of one unit, code[offset, offset + size), over
+// operand stack depths relative to the entry depth. Every reachable
+// instruction must be reached at a single depth, every exit must leave the
+// same depth, and each instruction pops what the opcode table says (CALL,
+// TAILCALL, OVERLAY_EXPAND and SUPERLATIVE take their callee's effect,
+// CHAIN_NEW its operand). A TAILCALL is an exit at the depth its callee
+// leaves, and the code after it must exit at that depth as well.
+// False when any of that fails or an opcode's effect is unknown; such code
+// can only run under the checked interpreter.
+bool verify_stack_effect(const uint8_t* code, size_t offset, size_t size,
+                         const CalleeEffect& callee, StackEffect& effect);
+
+// Fills in every unit's stack effect for a linked image. Callees are
+// verified before their callers; recursive units get none, nor do units
+// that call them.
+void compute_stack_effects(BytecodeImage& image);
+
+} // namespace heip
@@ -0,0 +1,162 @@
+#include "symbol_resolver.h"
+
+namespace heip {
+
+SymbolResolver::SymbolResolver()
+    : epoch_(1)
+    , stats_() {
+}
+
+void SymbolResolver::reset() {
+    targets_.clear();
+    symbols_.clear();
+    superlatives_.clear();
+    symbol_caches_.clear();
+    superlative_caches_.clear();
+    epoch_++;
+}
+
+void SymbolResolver::bind_symbol(DodecaSymbol symbol, const std::string& name, uint32_t entry) {
+    if (symbol >= symbols_.size()) symbols_.resize(symbol + 1, nullptr);
+    
+    if (ResolvedTarget* existing = symbols_[symbol]) {
+        // Rebinding updates in place so stale cache pointers stay valid
+        existing->name = name;
+        existing->entry = entry;
+    } else {
+        targets_.push_back(ResolvedTarget{name, entry});
+        symbols_[symbol] = &targets_.back();
+    }
+    epoch_++;
+}
+
+void SymbolResolver::register_overlay(DodecaSymbol symbol, const std::string& name,
+                                      uint32_t entry) {
+    bind_symbol(symbol, name, entry);
+}
+
+void SymbolResolver::register_protocol(DodecaSymbol symbol, const std::string& qualified_name,
+                                       uint32_t entry) {
+    bind_symbol(symbol, qualified_name, entry);
+}
+
+void SymbolResolver::register_superlative(uint32_t superlative, const std::string& name,
+                                          const std::vector<ResolvedTarget>& candidates) {
+    // Moving the table is safe: cached candidates are only read back
+    // under the epoch they were cached in
+    if (superlative >= superlatives_.size()) superlatives_.resize(superlative + 1);
+    Superlative& entry = superlatives_[superlative];
+    entry.name = name;
+    entry.candidates = candidates;
+    entry.calls.assign(candidates.size(), 0);
+    entry.costs.assign(candidates.size(), 0);
+    entry.unranked_calls = 0;
+    epoch_++;
+}
+
+void SymbolResolver::set_site_count(uint32_t sites) {
+    symbol_caches_.assign(sites, InlineCache{0, 0, false, {}});
+    superlative_caches_.assign(sites, InlineCache{0, 0, false, {}});
+}
+
+template <typename SlowLookup>
+const ResolvedTarget* SymbolResolver::cached_lookup(std::vector<InlineCache>& caches,
+                                                    uint32_t site, uint32_t key,
+                                                    SlowLookup slow) {
+    if (site >= caches.size()) return nullptr;
+    InlineCache& cache = caches[site];
+
+    bool cacheable = true;
+    if (cache.epoch == epoch_) {
+        for (uint8_t i = 0; i < cache.size; i++) {
+            if (cache.entries[i].key == key) {
+                if (cache.size == 1) {
+                    stats_.monomorphic_hits++;
+                } else {
+                    stats_.polymorphic_hits++;
+                }
+                return cache.entries[i].target;
+            }
+        }
+        if (cache.megamorphic) {
+            stats_.megamorphic_lookups++;
+            return slow(key, cacheable);
+        }
+    } else {
+        if (cache.size > 0 || cache.megamorphic) stats_.invalidations++;
+        cache.epoch = epoch_;
+        cache.size = 0;
+        cache.megamorphic = false;
+    }
+
+    stats_.misses++;
+    const ResolvedTarget* target = slow(key, cacheable);
+    if (!target || !cacheable) return target;
+
+    if (cache.size < InlineCache::kPolymorphicEntries) {
+        cache.entries[cache.size].key = key;
+        cache.entries[cache.size].target = target;
+        cache.size++;
+    } else {
+        cache.megamorphic = true;
+    }
+    return target;
+}
+
+const ResolvedTarget* SymbolResolver::resolve_symbol(uint32_t site, DodecaSymbol key) {
+    return cached_lookup(symbol_caches_, site, key, [this](uint32_t symbol, bool&) -> const ResolvedTarget* {
+        return symbol < symbols_.size() ? symbols_[symbol] : nullptr;
+    });
+}
+
+const ResolvedTarget* SymbolResolver::rank(Superlative& superlative, bool& cacheable) {
+    // Candidates short of their trial calls go first, one call at a time
+    size_t best = 0;
+    for (size_t i = 1; i < superlative.candidates.size(); i++) {
+        if (superlative.calls[i] < superlative.calls[best]) best = i;
+    }
+    if (superlative.calls[best] < kTrialCalls) {
+        cacheable = false;
+        return &superlative.candidates[best];
+    }
+
+    // Lowest mean cost: costs[i] / calls[i] < costs[best] / calls[best]
+    stats_.rankings++;
+    for (size_t i = 0; i < superlative.candidates.size(); i++) {
+        double cost = static_cast<double>(superlative.costs[i]) * superlative.calls[best];
+        if (cost < static_cast<double>(superlative.costs[best]) * superlative.calls[i]) best = i;
+    }
+    return &superlative.candidates[best];
+}
+
+const ResolvedTarget* SymbolResolver::resolve_superlative(uint32_t site, uint32_t superlative,
+                                                          uint32_t& candidate) {
+    const ResolvedTarget* target = cached_lookup(
+        superlative_caches_, site, superlative, [this](uint32_t id, bool& cacheable) -> const ResolvedTarget* {
+            if (id >= superlatives_.size() || superlatives_[id].candidates.empty()) {
+                return nullptr;
+            }
+            return rank(superlatives_[id], cacheable);
+        });
+    if (target) {
+        candidate = static_cast<uint32_t>(target - superlatives_[superlative].candidates.data());
+    }
+    return target;
+}
+
+void SymbolResolver::record_cost(uint32_t superlative, uint32_t candidate, uint64_t cost) {
+    if (superlative >= superlatives_.size()) return;
+    Superlative& entry = superlatives_[superlative];
+    if (candidate >= entry.candidates.size()) return;
+    entry.calls[candidate]++;
+    entry.costs[candidate] += cost;
+    
+    // Once ranked, the winner is cached until enough new costs could have
+    // changed it; during the trial nothing is cached
+    if (++entry.unranked_calls >= kRankInterval) {
+        entry.unranked_calls = 0;
+        epoch_++;
+    }
+}
+
+} // namespace heip
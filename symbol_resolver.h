@@ -0,0 +1,115 @@
+#pragma once
+#include "../core/heip_types.h"
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace heip {
+
+// Target of a symbol resolution
+struct ResolvedTarget {
+    std::string name;      // Qualified overlay/protocol name
+    uint32_t entry;        // Code offset of the body
+};
+
+// Per-site inline cache: up to four (key, target) pairs validated by the
+// resolver epoch. A hit is a key compare plus an epoch compare; sites that
+// see more keys than fit go megamorphic and use the slow path directly.
+struct InlineCache {
+    static const uint8_t kPolymorphicEntries = 4;
+
+    struct Entry {
+        uint32_t key;
+        const ResolvedTarget* target;
+    };
+
+    uint64_t epoch;
+    uint8_t size;
+    bool megamorphic;
+    Entry entries[kPolymorphicEntries];
+};
+
+// Inline cache effectiveness counters
+struct ResolverStats {
+    uint64_t monomorphic_hits;
+    uint64_t polymorphic_hits;
+    uint64_t misses;
+    uint64_t megamorphic_lookups;
+    uint64_t invalidations;
+    uint64_t rankings;             // Superlative slow paths that ranked candidates
+};
+
+// Runtime symbol and Superlative resolution
+// Overlay symbols and franchise protocols share one symbol space. A
+// Superlative resolves to whichever of its candidate protocols has the
+// lowest measured cost: each candidate first runs kTrialCalls times, then
+// the slow path ranks them by mean cost and the site caches the winner.
+// Any registration that can change a resolution result, and every
+// kRankInterval costs recorded for a ranked Superlative, bump the global
+// epoch, which lazily invalidates every inline cache on its next use.
+class SymbolResolver {
+public:
+    static const uint32_t kTrialCalls = 4;
+    static const uint32_t kRankInterval = 256;
+
+    SymbolResolver();
+
+    // Forgets every binding and Superlative and drops the site caches, for
+    // a runtime installing another program
+    void reset();
+
+    // Registration (bumps the epoch)
+    void register_overlay(DodecaSymbol symbol, const std::string& name, uint32_t entry);
+    void register_protocol(DodecaSymbol symbol, const std::string& qualified_name,
+                           uint32_t entry);
+    void register_superlative(uint32_t superlative, const std::string& name,
+                              const std::vector<ResolvedTarget>& candidates);
+
+    // One empty cache per site the program numbers (Program::cache_sites).
+    // Site operands come from bytecode, so the table never grows on demand.
+    void set_site_count(uint32_t sites);
+
+    // Cached resolution at a code site; nullptr for an unknown site or symbol
+    const ResolvedTarget* resolve_symbol(uint32_t site, DodecaSymbol symbol);
+
+    // The Superlative's current best candidate, and its index for
+    // record_cost; nullptr for an unknown site or Superlative
+    const ResolvedTarget* resolve_superlative(uint32_t site, uint32_t superlative,
+                                              uint32_t& candidate);
+    void record_cost(uint32_t superlative, uint32_t candidate, uint64_t cost);
+
+    uint64_t epoch() const { return epoch_; }
+    const ResolverStats& stats() const { return stats_; }
+
+private:
+    // Targets are never erased, so cached pointers stay dereferenceable;
+    // the epoch decides whether they are still current
+    std::deque<ResolvedTarget> targets_;
+    std::vector<ResolvedTarget*> symbols_;      // Indexed by symbol ordinal
+
+    // Costs are instructions per call, summed per candidate
+    struct Superlative {
+        std::string name;
+        std::vector<ResolvedTarget> candidates;
+        std::vector<uint64_t> calls;
+        std::vector<uint64_t> costs;
+        uint64_t unranked_calls;                // Since the epoch last moved
+    };
+    std::vector<Superlative> superlatives_;
+
+    // Site caches, indexed by the site operand
+    std::vector<InlineCache> symbol_caches_;
+    std::vector<InlineCache> superlative_caches_;
+
+    uint64_t epoch_;
+    ResolverStats stats_;
+
+    void bind_symbol(DodecaSymbol symbol, const std::string& name, uint32_t entry);
+    template <typename SlowLookup>
+    const ResolvedTarget* cached_lookup(std::vector<InlineCache>& caches, uint32_t site,
+                                        uint32_t key, SlowLookup slow);
+    const ResolvedTarget* rank(Superlative& superlative, bool& cacheable);
+};
+
+} // namespace heip